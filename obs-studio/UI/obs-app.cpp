@@ -64,6 +64,7 @@ static string lastLogFile;
 bool portable_mode = false;
 static bool log_verbose = false;
 static bool unfiltered_log = false;
+static bool opt_pool_allocator = false;
 bool opt_start_streaming = false;
 bool opt_start_recording = false;//启动就开始录制
 bool opt_studio_mode = false;
@@ -1867,12 +1868,32 @@ static void upgrade_settings(void)
 	os_closedir(dir);
 }
 
+static void log_pool_stats(void)
+{
+	struct base_pool_stats stats[BASE_POOL_SIZE_CLASSES];
+	base_get_pool_stats(stats);
+
+	blog(LOG_INFO, "Pool allocator size classes:");
+	for (size_t i = 0; i < BASE_POOL_SIZE_CLASSES; i++)
+		blog(LOG_INFO, "\t%5d bytes: %ld allocations, %ld from cache",
+				(int)stats[i].size, stats[i].allocs,
+				stats[i].cache_hits);
+}
+
 int main(int argc, char *argv[])
 {
 #ifndef _WIN32
 	signal(SIGPIPE, SIG_IGN);
 #endif
 
+	/* the allocator can only be replaced before anything is allocated */
+	for (int i = 1; i < argc; i++) {
+		if (arg_is(argv[i], "--pool-allocator", nullptr)) {
+			base_set_allocator(base_get_pool_allocator());
+			opt_pool_allocator = true;
+		}
+	}
+
 #ifdef _WIN32
     load_debug_privilege();//修改了下进程的权限
     base_set_crash_handler(main_crash_handler, nullptr);//设置异常处理，不设置有个默认的，不需要则填nullptr
@@ -1940,6 +1961,8 @@ int main(int argc, char *argv[])
 			"--always-on-top: Start in 'always on top' mode.\n\n" <<
 			"--unfiltered_log: Make log unfiltered.\n\n" <<
 			"--allow-opengl: Allow OpenGL on Windows.\n\n" <<
+			"--pool-allocator: Cache small allocations per thread."
+				<< "\n\n" <<
 			"--version, -V: Get current version.\n";
 
 			exit(0);
@@ -1967,6 +1990,9 @@ int main(int argc, char *argv[])
     curl_global_init(CURL_GLOBAL_ALL);//curl
 	int ret = run_program(logFile, argc, argv);
 
+	if (opt_pool_allocator)
+		log_pool_stats();
+
     blog(LOG_INFO, "Number of memory leaks: %ld", bnum_allocs());//base_set_log_handler可以设置log处理，默认是打印在终端
     base_set_log_handler(nullptr, nullptr);//设置log处理函数（blog的），nullptr即为log处理为默认(默认是打印到终端)
 	return ret;
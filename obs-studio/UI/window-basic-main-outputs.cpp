@@ -149,6 +149,16 @@ static void FindBestFilename(string &strPath, bool noSpace)
 }
 
 /* ------------------------------------------------------------------------ */
+
+static void SetFragmentSettings(config_t *config, obs_data_t *settings)
+{
+	bool fragmented = config_get_bool(config, "Output", "RecFragmented");
+	int duration = config_get_int(config, "Output", "RecFragmentDuration");
+
+	obs_data_set_bool(settings, "fragmented", fragmented);
+	obs_data_set_int(settings, "fragment_duration", duration);
+}
+
 /*****************
 *创建音频编码器（aac）
 *
@@ -780,6 +790,10 @@ bool SimpleOutput::ConfigureRecording(bool updateReplayBuffer)
 			"RecRBTime");
 	int rbSize = config_get_int(main->Config(), "SimpleOutput",
 			"RecRBSize");
+	bool rbDiskBuffer = config_get_bool(main->Config(), "SimpleOutput",
+			"RecRBDiskBuffer");
+	const char *rbDiskBufferDir = config_get_string(main->Config(),
+			"SimpleOutput", "RecRBDiskBufferDir");
 
 	os_dir_t *dir = path ? os_opendir(path) : nullptr;
 
@@ -838,9 +852,13 @@ bool SimpleOutput::ConfigureRecording(bool updateReplayBuffer)
 		obs_data_set_int(settings, "max_time_sec", rbTime);
 		obs_data_set_int(settings, "max_size_mb",
 				usingRecordingPreset ? rbSize : 0);
+		obs_data_set_bool(settings, "use_disk_buffer", rbDiskBuffer);
+		obs_data_set_string(settings, "disk_buffer_dir",
+				rbDiskBufferDir);
 	} else {
 		obs_data_set_string(settings, ffmpegOutput ? "url" : "path",
 				strPath.c_str());
+		SetFragmentSettings(main->Config(), settings);
 	}
 
 	obs_data_set_string(settings, "muxer_settings", mux);
@@ -1436,6 +1454,8 @@ bool AdvancedOutput::StartRecording()
 		obs_data_set_string(settings,
 				ffmpegRecording ? "url" : "path",
 				strPath.c_str());
+		if (!ffmpegRecording)
+			SetFragmentSettings(main->Config(), settings);
 
 		obs_output_update(fileOutput, settings);
 
@@ -979,6 +979,10 @@ bool OBSBasic::InitBasicConfigDefaults()
     config_set_default_int(basicConfig, "SimpleOutput", "RecRBSize", 512);
     config_set_default_string(basicConfig, "SimpleOutput", "RecRBPrefix",
                               "Replay");
+    config_set_default_bool(basicConfig, "SimpleOutput", "RecRBDiskBuffer",
+                            false);
+    config_set_default_string(basicConfig, "SimpleOutput",
+                              "RecRBDiskBufferDir", "");
 
     config_set_default_bool  (basicConfig, "AdvOut", "ApplyServiceSettings",
                               true);
@@ -1032,6 +1036,10 @@ bool OBSBasic::InitBasicConfigDefaults()
     config_set_default_string(basicConfig, "Output", "FilenameFormatting",
                               "%CCYY-%MM-%DD %hh-%mm-%ss");
 
+    config_set_default_bool  (basicConfig, "Output", "RecFragmented", false);
+    config_set_default_int   (basicConfig, "Output", "RecFragmentDuration",
+                              2000);
+
     config_set_default_bool  (basicConfig, "Output", "DelayEnable", false);
     config_set_default_uint  (basicConfig, "Output", "DelaySec", 20);
     config_set_default_bool  (basicConfig, "Output", "DelayPreserve", true);
@@ -2850,6 +2858,8 @@ int OBSBasic::ResetVideo()
     ovi.adapter        = 0;
     ovi.gpu_conversion = true;
     ovi.scale_type     = GetScaleType(basicConfig);
+    ovi.conversion_threads = 0;
+    ovi.tick_threads = 0;
 
     if (ovi.base_width == 0 || ovi.base_height == 0) {
         ovi.base_width = 1920;
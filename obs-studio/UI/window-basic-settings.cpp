@@ -418,6 +418,8 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 #endif
 	HookWidget(ui->filenameFormatting,   EDIT_CHANGED,   ADV_CHANGED);
 	HookWidget(ui->overwriteIfExists,    CHECK_CHANGED,  ADV_CHANGED);
+	HookWidget(ui->recFragmented,        CHECK_CHANGED,  ADV_CHANGED);
+	HookWidget(ui->recFragmentDuration,  SCROLL_CHANGED, ADV_CHANGED);
 	HookWidget(ui->simpleRBPrefix,       EDIT_CHANGED,   ADV_CHANGED);
 	HookWidget(ui->simpleRBSuffix,       EDIT_CHANGED,   ADV_CHANGED);
 	HookWidget(ui->streamDelayEnable,    CHECK_CHANGED,  ADV_CHANGED);
@@ -482,8 +484,10 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 	delete ui->processPriorityLabel;
 	delete ui->processPriority;
 	delete ui->advancedGeneralGroupBox;
+#ifndef __linux__
 	delete ui->enableNewSocketLoop;
 	delete ui->enableLowLatencyMode;
+#endif
 #ifdef __APPLE__
 	delete ui->disableAudioDucking;
 #endif
@@ -494,8 +498,10 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 	ui->processPriorityLabel = nullptr;
 	ui->processPriority = nullptr;
 	ui->advancedGeneralGroupBox = nullptr;
+#ifndef __linux__
 	ui->enableNewSocketLoop = nullptr;
 	ui->enableLowLatencyMode = nullptr;
+#endif
 #ifdef __APPLE__
 	ui->disableAudioDucking = nullptr;
 #endif
@@ -2048,6 +2054,10 @@ void OBSBasicSettings::LoadAdvancedSettings()
 			"FilenameFormatting");
 	bool overwriteIfExists = config_get_bool(main->Config(), "Output",
 			"OverwriteIfExists");
+	bool recFragmented = config_get_bool(main->Config(), "Output",
+			"RecFragmented");
+	int recFragmentDuration = config_get_int(main->Config(), "Output",
+			"RecFragmentDuration");
 	const char *bindIP = config_get_string(main->Config(), "Output",
 			"BindIP");
 	const char *rbPrefix = config_get_string(main->Config(), "SimpleOutput",
@@ -2067,6 +2077,8 @@ void OBSBasicSettings::LoadAdvancedSettings()
 
 	ui->filenameFormatting->setText(filename);
 	ui->overwriteIfExists->setChecked(overwriteIfExists);
+	ui->recFragmented->setChecked(recFragmented);
+	ui->recFragmentDuration->setValue(recFragmentDuration);
 	ui->simpleRBPrefix->setText(rbPrefix);
 	ui->simpleRBSuffix->setText(rbSuffix);
 
@@ -2117,6 +2129,11 @@ void OBSBasicSettings::LoadAdvancedSettings()
 
 	ui->enableNewSocketLoop->setChecked(enableNewSocketLoop);
 	ui->enableLowLatencyMode->setChecked(enableLowLatencyMode);
+#elif defined(__linux__)
+	ui->enableNewSocketLoop->setChecked(config_get_bool(main->Config(),
+			"Output", "NewSocketLoopEnable"));
+	ui->enableLowLatencyMode->setChecked(config_get_bool(main->Config(),
+			"Output", "LowLatencyEnable"));
 #endif
 
 	loading = false;
@@ -2603,6 +2620,9 @@ void OBSBasicSettings::SaveAdvancedSettings()
 	if (main->Active())
 		SetProcessPriority(priority.c_str());
 
+	SaveCheckBox(ui->enableNewSocketLoop, "Output", "NewSocketLoopEnable");
+	SaveCheckBox(ui->enableLowLatencyMode, "Output", "LowLatencyEnable");
+#elif defined(__linux__)
 	SaveCheckBox(ui->enableNewSocketLoop, "Output", "NewSocketLoopEnable");
 	SaveCheckBox(ui->enableLowLatencyMode, "Output", "LowLatencyEnable");
 #endif
@@ -2641,6 +2661,8 @@ void OBSBasicSettings::SaveAdvancedSettings()
 	SaveEdit(ui->simpleRBPrefix, "SimpleOutput", "RecRBPrefix");
 	SaveEdit(ui->simpleRBSuffix, "SimpleOutput", "RecRBSuffix");
 	SaveCheckBox(ui->overwriteIfExists, "Output", "OverwriteIfExists");
+	SaveCheckBox(ui->recFragmented, "Output", "RecFragmented");
+	SaveSpinBox(ui->recFragmentDuration, "Output", "RecFragmentDuration");
 	SaveCheckBox(ui->streamDelayEnable, "Output", "DelayEnable");
 	SaveSpinBox(ui->streamDelaySec, "Output", "DelaySec");
 	SaveCheckBox(ui->streamDelayPreserve, "Output", "DelayPreserve");
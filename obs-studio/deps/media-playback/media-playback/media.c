@@ -269,6 +269,63 @@ static void mp_media_next_audio(mp_media_t *m)
 	m->a_cb(m->opaque, &audio);
 }
 
+static inline bool mp_media_scale_frame(mp_media_t *m,
+		struct obs_source_frame *frame)
+{
+	AVFrame *f = m->v.frame;
+	int ret = sws_scale(m->swscale,
+			(const uint8_t *const *)f->data, f->linesize,
+			0, f->height,
+			m->scale_pic, m->scale_linesizes);
+	if (ret < 0)
+		return false;
+
+	for (size_t i = 0; i < 4; i++) {
+		frame->data[i] = m->scale_pic[i];
+		frame->linesize[i] = abs(m->scale_linesizes[i]);
+	}
+
+	return true;
+}
+
+/* returns false if no frame could be acquired, in which case the frame is
+ * scaled and output the usual way */
+static bool mp_media_output_direct(mp_media_t *m,
+		const struct obs_source_frame *info)
+{
+	struct obs_source_frame *out;
+	AVFrame *f = m->v.frame;
+	int linesizes[4];
+
+	out = m->v_acquire_cb(m->opaque, info->format, info->width,
+			info->height);
+	if (!out)
+		return false;
+
+	for (size_t i = 0; i < 4; i++)
+		linesizes[i] = (int)out->linesize[i];
+
+	if (sws_scale(m->swscale, (const uint8_t *const *)f->data,
+				f->linesize, 0, f->height,
+				out->data, linesizes) < 0) {
+		m->v_discard_cb(m->opaque, out);
+		return true;
+	}
+
+	out->timestamp = info->timestamp;
+	out->full_range = info->full_range;
+	out->flip = false;
+	memcpy(out->color_matrix, info->color_matrix,
+			sizeof(out->color_matrix));
+	memcpy(out->color_range_min, info->color_range_min,
+			sizeof(out->color_range_min));
+	memcpy(out->color_range_max, info->color_range_max,
+			sizeof(out->color_range_max));
+
+	m->v_commit_cb(m->opaque, out);
+	return true;
+}
+
 static void mp_media_next_video(mp_media_t *m, bool preload)
 {
 	struct mp_decode *d = &m->v;
@@ -290,8 +347,18 @@ static void mp_media_next_video(mp_media_t *m, bool preload)
 		return;
 	}
 
+	/* scaled frames are written straight into the acquired frame once
+	 * the output format is known */
+	bool direct = !preload && m->swscale && m->v_acquire_cb;
+
 	bool flip = false;
-	if (m->swscale) {
+	if (direct) {
+		for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+			frame->data[i] = NULL;
+			frame->linesize[i] = 0;
+		}
+
+	} else if (m->swscale) {
 		int ret = sws_scale(m->swscale,
 				(const uint8_t *const *)f->data, f->linesize,
 				0, f->height,
@@ -364,6 +431,11 @@ static void mp_media_next_video(mp_media_t *m, bool preload)
 		d->got_first_keyframe = true;
 	}
 
+	if (direct && mp_media_output_direct(m, frame))
+		return;
+	if (direct && !mp_media_scale_frame(m, frame))
+		return;
+
 	if (preload)
 		m->v_preload_cb(m->opaque, frame);
 	else
@@ -709,6 +781,19 @@ bool mp_media_init(mp_media_t *media,
 	return true;
 }
 
+void mp_media_set_direct_video(mp_media_t *m,
+		mp_video_acquire_cb acquire_cb,
+		mp_video_cb commit_cb,
+		mp_video_cb discard_cb)
+{
+	if (!acquire_cb || !commit_cb || !discard_cb)
+		acquire_cb = NULL;
+
+	m->v_acquire_cb = acquire_cb;
+	m->v_commit_cb = commit_cb;
+	m->v_discard_cb = discard_cb;
+}
+
 static void mp_kill_thread(mp_media_t *m)
 {
 	if (m->thread_valid) {
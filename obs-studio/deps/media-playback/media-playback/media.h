@@ -41,6 +41,8 @@ extern "C" {
 typedef void (*mp_video_cb)(void *opaque, struct obs_source_frame *frame);
 typedef void (*mp_audio_cb)(void *opaque, struct obs_source_audio *audio);
 typedef void (*mp_stop_cb)(void *opaque);
+typedef struct obs_source_frame *(*mp_video_acquire_cb)(void *opaque,
+		enum video_format format, uint32_t width, uint32_t height);
 
 struct mp_media {
 	AVFormatContext *fmt;
@@ -51,6 +53,10 @@ struct mp_media {
 	mp_audio_cb a_cb;
 	void *opaque;
 
+	mp_video_acquire_cb v_acquire_cb;
+	mp_video_cb v_commit_cb;
+	mp_video_cb v_discard_cb;
+
 	char *path;
 	char *format_name;
 	int buffering;
@@ -109,6 +115,13 @@ extern bool mp_media_init(mp_media_t *media,
 		enum video_range_type force_range);
 extern void mp_media_free(mp_media_t *media);
 
+/* lets converted frames be scaled straight into frames owned by the caller,
+ * must be called before mp_media_play */
+extern void mp_media_set_direct_video(mp_media_t *media,
+		mp_video_acquire_cb acquire_cb,
+		mp_video_cb commit_cb,
+		mp_video_cb discard_cb);
+
 extern void mp_media_play(mp_media_t *media, bool loop);
 extern void mp_media_stop(mp_media_t *media);
 
@@ -0,0 +1,356 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/* This file is compiled with AVX2 code generation enabled; nothing in it may
+ * be called unless format_conversion_impl_supported says AVX2 is usable. */
+
+#include "format-conversion-internal.h"
+#include <immintrin.h>
+
+/* 8 pixels of two lines -> 8 bytes of each line, in order */
+static FORCE_INLINE void pack_lines_avx2(uint8_t *out0, uint8_t *out1,
+		__m256i val1, __m256i val2)
+{
+	const __m256i lane_order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	__m256i packed = _mm256_packs_epi32(val1, val2);
+	__m128i out;
+
+	packed = _mm256_packus_epi16(packed, packed);
+	packed = _mm256_permutevar8x32_epi32(packed, lane_order);
+	out    = _mm256_castsi256_si128(packed);
+
+	_mm_storel_epi64((__m128i*)out0, out);
+	_mm_storel_epi64((__m128i*)out1, _mm_unpackhi_epi64(out, out));
+}
+
+/* averages the chroma of 2x8 pixels, returns U0 V0 U1 V1 .. U3 V3 in the low
+ * 8 bytes */
+static FORCE_INLINE __m128i average_chroma_avx2(__m256i line1, __m256i line2)
+{
+	const __m256i uv_mask    = _mm256_set1_epi16(0x00FF);
+	const __m256i lane_order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	__m256i sum = _mm256_add_epi16(
+			_mm256_and_si256(line1, uv_mask),
+			_mm256_and_si256(line2, uv_mask));
+	sum = _mm256_add_epi16(sum,
+			_mm256_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	sum = _mm256_srai_epi16(sum, 2);
+	sum = _mm256_shuffle_epi32(sum, _MM_SHUFFLE(3, 1, 2, 0));
+	sum = _mm256_packus_epi16(sum, sum);
+	sum = _mm256_permutevar8x32_epi32(sum, lane_order);
+
+	return _mm256_castsi256_si128(sum);
+}
+
+static void compress_uyvx_to_i420_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	const __m256i lum_mask = _mm256_set1_epi32(0x0000FF00);
+	const __m128i uv_split = _mm_setr_epi8(0, 2, 4, 6, 1, 3, 5, 7,
+			8, 10, 12, 14, 9, 11, 13, 15);
+
+	for (y = start_y; y < end_y; y += 2) {
+		const uint8_t *line1 = input + y * in_linesize;
+		const uint8_t *line2 = line1 + in_linesize;
+		uint8_t *lum0 = output[0] + y * out_linesize[0];
+		uint8_t *lum1 = lum0 + out_linesize[0];
+		uint8_t *u    = output[1] + (y>>1) * out_linesize[1];
+		uint8_t *v    = output[2] + (y>>1) * out_linesize[2];
+		uint32_t x;
+
+		for (x = 0; x + 8 <= width; x += 8) {
+			__m256i val1 = _mm256_loadu_si256(
+					(const __m256i*)(line1 + x * 4));
+			__m256i val2 = _mm256_loadu_si256(
+					(const __m256i*)(line2 + x * 4));
+			__m128i uv;
+
+			pack_lines_avx2(lum0 + x, lum1 + x,
+				_mm256_srli_epi32(
+					_mm256_and_si256(val1, lum_mask), 8),
+				_mm256_srli_epi32(
+					_mm256_and_si256(val2, lum_mask), 8));
+
+			uv = _mm_shuffle_epi8(average_chroma_avx2(val1, val2),
+					uv_split);
+			*(uint32_t*)(u + (x>>1)) = (uint32_t)_mm_cvtsi128_si32(uv);
+			*(uint32_t*)(v + (x>>1)) = (uint32_t)_mm_cvtsi128_si32(
+					_mm_srli_si128(uv, 4));
+		}
+
+		compress_uyvx_row_c(line1, line2, lum0, lum1, u, v, 1,
+				x, width);
+	}
+}
+
+static void compress_uyvx_to_nv12_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	const __m256i lum_mask = _mm256_set1_epi32(0x0000FF00);
+
+	for (y = start_y; y < end_y; y += 2) {
+		const uint8_t *line1 = input + y * in_linesize;
+		const uint8_t *line2 = line1 + in_linesize;
+		uint8_t *lum0   = output[0] + y * out_linesize[0];
+		uint8_t *lum1   = lum0 + out_linesize[0];
+		uint8_t *chroma = output[1] + (y>>1) * out_linesize[1];
+		uint32_t x;
+
+		for (x = 0; x + 8 <= width; x += 8) {
+			__m256i val1 = _mm256_loadu_si256(
+					(const __m256i*)(line1 + x * 4));
+			__m256i val2 = _mm256_loadu_si256(
+					(const __m256i*)(line2 + x * 4));
+
+			pack_lines_avx2(lum0 + x, lum1 + x,
+				_mm256_srli_epi32(
+					_mm256_and_si256(val1, lum_mask), 8),
+				_mm256_srli_epi32(
+					_mm256_and_si256(val2, lum_mask), 8));
+
+			_mm_storel_epi64((__m128i*)(chroma + x),
+					average_chroma_avx2(val1, val2));
+		}
+
+		compress_uyvx_row_c(line1, line2, lum0, lum1,
+				chroma, chroma + 1, 2, x, width);
+	}
+}
+
+static void convert_uyvx_to_i444_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	const __m256i lum_mask = _mm256_set1_epi32(0x0000FF00);
+	const __m256i u_mask   = _mm256_set1_epi32(0x000000FF);
+	const __m256i v_mask   = _mm256_set1_epi32(0x00FF0000);
+
+	for (y = start_y; y < end_y; y += 2) {
+		const uint8_t *line1 = input + y * in_linesize;
+		const uint8_t *line2 = line1 + in_linesize;
+		uint8_t *lum0 = output[0] + y * out_linesize[0];
+		uint8_t *u0   = output[1] + y * out_linesize[1];
+		uint8_t *v0   = output[2] + y * out_linesize[2];
+		uint32_t x;
+
+		for (x = 0; x + 8 <= width; x += 8) {
+			__m256i val1 = _mm256_loadu_si256(
+					(const __m256i*)(line1 + x * 4));
+			__m256i val2 = _mm256_loadu_si256(
+					(const __m256i*)(line2 + x * 4));
+
+			pack_lines_avx2(lum0 + x, lum0 + out_linesize[0] + x,
+				_mm256_srli_epi32(
+					_mm256_and_si256(val1, lum_mask), 8),
+				_mm256_srli_epi32(
+					_mm256_and_si256(val2, lum_mask), 8));
+			pack_lines_avx2(u0 + x, u0 + out_linesize[1] + x,
+				_mm256_and_si256(val1, u_mask),
+				_mm256_and_si256(val2, u_mask));
+			pack_lines_avx2(v0 + x, v0 + out_linesize[2] + x,
+				_mm256_srli_epi32(
+					_mm256_and_si256(val1, v_mask), 16),
+				_mm256_srli_epi32(
+					_mm256_and_si256(val2, v_mask), 16));
+		}
+
+		convert_uyvx_row_to_i444_c(line1, lum0, u0, v0, x, width);
+		convert_uyvx_row_to_i444_c(line2,
+				lum0 + out_linesize[0],
+				u0 + out_linesize[1],
+				v0 + out_linesize[2], x, width);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* expands 16 luma samples and 8 chroma pairs (16-bit U|V<<8 words, already
+ * duplicated per pixel into uv_lo/uv_hi and shifted into place) to 16 packed
+ * pixels */
+static FORCE_INLINE void store_yuvx_16px_avx2(uint32_t *output,
+		const uint8_t *lum, __m256i uv_lo, __m256i uv_hi)
+{
+	__m256i lum_lo = _mm256_cvtepu8_epi32(
+			_mm_loadl_epi64((const __m128i*)lum));
+	__m256i lum_hi = _mm256_cvtepu8_epi32(
+			_mm_loadl_epi64((const __m128i*)(lum + 8)));
+
+	_mm256_storeu_si256((__m256i*)output,
+			_mm256_or_si256(lum_lo, uv_lo));
+	_mm256_storeu_si256((__m256i*)(output + 8),
+			_mm256_or_si256(lum_hi, uv_hi));
+}
+
+static FORCE_INLINE void expand_chroma_avx2(__m128i uv,
+		__m256i *uv_lo, __m256i *uv_hi)
+{
+	*uv_lo = _mm256_slli_epi32(_mm256_cvtepu16_epi32(
+				_mm_unpacklo_epi16(uv, uv)), 8);
+	*uv_hi = _mm256_slli_epi32(_mm256_cvtepu16_epi32(
+				_mm_unpackhi_epi16(uv, uv)), 8);
+}
+
+static void decompress_420_avx2(
+		const uint8_t *const input[], const uint32_t in_linesize[],
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize)
+{
+	uint32_t width_d2  = min_uint32(in_linesize[0], out_linesize)/2;
+	uint32_t height_d2 = end_y/2;
+	uint32_t y;
+
+	for (y = start_y/2; y < height_d2; y++) {
+		const uint8_t *u    = input[1] + y * in_linesize[1];
+		const uint8_t *v    = input[2] + y * in_linesize[2];
+		const uint8_t *lum0 = input[0] + y * 2 * in_linesize[0];
+		const uint8_t *lum1 = lum0 + in_linesize[0];
+		uint32_t *output0   = (uint32_t*)(output + y * 2 * out_linesize);
+		uint32_t *output1   = (uint32_t*)((uint8_t*)output0 +
+				out_linesize);
+		uint32_t x_d2;
+
+		for (x_d2 = 0; x_d2 + 8 <= width_d2; x_d2 += 8) {
+			__m128i u8 = _mm_loadl_epi64((const __m128i*)(u + x_d2));
+			__m128i v8 = _mm_loadl_epi64((const __m128i*)(v + x_d2));
+			__m256i uv_lo, uv_hi;
+
+			expand_chroma_avx2(_mm_unpacklo_epi8(u8, v8),
+					&uv_lo, &uv_hi);
+
+			store_yuvx_16px_avx2(output0 + x_d2 * 2,
+					lum0 + x_d2 * 2, uv_lo, uv_hi);
+			store_yuvx_16px_avx2(output1 + x_d2 * 2,
+					lum1 + x_d2 * 2, uv_lo, uv_hi);
+		}
+
+		decompress_420_row_c(lum0, u, v, 1, output0, x_d2, width_d2);
+		decompress_420_row_c(lum1, u, v, 1, output1, x_d2, width_d2);
+	}
+}
+
+static void decompress_nv12_avx2(
+		const uint8_t *const input[], const uint32_t in_linesize[],
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize)
+{
+	uint32_t width_d2  = min_uint32(in_linesize[0], out_linesize)/2;
+	uint32_t height_d2 = end_y/2;
+	uint32_t y;
+
+	for (y = start_y/2; y < height_d2; y++) {
+		const uint8_t *chroma = input[1] + y * in_linesize[1];
+		const uint8_t *lum0   = input[0] + y * 2 * in_linesize[0];
+		const uint8_t *lum1   = lum0 + in_linesize[0];
+		uint32_t *output0     = (uint32_t*)(output +
+				y * 2 * out_linesize);
+		uint32_t *output1     = (uint32_t*)((uint8_t*)output0 +
+				out_linesize);
+		uint32_t x_d2;
+
+		for (x_d2 = 0; x_d2 + 8 <= width_d2; x_d2 += 8) {
+			__m256i uv_lo, uv_hi;
+
+			expand_chroma_avx2(_mm_loadu_si128(
+					(const __m128i*)(chroma + x_d2 * 2)),
+					&uv_lo, &uv_hi);
+
+			store_yuvx_16px_avx2(output0 + x_d2 * 2,
+					lum0 + x_d2 * 2, uv_lo, uv_hi);
+			store_yuvx_16px_avx2(output1 + x_d2 * 2,
+					lum1 + x_d2 * 2, uv_lo, uv_hi);
+		}
+
+		decompress_420_row_c(lum0, chroma, chroma + 1, 2,
+				output0, x_d2, width_d2);
+		decompress_420_row_c(lum1, chroma, chroma + 1, 2,
+				output1, x_d2, width_d2);
+	}
+}
+
+static void decompress_422_avx2(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize,
+		bool leading_lum)
+{
+	uint32_t width_d2 = min_uint32(in_linesize/4, out_linesize/8);
+	uint32_t y;
+
+	const __m256i dup_lo = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+	const __m256i dup_hi = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+	const int keep = leading_lum ? (int)0xFFFFFF00 : (int)0xFFFF00FF;
+	const int lum  = leading_lum ? 0x000000FF : 0x0000FF00;
+	const __m256i keep_mask = _mm256_setr_epi32(
+			-1, keep, -1, keep, -1, keep, -1, keep);
+	const __m256i lum_mask  = _mm256_setr_epi32(
+			0, lum, 0, lum, 0, lum, 0, lum);
+
+	for (y = start_y; y < end_y; y++) {
+		const uint32_t *input32 =
+			(const uint32_t*)(input + y * in_linesize);
+		uint32_t *output32 = (uint32_t*)(output + y * out_linesize);
+		uint32_t x_d2;
+
+		for (x_d2 = 0; x_d2 + 8 <= width_d2; x_d2 += 8) {
+			__m256i in = _mm256_loadu_si256(
+					(const __m256i*)(input32 + x_d2));
+			__m256i lo = _mm256_permutevar8x32_epi32(in, dup_lo);
+			__m256i hi = _mm256_permutevar8x32_epi32(in, dup_hi);
+
+			lo = _mm256_or_si256(_mm256_and_si256(lo, keep_mask),
+					_mm256_and_si256(
+						_mm256_srli_epi32(lo, 16),
+						lum_mask));
+			hi = _mm256_or_si256(_mm256_and_si256(hi, keep_mask),
+					_mm256_and_si256(
+						_mm256_srli_epi32(hi, 16),
+						lum_mask));
+
+			_mm256_storeu_si256(
+					(__m256i*)(output32 + x_d2 * 2), lo);
+			_mm256_storeu_si256(
+					(__m256i*)(output32 + x_d2 * 2 + 8), hi);
+		}
+
+		decompress_422_row_c(input32, output32, x_d2, width_d2,
+				leading_lum);
+	}
+}
+
+const struct format_conversion_funcs format_conversion_avx2 = {
+	.compress_uyvx_to_i420 = compress_uyvx_to_i420_avx2,
+	.compress_uyvx_to_nv12 = compress_uyvx_to_nv12_avx2,
+	.convert_uyvx_to_i444  = convert_uyvx_to_i444_avx2,
+	.decompress_nv12       = decompress_nv12_avx2,
+	.decompress_420        = decompress_420_avx2,
+	.decompress_422        = decompress_422_avx2
+};
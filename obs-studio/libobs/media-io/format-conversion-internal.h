@@ -0,0 +1,129 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "format-conversion.h"
+
+/*
+ * Scalar row helpers shared by the reference kernels and by the SIMD kernels
+ * for the columns left over after their vector loops.  Packed 444 input is
+ * U, Y, V, X per pixel.
+ */
+
+static FORCE_INLINE uint32_t min_uint32(uint32_t a, uint32_t b)
+{
+	return a < b ? a : b;
+}
+
+static FORCE_INLINE void compress_uyvx_row_c(
+		const uint8_t *line1, const uint8_t *line2,
+		uint8_t *lum0, uint8_t *lum1,
+		uint8_t *u, uint8_t *v, uint32_t uv_step,
+		uint32_t x, uint32_t width)
+{
+	for (; x + 1 < width; x += 2) {
+		const uint8_t *p0 = line1 + x * 4;
+		const uint8_t *p1 = line2 + x * 4;
+		uint32_t chroma_x = (x >> 1) * uv_step;
+
+		lum0[x]     = p0[1];
+		lum0[x + 1] = p0[5];
+		lum1[x]     = p1[1];
+		lum1[x + 1] = p1[5];
+
+		u[chroma_x] = (uint8_t)((p0[0] + p0[4] + p1[0] + p1[4]) >> 2);
+		v[chroma_x] = (uint8_t)((p0[2] + p0[6] + p1[2] + p1[6]) >> 2);
+	}
+}
+
+static FORCE_INLINE void convert_uyvx_row_to_i444_c(
+		const uint8_t *line, uint8_t *lum, uint8_t *u, uint8_t *v,
+		uint32_t x, uint32_t width)
+{
+	for (; x < width; x++) {
+		const uint8_t *p = line + x * 4;
+
+		lum[x] = p[1];
+		u[x]   = p[0];
+		v[x]   = p[2];
+	}
+}
+
+static FORCE_INLINE void decompress_420_row_c(
+		const uint8_t *lum, const uint8_t *u, const uint8_t *v,
+		uint32_t uv_step, uint32_t *output,
+		uint32_t x_d2, uint32_t width_d2)
+{
+	for (; x_d2 < width_d2; x_d2++) {
+		uint32_t out = ((uint32_t)u[x_d2 * uv_step] << 8) |
+		               ((uint32_t)v[x_d2 * uv_step] << 16);
+
+		output[x_d2 * 2]     = lum[x_d2 * 2]     | out;
+		output[x_d2 * 2 + 1] = lum[x_d2 * 2 + 1] | out;
+	}
+}
+
+static FORCE_INLINE void decompress_422_row_c(
+		const uint32_t *input32, uint32_t *output32,
+		uint32_t x_d2, uint32_t width_d2, bool leading_lum)
+{
+	for (; x_d2 < width_d2; x_d2++) {
+		uint32_t dw = input32[x_d2];
+
+		output32[x_d2 * 2] = dw;
+		if (leading_lum) {
+			dw &= 0xFFFFFF00;
+			dw |= (uint8_t)(dw >> 16);
+		} else {
+			dw &= 0xFFFF00FF;
+			dw |= (dw >> 16) & 0xFF00;
+		}
+		output32[x_d2 * 2 + 1] = dw;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+typedef void (*compress_uyvx_func_t)(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[]);
+
+typedef void (*decompress_planar_func_t)(
+		const uint8_t *const input[], const uint32_t in_linesize[],
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize);
+
+typedef void (*decompress_422_func_t)(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize,
+		bool leading_lum);
+
+struct format_conversion_funcs {
+	compress_uyvx_func_t     compress_uyvx_to_i420;
+	compress_uyvx_func_t     compress_uyvx_to_nv12;
+	compress_uyvx_func_t     convert_uyvx_to_i444;
+	decompress_planar_func_t decompress_nv12;
+	decompress_planar_func_t decompress_420;
+	decompress_422_func_t    decompress_422;
+};
+
+/* implemented in format-conversion-avx2.c, which is built with AVX2 enabled
+ * and must only be called after checking the CPU supports it */
+extern const struct format_conversion_funcs format_conversion_avx2;
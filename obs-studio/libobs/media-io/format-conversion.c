@@ -15,7 +15,8 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
-#include "format-conversion.h"
+#include "format-conversion-internal.h"
+#include "../util/base.h"
 #include <xmmintrin.h>
 #include <emmintrin.h>
 
@@ -84,12 +85,140 @@ do {                                                                          \
 } while (false)
 
 
-static FORCE_INLINE uint32_t min_uint32(uint32_t a, uint32_t b)
+/* ------------------------------------------------------------------------- */
+/* scalar reference kernels                                                  */
+
+static void compress_uyvx_to_i420_c(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
 {
-	return a < b ? a : b;
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	for (y = start_y; y < end_y; y += 2) {
+		const uint8_t *line1 = input + y * in_linesize;
+		uint8_t *lum0 = output[0] + y * out_linesize[0];
+
+		compress_uyvx_row_c(line1, line1 + in_linesize,
+				lum0, lum0 + out_linesize[0],
+				output[1] + (y>>1) * out_linesize[1],
+				output[2] + (y>>1) * out_linesize[2], 1,
+				0, width);
+	}
 }
 
-void compress_uyvx_to_i420(
+static void compress_uyvx_to_nv12_c(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	for (y = start_y; y < end_y; y += 2) {
+		const uint8_t *line1 = input + y * in_linesize;
+		uint8_t *lum0 = output[0] + y * out_linesize[0];
+		uint8_t *chroma = output[1] + (y>>1) * out_linesize[1];
+
+		compress_uyvx_row_c(line1, line1 + in_linesize,
+				lum0, lum0 + out_linesize[0],
+				chroma, chroma + 1, 2,
+				0, width);
+	}
+}
+
+static void convert_uyvx_to_i444_c(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	for (y = start_y; y < end_y; y++) {
+		convert_uyvx_row_to_i444_c(input + y * in_linesize,
+				output[0] + y * out_linesize[0],
+				output[1] + y * out_linesize[1],
+				output[2] + y * out_linesize[2],
+				0, width);
+	}
+}
+
+static void decompress_420_c(
+		const uint8_t *const input[], const uint32_t in_linesize[],
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize)
+{
+	uint32_t width_d2  = min_uint32(in_linesize[0], out_linesize)/2;
+	uint32_t height_d2 = end_y/2;
+	uint32_t y;
+
+	for (y = start_y/2; y < height_d2; y++) {
+		const uint8_t *u   = input[1] + y * in_linesize[1];
+		const uint8_t *v   = input[2] + y * in_linesize[2];
+		const uint8_t *lum = input[0] + y * 2 * in_linesize[0];
+		uint8_t *out       = output + y * 2 * out_linesize;
+
+		decompress_420_row_c(lum, u, v, 1,
+				(uint32_t*)out, 0, width_d2);
+		decompress_420_row_c(lum + in_linesize[0], u, v, 1,
+				(uint32_t*)(out + out_linesize), 0, width_d2);
+	}
+}
+
+static void decompress_nv12_c(
+		const uint8_t *const input[], const uint32_t in_linesize[],
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize)
+{
+	uint32_t width_d2  = min_uint32(in_linesize[0], out_linesize)/2;
+	uint32_t height_d2 = end_y/2;
+	uint32_t y;
+
+	for (y = start_y/2; y < height_d2; y++) {
+		const uint8_t *chroma = input[1] + y * in_linesize[1];
+		const uint8_t *lum    = input[0] + y * 2 * in_linesize[0];
+		uint8_t *out          = output + y * 2 * out_linesize;
+
+		decompress_420_row_c(lum, chroma, chroma + 1, 2,
+				(uint32_t*)out, 0, width_d2);
+		decompress_420_row_c(lum + in_linesize[0],
+				chroma, chroma + 1, 2,
+				(uint32_t*)(out + out_linesize), 0, width_d2);
+	}
+}
+
+static void decompress_422_c(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize,
+		bool leading_lum)
+{
+	uint32_t width_d2 = min_uint32(in_linesize/4, out_linesize/8);
+	uint32_t y;
+
+	for (y = start_y; y < end_y; y++) {
+		decompress_422_row_c(
+				(const uint32_t*)(input + y * in_linesize),
+				(uint32_t*)(output + y * out_linesize),
+				0, width_d2, leading_lum);
+	}
+}
+
+static const struct format_conversion_funcs format_conversion_c = {
+	.compress_uyvx_to_i420 = compress_uyvx_to_i420_c,
+	.compress_uyvx_to_nv12 = compress_uyvx_to_nv12_c,
+	.convert_uyvx_to_i444  = convert_uyvx_to_i444_c,
+	.decompress_nv12       = decompress_nv12_c,
+	.decompress_420        = decompress_420_c,
+	.decompress_422        = decompress_422_c
+};
+
+/* ------------------------------------------------------------------------- */
+/* SSE2 kernels                                                              */
+
+static void compress_uyvx_to_i420_sse2(
 		const uint8_t *input, uint32_t in_linesize,
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output[], const uint32_t out_linesize[])
@@ -109,7 +238,7 @@ void compress_uyvx_to_i420(
 		uint32_t lum_y_pos    = y      * out_linesize[0];
 		uint32_t x;
 
-		for (x = 0; x < width; x += 4) {
+		for (x = 0; x + 4 <= width; x += 4) {
 			const uint8_t *img = input + y_pos + x*4;
 			uint32_t lum_pos0  = lum_y_pos + x;
 			uint32_t lum_pos1  = lum_pos0 + out_linesize[0];
@@ -124,10 +253,16 @@ void compress_uyvx_to_i420(
 					chroma_y_pos + (x>>1),
 					line1, line2, uv_mask);
 		}
+
+		compress_uyvx_row_c(input + y_pos, input + y_pos + in_linesize,
+				lum_plane + lum_y_pos,
+				lum_plane + lum_y_pos + out_linesize[0],
+				u_plane + chroma_y_pos, v_plane + chroma_y_pos,
+				1, x, width);
 	}
 }
 
-void compress_uyvx_to_nv12(
+static void compress_uyvx_to_nv12_sse2(
 		const uint8_t *input, uint32_t in_linesize,
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output[], const uint32_t out_linesize[])
@@ -146,7 +281,7 @@ void compress_uyvx_to_nv12(
 		uint32_t lum_y_pos    = y      * out_linesize[0];
 		uint32_t x;
 
-		for (x = 0; x < width; x += 4) {
+		for (x = 0; x + 4 <= width; x += 4) {
 			const uint8_t *img = input + y_pos + x*4;
 			uint32_t lum_pos0  = lum_y_pos + x;
 			uint32_t lum_pos1  = lum_pos0 + out_linesize[0];
@@ -160,10 +295,17 @@ void compress_uyvx_to_nv12(
 			pack_ch_1plane(chroma_plane, chroma_y_pos + x,
 					line1, line2, uv_mask);
 		}
+
+		compress_uyvx_row_c(input + y_pos, input + y_pos + in_linesize,
+				lum_plane + lum_y_pos,
+				lum_plane + lum_y_pos + out_linesize[0],
+				chroma_plane + chroma_y_pos,
+				chroma_plane + chroma_y_pos + 1,
+				2, x, width);
 	}
 }
 
-void convert_uyvx_to_i444(
+static void convert_uyvx_to_i444_sse2(
 		const uint8_t *input, uint32_t in_linesize,
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output[], const uint32_t out_linesize[])
@@ -183,7 +325,7 @@ void convert_uyvx_to_i444(
 		uint32_t lum_y_pos    = y      * out_linesize[0];
 		uint32_t x;
 
-		for (x = 0; x < width; x += 4) {
+		for (x = 0; x + 4 <= width; x += 4) {
 			const uint8_t *img = input + y_pos + x*4;
 			uint32_t lum_pos0  = lum_y_pos + x;
 			uint32_t lum_pos1  = lum_pos0 + out_linesize[0];
@@ -199,126 +341,347 @@ void convert_uyvx_to_i444(
 			pack_shift(v_plane, lum_pos0, lum_pos1,
 					line1, line2, v_mask, 2);
 		}
+
+		for (uint32_t i = 0; i < 2; i++) {
+			uint32_t pos = lum_y_pos + i * out_linesize[0];
+			convert_uyvx_row_to_i444_c(
+					input + y_pos + i * in_linesize,
+					lum_plane + pos, u_plane + pos,
+					v_plane + pos, x, width);
+		}
 	}
 }
 
-void decompress_420(
+/* expands 16 luma samples and their 8 chroma pairs (as 16-bit U|V<<8 words)
+ * to 16 packed pixels */
+static FORCE_INLINE void store_yuvx_16px_sse2(uint32_t *output, __m128i lum,
+		__m128i uv_lo, __m128i uv_hi)
+{
+	__m128i zero   = _mm_setzero_si128();
+	__m128i lum_lo = _mm_unpacklo_epi8(lum, zero);
+	__m128i lum_hi = _mm_unpackhi_epi8(lum, zero);
+
+	__m128i out0 = _mm_or_si128(_mm_unpacklo_epi16(lum_lo, zero),
+			_mm_slli_epi32(_mm_unpacklo_epi16(uv_lo, zero), 8));
+	__m128i out1 = _mm_or_si128(_mm_unpackhi_epi16(lum_lo, zero),
+			_mm_slli_epi32(_mm_unpackhi_epi16(uv_lo, zero), 8));
+	__m128i out2 = _mm_or_si128(_mm_unpacklo_epi16(lum_hi, zero),
+			_mm_slli_epi32(_mm_unpacklo_epi16(uv_hi, zero), 8));
+	__m128i out3 = _mm_or_si128(_mm_unpackhi_epi16(lum_hi, zero),
+			_mm_slli_epi32(_mm_unpackhi_epi16(uv_hi, zero), 8));
+
+	_mm_storeu_si128((__m128i*)output,        out0);
+	_mm_storeu_si128((__m128i*)(output + 4),  out1);
+	_mm_storeu_si128((__m128i*)(output + 8),  out2);
+	_mm_storeu_si128((__m128i*)(output + 12), out3);
+}
+
+static void decompress_420_sse2(
 		const uint8_t *const input[], const uint32_t in_linesize[],
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output, uint32_t out_linesize)
 {
-	uint32_t start_y_d2 = start_y/2;
-	uint32_t width_d2   = min_uint32(in_linesize[0], out_linesize)/2;
-	uint32_t height_d2  = end_y/2;
+	uint32_t width_d2  = min_uint32(in_linesize[0], out_linesize)/2;
+	uint32_t height_d2 = end_y/2;
 	uint32_t y;
 
-	for (y = start_y_d2; y < height_d2; y++) {
-		const uint8_t *chroma0 = input[1] + y * in_linesize[1];
-		const uint8_t *chroma1 = input[2] + y * in_linesize[2];
-		register const uint8_t *lum0, *lum1;
-		register uint32_t *output0, *output1;
-		uint32_t x;
-
-		lum0 = input[0] + y * 2 * in_linesize[0];
-		lum1 = lum0 + in_linesize[0];
-		output0 = (uint32_t*)(output + y * 2 * in_linesize[0]);
-		output1 = (uint32_t*)((uint8_t*)output0 + in_linesize[0]);
-
-		for (x = 0; x < width_d2; x++) {
-			uint32_t out;
-			out = (*(chroma0++) << 8) | (*(chroma1++) << 16);
-
-			*(output0++) = *(lum0++) | out;
-			*(output0++) = *(lum0++) | out;
-
-			*(output1++) = *(lum1++) | out;
-			*(output1++) = *(lum1++) | out;
+	for (y = start_y/2; y < height_d2; y++) {
+		const uint8_t *u    = input[1] + y * in_linesize[1];
+		const uint8_t *v    = input[2] + y * in_linesize[2];
+		const uint8_t *lum0 = input[0] + y * 2 * in_linesize[0];
+		const uint8_t *lum1 = lum0 + in_linesize[0];
+		uint32_t *output0   = (uint32_t*)(output + y * 2 * out_linesize);
+		uint32_t *output1   = (uint32_t*)((uint8_t*)output0 +
+				out_linesize);
+		uint32_t x_d2;
+
+		for (x_d2 = 0; x_d2 + 8 <= width_d2; x_d2 += 8) {
+			__m128i u8 = _mm_loadl_epi64((const __m128i*)(u + x_d2));
+			__m128i v8 = _mm_loadl_epi64((const __m128i*)(v + x_d2));
+			__m128i uv = _mm_unpacklo_epi8(u8, v8);
+			__m128i uv_lo = _mm_unpacklo_epi16(uv, uv);
+			__m128i uv_hi = _mm_unpackhi_epi16(uv, uv);
+
+			store_yuvx_16px_sse2(output0 + x_d2 * 2,
+					_mm_loadu_si128((const __m128i*)
+						(lum0 + x_d2 * 2)),
+					uv_lo, uv_hi);
+			store_yuvx_16px_sse2(output1 + x_d2 * 2,
+					_mm_loadu_si128((const __m128i*)
+						(lum1 + x_d2 * 2)),
+					uv_lo, uv_hi);
 		}
+
+		decompress_420_row_c(lum0, u, v, 1, output0, x_d2, width_d2);
+		decompress_420_row_c(lum1, u, v, 1, output1, x_d2, width_d2);
 	}
 }
 
-void decompress_nv12(
+static void decompress_nv12_sse2(
 		const uint8_t *const input[], const uint32_t in_linesize[],
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output, uint32_t out_linesize)
 {
-	uint32_t start_y_d2 = start_y/2;
-	uint32_t width_d2   = min_uint32(in_linesize[0], out_linesize)/2;
-	uint32_t height_d2  = end_y/2;
+	uint32_t width_d2  = min_uint32(in_linesize[0], out_linesize)/2;
+	uint32_t height_d2 = end_y/2;
 	uint32_t y;
 
-	for (y = start_y_d2; y < height_d2; y++) {
-		const uint16_t *chroma;
-		register const uint8_t *lum0, *lum1;
-		register uint32_t *output0, *output1;
-		uint32_t x;
-
-		chroma = (const uint16_t*)(input[1] + y * in_linesize[1]);
-		lum0 = input[0] + y * 2 * in_linesize[0];
-		lum1 = lum0 + in_linesize[0];
-		output0 = (uint32_t*)(output + y * 2 * out_linesize);
-		output1 = (uint32_t*)((uint8_t*)output0 + out_linesize);
-
-		for (x = 0; x < width_d2; x++) {
-			uint32_t out = *(chroma++) << 8;
-
-			*(output0++) = *(lum0++) | out;
-			*(output0++) = *(lum0++) | out;
-
-			*(output1++) = *(lum1++) | out;
-			*(output1++) = *(lum1++) | out;
+	for (y = start_y/2; y < height_d2; y++) {
+		const uint8_t *chroma = input[1] + y * in_linesize[1];
+		const uint8_t *lum0   = input[0] + y * 2 * in_linesize[0];
+		const uint8_t *lum1   = lum0 + in_linesize[0];
+		uint32_t *output0     = (uint32_t*)(output +
+				y * 2 * out_linesize);
+		uint32_t *output1     = (uint32_t*)((uint8_t*)output0 +
+				out_linesize);
+		uint32_t x_d2;
+
+		for (x_d2 = 0; x_d2 + 8 <= width_d2; x_d2 += 8) {
+			__m128i uv = _mm_loadu_si128(
+					(const __m128i*)(chroma + x_d2 * 2));
+			__m128i uv_lo = _mm_unpacklo_epi16(uv, uv);
+			__m128i uv_hi = _mm_unpackhi_epi16(uv, uv);
+
+			store_yuvx_16px_sse2(output0 + x_d2 * 2,
+					_mm_loadu_si128((const __m128i*)
+						(lum0 + x_d2 * 2)),
+					uv_lo, uv_hi);
+			store_yuvx_16px_sse2(output1 + x_d2 * 2,
+					_mm_loadu_si128((const __m128i*)
+						(lum1 + x_d2 * 2)),
+					uv_lo, uv_hi);
 		}
+
+		decompress_420_row_c(lum0, chroma, chroma + 1, 2,
+				output0, x_d2, width_d2);
+		decompress_420_row_c(lum1, chroma, chroma + 1, 2,
+				output1, x_d2, width_d2);
 	}
 }
 
-void decompress_422(
+static void decompress_422_sse2(
 		const uint8_t *input, uint32_t in_linesize,
 		uint32_t start_y, uint32_t end_y,
 		uint8_t *output, uint32_t out_linesize,
 		bool leading_lum)
 {
-	uint32_t width_d2 = min_uint32(in_linesize, out_linesize)/2;
+	uint32_t width_d2 = min_uint32(in_linesize/4, out_linesize/8);
 	uint32_t y;
 
-	register const uint32_t *input32;
-	register const uint32_t *input32_end;
-	register uint32_t       *output32;
+	/* even pixels are the source dword, odd pixels get the second luma
+	 * sample moved into the first one's place */
+	__m128i keep_mask = leading_lum ?
+		_mm_set_epi32((int)0xFFFFFF00, -1, (int)0xFFFFFF00, -1) :
+		_mm_set_epi32((int)0xFFFF00FF, -1, (int)0xFFFF00FF, -1);
+	__m128i lum_mask = leading_lum ?
+		_mm_set_epi32(0x000000FF, 0, 0x000000FF, 0) :
+		_mm_set_epi32(0x0000FF00, 0, 0x0000FF00, 0);
+
+	for (y = start_y; y < end_y; y++) {
+		const uint32_t *input32 =
+			(const uint32_t*)(input + y * in_linesize);
+		uint32_t *output32 = (uint32_t*)(output + y * out_linesize);
+		uint32_t x_d2;
+
+		for (x_d2 = 0; x_d2 + 4 <= width_d2; x_d2 += 4) {
+			__m128i in = _mm_loadu_si128(
+					(const __m128i*)(input32 + x_d2));
+			__m128i lo = _mm_unpacklo_epi32(in, in);
+			__m128i hi = _mm_unpackhi_epi32(in, in);
+
+			lo = _mm_or_si128(_mm_and_si128(lo, keep_mask),
+					_mm_and_si128(_mm_srli_epi32(lo, 16),
+						lum_mask));
+			hi = _mm_or_si128(_mm_and_si128(hi, keep_mask),
+					_mm_and_si128(_mm_srli_epi32(hi, 16),
+						lum_mask));
+
+			_mm_storeu_si128((__m128i*)(output32 + x_d2 * 2), lo);
+			_mm_storeu_si128((__m128i*)(output32 + x_d2 * 2 + 4),
+					hi);
+		}
+
+		decompress_422_row_c(input32, output32, x_d2, width_d2,
+				leading_lum);
+	}
+}
+
+static const struct format_conversion_funcs format_conversion_sse2 = {
+	.compress_uyvx_to_i420 = compress_uyvx_to_i420_sse2,
+	.compress_uyvx_to_nv12 = compress_uyvx_to_nv12_sse2,
+	.convert_uyvx_to_i444  = convert_uyvx_to_i444_sse2,
+	.decompress_nv12       = decompress_nv12_sse2,
+	.decompress_420        = decompress_420_sse2,
+	.decompress_422        = decompress_422_sse2
+};
 
-	if (leading_lum) {
-		for (y = start_y; y < end_y; y++) {
-			input32     = (const uint32_t*)(input + y*in_linesize);
-			input32_end = input32 + width_d2;
-			output32    = (uint32_t*)(output + y*out_linesize);
+/* ------------------------------------------------------------------------- */
+/* runtime dispatch                                                          */
 
-			while(input32 < input32_end) {
-				register uint32_t dw = *input32;
+#ifdef _MSC_VER
+#include <intrin.h>
 
-				output32[0] = dw;
-				dw &= 0xFFFFFF00;
-				dw |= (uint8_t)(dw>>16);
-				output32[1] = dw;
+static inline void get_cpuid(int info[4], int leaf)
+{
+	__cpuidex(info, leaf, 0);
+}
 
-				output32 += 2;
-				input32++;
-			}
-		}
-	} else {
-		for (y = start_y; y < end_y; y++) {
-			input32     = (const uint32_t*)(input + y*in_linesize);
-			input32_end = input32 + width_d2;
-			output32    = (uint32_t*)(output + y*out_linesize);
-
-			while (input32 < input32_end) {
-				register uint32_t dw = *input32;
-
-				output32[0] = dw;
-				dw &= 0xFFFF00FF;
-				dw |= (dw>>16) & 0xFF00;
-				output32[1] = dw;
-
-				output32 += 2;
-				input32++;
-			}
-		}
+static inline uint64_t get_xcr0(void)
+{
+	return _xgetbv(0);
+}
+#else
+#include <cpuid.h>
+
+static inline void get_cpuid(int info[4], int leaf)
+{
+	unsigned int regs[4];
+	__cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+	for (size_t i = 0; i < 4; i++)
+		info[i] = (int)regs[i];
+}
+
+static inline uint64_t get_xcr0(void)
+{
+	uint32_t eax, edx;
+	__asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((uint64_t)edx << 32) | eax;
+}
+#endif
+
+#define CPUID_1_ECX_OSXSAVE (1 << 27)
+#define CPUID_1_ECX_AVX     (1 << 28)
+#define CPUID_7_EBX_AVX2    (1 << 5)
+#define XCR0_SSE_AVX_STATE  0x6
+
+static bool cpu_has_avx2(void)
+{
+	int info[4];
+
+	get_cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	get_cpuid(info, 1);
+	if ((info[2] & CPUID_1_ECX_OSXSAVE) == 0 ||
+	    (info[2] & CPUID_1_ECX_AVX) == 0)
+		return false;
+
+	/* the OS must also save the upper halves of the ymm registers */
+	if ((get_xcr0() & XCR0_SSE_AVX_STATE) != XCR0_SSE_AVX_STATE)
+		return false;
+
+	get_cpuid(info, 7);
+	return (info[1] & CPUID_7_EBX_AVX2) != 0;
+}
+
+/* libobs itself requires SSE2, so those kernels are safe to use before
+ * format_conversion_init has been called */
+static enum format_conversion_impl cur_impl = FORMAT_CONVERSION_IMPL_SSE2;
+static const struct format_conversion_funcs *funcs = &format_conversion_sse2;
+
+bool format_conversion_impl_supported(enum format_conversion_impl impl)
+{
+	switch (impl) {
+	case FORMAT_CONVERSION_IMPL_C:    return true;
+	case FORMAT_CONVERSION_IMPL_SSE2: return true;
+	case FORMAT_CONVERSION_IMPL_AVX2: return cpu_has_avx2();
+	}
+
+	return false;
+}
+
+const char *format_conversion_impl_name(enum format_conversion_impl impl)
+{
+	switch (impl) {
+	case FORMAT_CONVERSION_IMPL_C:    return "C";
+	case FORMAT_CONVERSION_IMPL_SSE2: return "SSE2";
+	case FORMAT_CONVERSION_IMPL_AVX2: return "AVX2";
+	}
+
+	return "Unknown";
+}
+
+bool format_conversion_set_impl(enum format_conversion_impl impl)
+{
+	if (!format_conversion_impl_supported(impl))
+		return false;
+
+	switch (impl) {
+	case FORMAT_CONVERSION_IMPL_C:    funcs = &format_conversion_c; break;
+	case FORMAT_CONVERSION_IMPL_SSE2: funcs = &format_conversion_sse2; break;
+	case FORMAT_CONVERSION_IMPL_AVX2: funcs = &format_conversion_avx2; break;
 	}
+
+	cur_impl = impl;
+	return true;
+}
+
+enum format_conversion_impl format_conversion_get_impl(void)
+{
+	return cur_impl;
+}
+
+void format_conversion_init(void)
+{
+	if (!format_conversion_set_impl(FORMAT_CONVERSION_IMPL_AVX2))
+		format_conversion_set_impl(FORMAT_CONVERSION_IMPL_SSE2);
+
+	blog(LOG_INFO, "Format conversion: using %s kernels",
+			format_conversion_impl_name(cur_impl));
+}
+
+void compress_uyvx_to_i420(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	funcs->compress_uyvx_to_i420(input, in_linesize, start_y, end_y,
+			output, out_linesize);
+}
+
+void compress_uyvx_to_nv12(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	funcs->compress_uyvx_to_nv12(input, in_linesize, start_y, end_y,
+			output, out_linesize);
+}
+
+void convert_uyvx_to_i444(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output[], const uint32_t out_linesize[])
+{
+	funcs->convert_uyvx_to_i444(input, in_linesize, start_y, end_y,
+			output, out_linesize);
+}
+
+void decompress_420(
+		const uint8_t *const input[], const uint32_t in_linesize[],
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize)
+{
+	funcs->decompress_420(input, in_linesize, start_y, end_y,
+			output, out_linesize);
+}
+
+void decompress_nv12(
+		const uint8_t *const input[], const uint32_t in_linesize[],
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize)
+{
+	funcs->decompress_nv12(input, in_linesize, start_y, end_y,
+			output, out_linesize);
+}
+
+void decompress_422(
+		const uint8_t *input, uint32_t in_linesize,
+		uint32_t start_y, uint32_t end_y,
+		uint8_t *output, uint32_t out_linesize,
+		bool leading_lum)
+{
+	funcs->decompress_422(input, in_linesize, start_y, end_y,
+			output, out_linesize, leading_lum);
 }
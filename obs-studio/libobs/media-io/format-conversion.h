@@ -23,6 +23,27 @@
 extern "C" {
 #endif
 
+enum format_conversion_impl {
+	FORMAT_CONVERSION_IMPL_C,
+	FORMAT_CONVERSION_IMPL_SSE2,
+	FORMAT_CONVERSION_IMPL_AVX2
+};
+
+/*
+ * Selects the fastest kernels the CPU supports.  Called once by obs_startup;
+ * until then the SSE2 kernels are used.
+ */
+EXPORT void format_conversion_init(void);
+
+EXPORT bool format_conversion_impl_supported(
+		enum format_conversion_impl impl);
+EXPORT const char *format_conversion_impl_name(
+		enum format_conversion_impl impl);
+
+/* Forces a specific set of kernels, returns false if the CPU lacks support */
+EXPORT bool format_conversion_set_impl(enum format_conversion_impl impl);
+EXPORT enum format_conversion_impl format_conversion_get_impl(void);
+
 /*
  * Functions for converting to and from packed 444 YUV
  */
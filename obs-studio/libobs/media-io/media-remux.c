@@ -19,16 +19,40 @@
 
 #include "../util/base.h"
 #include "../util/bmem.h"
+#include "../util/circlebuf.h"
+#include "../util/darray.h"
 #include "../util/platform.h"
+#include "../util/threading.h"
 
 #include <libavformat/avformat.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#define REMUX_BATCH_PACKETS 256
+#define REMUX_BATCH_SIZE    (4 * 1024 * 1024)
+#define REMUX_MAX_BATCHES   8
+
+struct remux_batch {
+	DARRAY(AVPacket) packets;
+	int64_t pos;
+	int ret;
+	bool last;
+};
+
 struct media_remux_job {
 	int64_t in_size;
 	AVFormatContext *ifmt_ctx, *ofmt_ctx;
+
+	pthread_t read_thread;
+	pthread_mutex_t batch_mutex;
+	struct circlebuf batches;
+	os_sem_t *batch_ready;
+	os_sem_t *batch_space;
+	volatile bool stop;
+
+	uint64_t start_time;
+	int64_t bytes_written;
 };
 
 static inline void init_size(media_remux_job_t job, const char *in_filename)
@@ -161,6 +185,185 @@ static inline void process_packet(AVPacket *pkt,
 
 }
 
+static inline void free_batch(struct remux_batch *batch)
+{
+	for (size_t i = 0; i < batch->packets.num; i++)
+		av_free_packet(&batch->packets.array[i]);
+
+	da_free(batch->packets);
+	bfree(batch);
+}
+
+static struct remux_batch *read_batch(media_remux_job_t job)
+{
+	struct remux_batch *batch = bzalloc(sizeof(*batch));
+	size_t size = 0;
+
+	da_reserve(batch->packets, REMUX_BATCH_PACKETS);
+
+	while (batch->packets.num < REMUX_BATCH_PACKETS &&
+	       size < REMUX_BATCH_SIZE) {
+		AVPacket pkt;
+
+		batch->ret = av_read_frame(job->ifmt_ctx, &pkt);
+		if (batch->ret < 0) {
+			batch->last = true;
+			break;
+		}
+
+		/* the demuxer may reuse the data of packets without a buffer
+		 * on the next read, and this one is kept until it's written */
+		batch->ret = av_dup_packet(&pkt);
+		if (batch->ret < 0) {
+			av_free_packet(&pkt);
+			batch->last = true;
+			break;
+		}
+
+		if (pkt.pos != -1)
+			batch->pos = pkt.pos;
+
+		size += pkt.size;
+		da_push_back(batch->packets, &pkt);
+	}
+
+	return batch;
+}
+
+static void *read_thread(void *data)
+{
+	media_remux_job_t job = data;
+	bool last = false;
+
+	os_set_thread_name("media_remux: read_thread");
+
+	while (!last) {
+		struct remux_batch *batch;
+
+		os_sem_wait(job->batch_space);
+		if (os_atomic_load_bool(&job->stop))
+			break;
+
+		batch = read_batch(job);
+		last = batch->last;
+
+		pthread_mutex_lock(&job->batch_mutex);
+		circlebuf_push_back(&job->batches, &batch, sizeof(batch));
+		pthread_mutex_unlock(&job->batch_mutex);
+
+		os_sem_post(job->batch_ready);
+	}
+
+	return NULL;
+}
+
+static inline bool init_read_thread(media_remux_job_t job)
+{
+	if (pthread_mutex_init(&job->batch_mutex, NULL) != 0)
+		return false;
+	if (os_sem_init(&job->batch_ready, 0) != 0)
+		goto fail_ready;
+	if (os_sem_init(&job->batch_space, REMUX_MAX_BATCHES) != 0)
+		goto fail_space;
+	if (pthread_create(&job->read_thread, NULL, read_thread, job) != 0)
+		goto fail_thread;
+
+	return true;
+
+fail_thread:
+	os_sem_destroy(job->batch_space);
+fail_space:
+	os_sem_destroy(job->batch_ready);
+fail_ready:
+	pthread_mutex_destroy(&job->batch_mutex);
+	return false;
+}
+
+static inline void free_read_thread(media_remux_job_t job)
+{
+	os_atomic_set_bool(&job->stop, true);
+	os_sem_post(job->batch_space);
+	pthread_join(job->read_thread, NULL);
+
+	while (job->batches.size) {
+		struct remux_batch *batch;
+		circlebuf_pop_front(&job->batches, &batch, sizeof(batch));
+		free_batch(batch);
+	}
+
+	circlebuf_free(&job->batches);
+	os_sem_destroy(job->batch_space);
+	os_sem_destroy(job->batch_ready);
+	pthread_mutex_destroy(&job->batch_mutex);
+}
+
+static inline int write_packet(media_remux_job_t job, AVPacket *pkt)
+{
+	int size = pkt->size;
+	int ret;
+
+	process_packet(pkt, job->ifmt_ctx->streams[pkt->stream_index],
+			job->ofmt_ctx->streams[pkt->stream_index]);
+
+	ret = av_interleaved_write_frame(job->ofmt_ctx, pkt);
+	av_free_packet(pkt);
+
+	if (ret < 0)
+		blog(LOG_ERROR, "media_remux: Error muxing packet: %s",
+				av_err2str(ret));
+	else
+		job->bytes_written += size;
+	return ret;
+}
+
+/* packets are read ahead in batches on a separate thread so demuxing and
+ * file reads overlap with muxing and file writes */
+static inline int process_batches(media_remux_job_t job,
+		media_remux_progress_callback callback, void *data)
+{
+	int ret = 0;
+
+	for (;;) {
+		struct remux_batch *batch;
+		bool last;
+
+		os_sem_wait(job->batch_ready);
+
+		pthread_mutex_lock(&job->batch_mutex);
+		circlebuf_pop_front(&job->batches, &batch, sizeof(batch));
+		pthread_mutex_unlock(&job->batch_mutex);
+
+		os_sem_post(job->batch_space);
+
+		for (size_t i = 0; i < batch->packets.num && ret >= 0; i++)
+			ret = write_packet(job, &batch->packets.array[i]);
+
+		if (ret >= 0 && batch->last) {
+			ret = batch->ret;
+			if (ret != AVERROR_EOF)
+				blog(LOG_ERROR, "media_remux: Error reading"
+						" packet: %s",
+						av_err2str(ret));
+		}
+
+		last = batch->last || ret < 0;
+
+		if (!last && callback != NULL) {
+			float progress = batch->pos / (float)job->in_size * 100.f;
+			if (!callback(data, progress))
+				last = true;
+		}
+
+		/* packets that were already written have been freed */
+		free_batch(batch);
+
+		if (last)
+			break;
+	}
+
+	return ret;
+}
+
 static inline int process_packets(media_remux_job_t job,
 		media_remux_progress_callback callback, void *data)
 {
@@ -184,17 +387,9 @@ static inline int process_packets(media_remux_job_t job,
 			throttle = 0;
 		}
 
-		process_packet(&pkt, job->ifmt_ctx->streams[pkt.stream_index],
-				job->ofmt_ctx->streams[pkt.stream_index]);
-
-		ret = av_interleaved_write_frame(job->ofmt_ctx, &pkt);
-		av_free_packet(&pkt);
-
-		if (ret < 0) {
-			blog(LOG_ERROR, "media_remux: Error muxing packet: %s",
-					av_err2str(ret));
+		ret = write_packet(job, &pkt);
+		if (ret < 0)
 			break;
-		}
 	}
 
 	return ret;
@@ -216,10 +411,21 @@ bool media_remux_job_process(media_remux_job_t job,
 		return success;
 	}
 
+	job->start_time = os_gettime_ns();
+	job->bytes_written = 0;
+
 	if (callback != NULL)
 		callback(data, 0.f);
 
-	ret = process_packets(job, callback, data);
+	if (init_read_thread(job)) {
+		ret = process_batches(job, callback, data);
+		free_read_thread(job);
+	} else {
+		blog(LOG_WARNING, "media_remux: Failed to create read thread, "
+				"remuxing without read-ahead");
+		ret = process_packets(job, callback, data);
+	}
+
 	success = ret >= 0 || ret == AVERROR_EOF;
 
 	ret = av_write_trailer(job->ofmt_ctx);
@@ -232,9 +438,27 @@ bool media_remux_job_process(media_remux_job_t job,
 	if (callback != NULL)
 		callback(data, 100.f);
 
+	blog(LOG_INFO, "media_remux: Remuxed %.1f MB at %.1f MB/s",
+			job->bytes_written / (1024.0 * 1024.0),
+			media_remux_job_get_throughput(job));
+
 	return success;
 }
 
+float media_remux_job_get_throughput(media_remux_job_t job)
+{
+	double seconds;
+
+	if (!job || !job->start_time)
+		return 0.f;
+
+	seconds = (os_gettime_ns() - job->start_time) / 1000000000.0;
+	if (seconds <= 0.0)
+		return 0.f;
+
+	return (float)(job->bytes_written / (1024.0 * 1024.0) / seconds);
+}
+
 void media_remux_job_destroy(media_remux_job_t job)
 {
 	if (!job)
@@ -34,6 +34,9 @@ EXPORT bool media_remux_job_process(media_remux_job_t job,
 		media_remux_progress_callback callback, void *data);
 EXPORT void media_remux_job_destroy(media_remux_job_t job);
 
+/* MB/s written so far, can be called from the progress callback */
+EXPORT float media_remux_job_get_throughput(media_remux_job_t job);
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,11 +32,28 @@ extern profiler_name_store_t *obs_get_profiler_name_store(void);
 
 #define MAX_CONVERT_BUFFERS 3
 #define MAX_CACHE_SIZE 16
-
+#define MAX_QUEUE_DEPTH 32
+
+/*
+ * The frame cache is a single-producer/single-consumer ring: the graphics
+ * thread fills the slot at write_idx and the video thread consumes the slot
+ * at read_idx.  Both indices only ever increase and are each written by one
+ * thread, so handing a frame over needs no lock.
+ *
+ * When the ring is full the producer instead adds its frame count to the
+ * most recently written slot (that frame gets output again).  count reaching
+ * zero is final, so both sides change it with compare-and-swap.
+ */
 struct cached_frame_info {
 	struct video_data frame;
-	int skipped;
-	int count;
+	volatile long     skipped;
+	volatile long     count;
+};
+
+struct queued_frame {
+	struct video_frame        frame;
+	uint64_t                  timestamp;
+	uint64_t                  queued_time;
 };
 
 struct video_input {
@@ -44,9 +61,47 @@ struct video_input {
 	video_scaler_t            *scaler;
 	struct video_frame        frame[MAX_CONVERT_BUFFERS];
 	int                       cur_frame;
+	volatile long             refs;
 
 	void (*callback)(void *param, struct video_data *frame);
 	void *param;
+
+	volatile long             total_frames;
+	volatile long             dropped_frames;
+
+	/*
+	 * Threaded inputs: the video thread copies each frame in to the
+	 * queue and the input's own thread calls the callback, so a slow
+	 * input only ever holds up itself.  The queue frames are swapped with
+	 * cur_frame when dequeued so the callback can run unlocked.
+	 */
+	size_t                    queue_depth;
+	enum video_input_drop_policy drop_policy;
+
+	pthread_t                 thread;
+	bool                      thread_active;
+	volatile bool             stop;
+	const char                *profile_name;
+
+	os_sem_t                  *queue_sem;
+	pthread_mutex_t           queue_mutex;
+	struct queued_frame       queue[MAX_QUEUE_DEPTH];
+	size_t                    queue_start;
+	size_t                    queue_size;
+	struct queued_frame       dequeued;
+	uint64_t                  lag;
+	uint64_t                  max_lag;
+};
+
+/*
+ * Connected inputs are published as immutable, refcounted lists.  Connecting
+ * or disconnecting builds a new list and swaps it in; the video thread holds
+ * a reference to the list it is outputting to, and whichever side drops the
+ * last reference frees the list (and any inputs no longer in a list).
+ */
+struct video_input_list {
+	volatile long                refs;
+	DARRAY(struct video_input*)  inputs;
 };
 
 static inline void video_input_free(struct video_input *input)
@@ -54,31 +109,149 @@ static inline void video_input_free(struct video_input *input)
 	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
 		video_frame_free(&input->frame[i]);
 	video_scaler_destroy(input->scaler);
+
+	if (input->queue_depth) {
+		for (size_t i = 0; i < input->queue_depth; i++)
+			video_frame_free(&input->queue[i].frame);
+		video_frame_free(&input->dequeued.frame);
+
+		os_sem_destroy(input->queue_sem);
+		pthread_mutex_destroy(&input->queue_mutex);
+	}
+
+	bfree(input);
 }
+
+static inline void video_input_release(struct video_input *input)
+{
+	if (os_atomic_dec_long(&input->refs) == 0)
+		video_input_free(input);
+}
+
+static void video_input_list_free(struct video_input_list *list)
+{
+	for (size_t i = 0; i < list->inputs.num; i++)
+		video_input_release(list->inputs.array[i]);
+	da_free(list->inputs);
+	bfree(list);
+}
+
+static void video_input_list_release(struct video_input_list *list)
+{
+	if (list && os_atomic_dec_long(&list->refs) == 0)
+		video_input_list_free(list);
+}
+
 //视频输出
 struct video_output {
 	struct video_output_info   info;
 
 	pthread_t                  thread;
-	pthread_mutex_t            data_mutex;
 	bool                       stop;
 
 	os_sem_t                   *update_semaphore;
 	uint64_t                   frame_time;
-	uint32_t                   skipped_frames;
-	uint32_t                   total_frames;
+	volatile long              skipped_frames;
+	volatile long              total_frames;
 
 	bool                       initialized;
 
+	/* serializes connect/disconnect */
 	pthread_mutex_t            input_mutex;
-	DARRAY(struct video_input) inputs;
 
-	size_t                     available_frames;
-	size_t                     first_added;
-	size_t                     last_added;
+	/* only held to swap or take a reference to the current list */
+	pthread_mutex_t            list_mutex;
+	pthread_cond_t             list_released;
+	struct video_input_list    *inputs;
+	volatile long              num_inputs;
+
+	volatile long              write_idx;
+	volatile long              read_idx;
 	struct cached_frame_info   cache[MAX_CACHE_SIZE];
 };
 
+static inline struct cached_frame_info *get_cached_frame(
+		struct video_output *video, unsigned long idx)
+{
+	return &video->cache[idx % video->info.cache_size];
+}
+
+static inline unsigned long cached_frames(struct video_output *video)
+{
+	return (unsigned long)os_atomic_load_long(&video->write_idx) -
+		(unsigned long)os_atomic_load_long(&video->read_idx);
+}
+
+/* adds to a counter unless it has already dropped to zero */
+static inline bool add_if_nonzero(volatile long *val, long add)
+{
+	long cur;
+
+	do {
+		cur = os_atomic_load_long(val);
+		if (cur == 0)
+			return false;
+	} while (!os_atomic_compare_swap_long(val, cur, cur + add));
+
+	return true;
+}
+
+static inline void add_long(volatile long *val, long add)
+{
+	long cur;
+
+	do {
+		cur = os_atomic_load_long(val);
+	} while (!os_atomic_compare_swap_long(val, cur, cur + add));
+}
+
+static inline bool dec_if_nonzero(volatile long *val, long *remaining)
+{
+	long cur;
+
+	do {
+		cur = os_atomic_load_long(val);
+		if (cur == 0)
+			return false;
+	} while (!os_atomic_compare_swap_long(val, cur, cur - 1));
+
+	*remaining = cur - 1;
+	return true;
+}
+
+static struct video_input_list *video_get_inputs(struct video_output *video)
+{
+	struct video_input_list *list;
+
+	pthread_mutex_lock(&video->list_mutex);
+	list = video->inputs;
+	if (list)
+		os_atomic_inc_long(&list->refs);
+	pthread_mutex_unlock(&video->list_mutex);
+
+	return list;
+}
+
+/* drops the video thread's reference, waking up anyone waiting in
+ * video_wait_for_list if the list has since been replaced */
+static void video_put_inputs(struct video_output *video,
+		struct video_input_list *list)
+{
+	bool free_list;
+
+	if (!list)
+		return;
+
+	pthread_mutex_lock(&video->list_mutex);
+	free_list = os_atomic_dec_long(&list->refs) == 0;
+	if (list != video->inputs)
+		pthread_cond_broadcast(&video->list_released);
+	pthread_mutex_unlock(&video->list_mutex);
+
+	if (free_list)
+		video_input_list_free(list);
+}
+
 /* ------------------------------------------------------------------------- */
 
 static inline bool scale_video_output(struct video_input *input,
@@ -111,55 +284,166 @@ static inline bool scale_video_output(struct video_input *input,
 
 	return success;
 }
-//输出当前帧
-static inline bool video_output_cur_frame(struct video_output *video)
+static void video_input_queue_frame(struct video_output *video,
+		struct video_input *input, const struct video_data *data)
 {
-    struct cached_frame_info *frame_info;
-    bool complete;
-    bool skipped;
+	struct queued_frame *qf;
+	bool new_frame = true;
 
-    /* -------------------------------- */
+	pthread_mutex_lock(&input->queue_mutex);
 
-    pthread_mutex_lock(&video->data_mutex);
+	if (input->queue_size == input->queue_depth) {
+		os_atomic_inc_long(&input->dropped_frames);
 
-    frame_info = &video->cache[video->first_added];
+		if (input->drop_policy == VIDEO_INPUT_DROP_NEWEST) {
+			pthread_mutex_unlock(&input->queue_mutex);
+			return;
+		}
 
-    pthread_mutex_unlock(&video->data_mutex);
+		/* replace the oldest frame, which was already posted */
+		input->queue_start = (input->queue_start + 1) %
+			input->queue_depth;
+		input->queue_size--;
+		new_frame = false;
+	}
 
-    /* -------------------------------- */
+	qf = &input->queue[(input->queue_start + input->queue_size) %
+		input->queue_depth];
+	video_frame_copy(&qf->frame, (const struct video_frame*)data,
+			video->info.format, video->info.height);
+	qf->timestamp   = data->timestamp;
+	qf->queued_time = os_gettime_ns();
+	input->queue_size++;
 
-    pthread_mutex_lock(&video->input_mutex);
+	pthread_mutex_unlock(&input->queue_mutex);
 
-    for (size_t i = 0; i < video->inputs.num; i++) {
-        struct video_input *input = video->inputs.array+i;
-        struct video_data frame = frame_info->frame;
+	if (new_frame)
+		os_sem_post(input->queue_sem);
+}
 
-        if (scale_video_output(input, &frame));
-            input->callback(input->param, &frame);//回调,会调用到receive_video函数对当前帧进行编码
-    }
+static bool video_input_dequeue_frame(struct video_input *input,
+		struct video_data *data)
+{
+	struct queued_frame *qf;
+	struct video_frame  swap;
 
-    pthread_mutex_unlock(&video->input_mutex);
+	pthread_mutex_lock(&input->queue_mutex);
 
-    /* -------------------------------- */
+	if (!input->queue_size) {
+		pthread_mutex_unlock(&input->queue_mutex);
+		return false;
+	}
 
-    pthread_mutex_lock(&video->data_mutex);
+	qf = &input->queue[input->queue_start];
+	swap                   = input->dequeued.frame;
+	input->dequeued        = *qf;
+	qf->frame              = swap;
 
-    frame_info->frame.timestamp += video->frame_time;
-    complete = --frame_info->count == 0;
-    skipped = frame_info->skipped > 0;
+	input->lag = os_gettime_ns() - input->dequeued.queued_time;
+	if (input->lag > input->max_lag)
+		input->max_lag = input->lag;
 
-    if (complete) {
-        if (++video->first_added == video->info.cache_size)
-            video->first_added = 0;
+	input->queue_start = (input->queue_start + 1) % input->queue_depth;
+	input->queue_size--;
 
-        if (++video->available_frames == video->info.cache_size)
-            video->last_added = video->first_added;
-    } else if (skipped) {
-        --frame_info->skipped;
-        ++video->skipped_frames;
-    }
+	pthread_mutex_unlock(&input->queue_mutex);
 
-    pthread_mutex_unlock(&video->data_mutex);
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		data->data[i]     = input->dequeued.frame.data[i];
+		data->linesize[i] = input->dequeued.frame.linesize[i];
+	}
+	data->timestamp = input->dequeued.timestamp;
+	return true;
+}
+
+static void *video_input_thread(void *param)
+{
+	struct video_input *input = param;
+
+	os_set_thread_name("video-io: input thread");
+
+	while (os_sem_wait(input->queue_sem) == 0) {
+		struct video_data frame;
+
+		if (input->stop)
+			break;
+		if (!video_input_dequeue_frame(input, &frame))
+			continue;
+
+		profile_start(input->profile_name);
+
+		if (scale_video_output(input, &frame))
+			input->callback(input->param, &frame);
+
+		os_atomic_inc_long(&input->total_frames);
+
+		profile_end(input->profile_name);
+		profile_reenable_thread();
+	}
+
+	video_input_release(input);
+	return NULL;
+}
+
+static void video_input_stop_thread(struct video_input *input)
+{
+	if (!input->thread_active)
+		return;
+
+	input->thread_active = false;
+	input->stop = true;
+	os_sem_post(input->queue_sem);
+
+	/* disconnecting from the input's own callback: the thread exits
+	 * after the callback returns and drops its own reference */
+	if (pthread_equal(pthread_self(), input->thread))
+		pthread_detach(input->thread);
+	else
+		pthread_join(input->thread, NULL);
+}
+
+//输出当前帧
+static inline bool video_output_cur_frame(struct video_output *video)
+{
+	struct cached_frame_info *frame_info;
+	struct video_input_list *list;
+	long remaining = 0;
+	bool complete;
+
+	frame_info = get_cached_frame(video,
+			(unsigned long)os_atomic_load_long(&video->read_idx));
+
+	/* -------------------------------- */
+
+	list = video_get_inputs(video);
+
+	for (size_t i = 0; list && i < list->inputs.num; i++) {
+		struct video_input *input = list->inputs.array[i];
+		struct video_data frame = frame_info->frame;
+
+		if (input->queue_depth) {
+			video_input_queue_frame(video, input, &frame);
+			continue;
+		}
+
+		if (scale_video_output(input, &frame))
+			input->callback(input->param, &frame);//回调,会调用到receive_video函数对当前帧进行编码
+
+		os_atomic_inc_long(&input->total_frames);
+	}
+
+	video_put_inputs(video, list);
+
+	/* -------------------------------- */
+
+	frame_info->frame.timestamp += video->frame_time;
+	complete = !dec_if_nonzero(&frame_info->count, &remaining) ||
+		remaining == 0;
+
+	if (complete)
+		os_atomic_inc_long(&video->read_idx);
+	else if (dec_if_nonzero(&frame_info->skipped, &remaining))
+		os_atomic_inc_long(&video->skipped_frames);
 
 	/* -------------------------------- */
 
@@ -183,10 +467,10 @@ static void *video_thread(void *param)
 
 		profile_start(video_thread_name);
 		while (!video->stop && !video_output_cur_frame(video)) {
-			video->total_frames++;
+			os_atomic_inc_long(&video->total_frames);
 		}
 
-		video->total_frames++;
+		os_atomic_inc_long(&video->total_frames);
 		profile_end(video_thread_name);
 
 		profile_reenable_thread();
@@ -207,6 +491,8 @@ static inline void init_cache(struct video_output *video)
 {
 	if (video->info.cache_size > MAX_CACHE_SIZE)
 		video->info.cache_size = MAX_CACHE_SIZE;
+	if (video->info.cache_size == 0)
+		video->info.cache_size = 1;
 
 	for (size_t i = 0; i < video->info.cache_size; i++) {
 		struct video_frame *frame;
@@ -215,8 +501,6 @@ static inline void init_cache(struct video_output *video)
 		video_frame_init(frame, video->info.format,
 				video->info.width, video->info.height);
 	}
-
-	video->available_frames = video->info.cache_size;
 }
 
 int video_output_open(video_t **video, struct video_output_info *info)
@@ -240,10 +524,12 @@ int video_output_open(video_t **video, struct video_output_info *info)
 		goto fail;
 	if (pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0)
 		goto fail;
-	if (pthread_mutex_init(&out->data_mutex, &attr) != 0)
-		goto fail;
 	if (pthread_mutex_init(&out->input_mutex, &attr) != 0)
 		goto fail;
+	if (pthread_mutex_init(&out->list_mutex, NULL) != 0)
+		goto fail;
+	if (pthread_cond_init(&out->list_released, NULL) != 0)
+		goto fail;
 	if (os_sem_init(&out->update_semaphore, 0) != 0)
 		goto fail;
     if (pthread_create(&out->thread, NULL, video_thread, out) != 0)//video_thread线程创建
@@ -267,25 +553,29 @@ void video_output_close(video_t *video)
 
 	video_output_stop(video);
 
-	for (size_t i = 0; i < video->inputs.num; i++)
-		video_input_free(&video->inputs.array[i]);
-	da_free(video->inputs);
+	for (size_t i = 0; video->inputs && i < video->inputs->inputs.num; i++)
+		video_input_stop_thread(video->inputs->inputs.array[i]);
+	video_input_list_release(video->inputs);
 
 	for (size_t i = 0; i < video->info.cache_size; i++)
 		video_frame_free((struct video_frame*)&video->cache[i]);
 
 	os_sem_destroy(video->update_semaphore);
-	pthread_mutex_destroy(&video->data_mutex);
 	pthread_mutex_destroy(&video->input_mutex);
+	pthread_mutex_destroy(&video->list_mutex);
+	pthread_cond_destroy(&video->list_released);
 	bfree(video);
 }
 
+/* must be called with input_mutex held */
 static size_t video_get_input_idx(const video_t *video,
 		void (*callback)(void *param, struct video_data *frame),
 		void *param)
 {
-	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array+i;
+	const struct video_input_list *list = video->inputs;
+
+	for (size_t i = 0; list && i < list->inputs.num; i++) {
+		struct video_input *input = list->inputs.array[i];
 		if (input->callback == callback && input->param == param)
 			return i;
 	}
@@ -293,6 +583,94 @@ static size_t video_get_input_idx(const video_t *video,
 	return DARRAY_INVALID;
 }
 
+/* copies the current input list, leaving out skip_idx and appending
+ * new_input if given, and returns the old list for the caller to release.
+ * must be called with input_mutex held */
+static struct video_input_list *video_replace_inputs(
+		struct video_output *video,
+		size_t skip_idx, struct video_input *new_input)
+{
+	struct video_input_list *old_list = video->inputs;
+	struct video_input_list *new_list;
+
+	new_list = bzalloc(sizeof(struct video_input_list));
+	new_list->refs = 1;
+
+	for (size_t i = 0; old_list && i < old_list->inputs.num; i++) {
+		struct video_input *input = old_list->inputs.array[i];
+
+		if (i == skip_idx)
+			continue;
+
+		os_atomic_inc_long(&input->refs);
+		da_push_back(new_list->inputs, &input);
+	}
+
+	if (new_input)
+		da_push_back(new_list->inputs, &new_input);
+
+	pthread_mutex_lock(&video->list_mutex);
+	video->inputs = new_list;
+	pthread_mutex_unlock(&video->list_mutex);
+
+	os_atomic_set_long(&video->num_inputs, (long)new_list->inputs.num);
+	return old_list;
+}
+
+/* once the video thread has dropped its reference to a replaced list, inputs
+ * that are not in the new list will not receive any more frames.  the caller
+ * owns one reference to the list and must not hold input_mutex. */
+static void video_wait_for_list(struct video_output *video,
+		struct video_input_list *list)
+{
+	if (!list || !video->initialized ||
+	    pthread_equal(pthread_self(), video->thread))
+		return;
+
+	pthread_mutex_lock(&video->list_mutex);
+	while (os_atomic_load_long(&list->refs) > 1)
+		pthread_cond_wait(&video->list_released, &video->list_mutex);
+	pthread_mutex_unlock(&video->list_mutex);
+}
+
+static bool video_input_start_thread(struct video_input *input,
+		struct video_output *video,
+		const struct video_input_dispatch *dispatch)
+{
+	if (pthread_mutex_init(&input->queue_mutex, NULL) != 0)
+		return false;
+	if (os_sem_init(&input->queue_sem, 0) != 0) {
+		pthread_mutex_destroy(&input->queue_mutex);
+		return false;
+	}
+
+	input->queue_depth = dispatch->queue_depth;
+	input->drop_policy = dispatch->drop_policy;
+
+	if (input->queue_depth > MAX_QUEUE_DEPTH)
+		input->queue_depth = MAX_QUEUE_DEPTH;
+
+	for (size_t i = 0; i < input->queue_depth; i++)
+		video_frame_init(&input->queue[i].frame, video->info.format,
+				video->info.width, video->info.height);
+	video_frame_init(&input->dequeued.frame, video->info.format,
+			video->info.width, video->info.height);
+
+	input->profile_name = profile_store_name(obs_get_profiler_name_store(),
+			"video_input_thread(%s)", video->info.name);
+
+	/* the thread holds a reference until it exits */
+	os_atomic_inc_long(&input->refs);
+	if (pthread_create(&input->thread, NULL, video_input_thread,
+				input) != 0) {
+		os_atomic_dec_long(&input->refs);
+		return false;
+	}
+
+	input->thread_active = true;
+	return true;
+}
+
 static inline bool video_input_init(struct video_input *input,
 		struct video_output *video)
 {
@@ -333,6 +711,16 @@ bool video_output_connect(video_t *video,
 		const struct video_scale_info *conversion,
 		void (*callback)(void *param, struct video_data *frame),
 		void *param)
+{
+	return video_output_connect_threaded(video, conversion, NULL,
+			callback, param);
+}
+
+bool video_output_connect_threaded(video_t *video,
+		const struct video_scale_info *conversion,
+		const struct video_input_dispatch *dispatch,
+		void (*callback)(void *param, struct video_data *frame),
+		void *param)
 {
 	bool success = false;
 
@@ -341,34 +729,42 @@ bool video_output_connect(video_t *video,
 
 	pthread_mutex_lock(&video->input_mutex);
 
-	if (video->inputs.num == 0) {
-		video->skipped_frames = 0;
-		video->total_frames = 0;
+	if (os_atomic_load_long(&video->num_inputs) == 0) {
+		os_atomic_set_long(&video->skipped_frames, 0);
+		os_atomic_set_long(&video->total_frames, 0);
 	}
 
 	if (video_get_input_idx(video, callback, param) == DARRAY_INVALID) {
-		struct video_input input;
-		memset(&input, 0, sizeof(input));
+		struct video_input *input;
+		input = bzalloc(sizeof(struct video_input));
 
-		input.callback = callback;
-		input.param    = param;
+		input->callback = callback;
+		input->param    = param;
+		input->refs     = 1;
 
 		if (conversion) {
-			input.conversion = *conversion;
+			input->conversion = *conversion;
 		} else {
-			input.conversion.format    = video->info.format;
-			input.conversion.width     = video->info.width;
-			input.conversion.height    = video->info.height;
+			input->conversion.format    = video->info.format;
+			input->conversion.width     = video->info.width;
+			input->conversion.height    = video->info.height;
 		}
 
-		if (input.conversion.width == 0)
-			input.conversion.width = video->info.width;
-		if (input.conversion.height == 0)
-			input.conversion.height = video->info.height;
+		if (input->conversion.width == 0)
+			input->conversion.width = video->info.width;
+		if (input->conversion.height == 0)
+			input->conversion.height = video->info.height;
+
+		success = video_input_init(input, video);
+		if (success && dispatch && dispatch->queue_depth)
+			success = video_input_start_thread(input, video,
+					dispatch);
 
-		success = video_input_init(&input, video);
 		if (success)
-			da_push_back(video->inputs, &input);
+			video_input_list_release(video_replace_inputs(video,
+					DARRAY_INVALID, input));
+		else
+			video_input_release(input);
 	}
 
 	pthread_mutex_unlock(&video->input_mutex);
@@ -380,6 +776,9 @@ void video_output_disconnect(video_t *video,
 		void (*callback)(void *param, struct video_data *frame),
 		void *param)
 {
+	struct video_input_list *old_list = NULL;
+	struct video_input *input = NULL;
+
 	if (!video || !callback)
 		return;
 
@@ -387,31 +786,78 @@ void video_output_disconnect(video_t *video,
 
 	size_t idx = video_get_input_idx(video, callback, param);
 	if (idx != DARRAY_INVALID) {
-		video_input_free(video->inputs.array+idx);
-		da_erase(video->inputs, idx);
+		input = video->inputs->inputs.array[idx];
+		os_atomic_inc_long(&input->refs);
+
+		old_list = video_replace_inputs(video, idx, NULL);
 	}
 
-	if (video->inputs.num == 0) {
-		double percentage_skipped = (double)video->skipped_frames /
-			(double)video->total_frames * 100.0;
+	if (os_atomic_load_long(&video->num_inputs) == 0) {
+		uint32_t skipped = video_output_get_skipped_frames(video);
+		uint32_t total   = video_output_get_total_frames(video);
+		double percentage_skipped = (double)skipped /
+			(double)total * 100.0;
 
-		if (video->skipped_frames)
+		if (skipped)
 			blog(LOG_INFO, "Video stopped, number of "
 					"skipped frames due "
 					"to encoding lag: "
 					"%"PRIu32"/%"PRIu32" (%0.1f%%)",
-					video->skipped_frames,
-					video->total_frames,
-					percentage_skipped);
+					skipped, total, percentage_skipped);
 	}
 
 	pthread_mutex_unlock(&video->input_mutex);
+
+	if (input) {
+		video_wait_for_list(video, old_list);
+		video_input_list_release(old_list);
+
+		video_input_stop_thread(input);
+		video_input_release(input);
+	}
+}
+
+bool video_output_get_input_stats(video_t *video,
+		void (*callback)(void *param, struct video_data *frame),
+		void *param, struct video_input_stats *stats)
+{
+	struct video_input *input;
+	size_t idx;
+
+	if (!video || !callback || !stats)
+		return false;
+
+	pthread_mutex_lock(&video->input_mutex);
+
+	idx = video_get_input_idx(video, callback, param);
+	if (idx == DARRAY_INVALID) {
+		pthread_mutex_unlock(&video->input_mutex);
+		return false;
+	}
+
+	input = video->inputs->inputs.array[idx];
+	memset(stats, 0, sizeof(*stats));
+	stats->total_frames   = (uint32_t)os_atomic_load_long(
+			&input->total_frames);
+	stats->dropped_frames = (uint32_t)os_atomic_load_long(
+			&input->dropped_frames);
+
+	if (input->queue_depth) {
+		pthread_mutex_lock(&input->queue_mutex);
+		stats->queued_frames = (uint32_t)input->queue_size;
+		stats->lag           = input->lag;
+		stats->max_lag       = input->max_lag;
+		pthread_mutex_unlock(&input->queue_mutex);
+	}
+
+	pthread_mutex_unlock(&video->input_mutex);
+	return true;
 }
 
 bool video_output_active(const video_t *video)
 {
 	if (!video) return false;
-	return video->inputs.num != 0;
+	return os_atomic_load_long(&video->num_inputs) != 0;
 }
 
 const struct video_output_info *video_output_get_info(const video_t *video)
@@ -423,48 +869,38 @@ bool video_output_lock_frame(video_t *video, struct video_frame *frame,
 		int count, uint64_t timestamp)
 {
 	struct cached_frame_info *cfi;
-	bool locked;
+	unsigned long write_idx;
 
 	if (!video) return false;
 
-	pthread_mutex_lock(&video->data_mutex);
+	write_idx = (unsigned long)os_atomic_load_long(&video->write_idx);
 
-	if (video->available_frames == 0) {
-		video->cache[video->last_added].count += count;
-		video->cache[video->last_added].skipped += count;
-		locked = false;
+	while (cached_frames(video) == video->info.cache_size) {
+		cfi = get_cached_frame(video, write_idx - 1);
 
-	} else {
-		if (video->available_frames != video->info.cache_size) {
-			if (++video->last_added == video->info.cache_size)
-				video->last_added = 0;
+		/* fails only in the instant between the video thread
+		 * finishing the last frame and advancing read_idx */
+		if (add_if_nonzero(&cfi->count, count)) {
+			add_long(&cfi->skipped, count);
+			return false;
 		}
-
-		cfi = &video->cache[video->last_added];
-		cfi->frame.timestamp = timestamp;
-		cfi->count = count;
-		cfi->skipped = 0;
-
-		memcpy(frame, &cfi->frame, sizeof(*frame));
-
-		locked = true;
 	}
 
-	pthread_mutex_unlock(&video->data_mutex);
+	cfi = get_cached_frame(video, write_idx);
+	cfi->frame.timestamp = timestamp;
+	os_atomic_set_long(&cfi->skipped, 0);
+	os_atomic_set_long(&cfi->count, count);
 
-	return locked;
+	memcpy(frame, &cfi->frame, sizeof(*frame));
+	return true;
 }
 
 void video_output_unlock_frame(video_t *video)
 {
 	if (!video) return;
 
-	pthread_mutex_lock(&video->data_mutex);
-
-	video->available_frames--;
+	os_atomic_inc_long(&video->write_idx);
     os_sem_post(video->update_semaphore);//update_semaphore,通知video_thread线程对采集的数据进行编码
-
-	pthread_mutex_unlock(&video->data_mutex);
 }
 
 uint64_t video_output_get_frame_time(const video_t *video)
@@ -520,10 +956,10 @@ double video_output_get_frame_rate(const video_t *video)
 
 uint32_t video_output_get_skipped_frames(const video_t *video)
 {
-	return video->skipped_frames;
+	return (uint32_t)os_atomic_load_long(&video->skipped_frames);
 }
 
 uint32_t video_output_get_total_frames(const video_t *video)
 {
-	return video->total_frames;
+	return (uint32_t)os_atomic_load_long(&video->total_frames);
 }
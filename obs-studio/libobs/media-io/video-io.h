@@ -161,6 +161,46 @@ EXPORT void video_output_disconnect(video_t *video,
 		void (*callback)(void *param, struct video_data *frame),
 		void *param);
 
+/**
+ * What a threaded input does with a new frame when its queue is full.
+ */
+enum video_input_drop_policy {
+	VIDEO_INPUT_DROP_OLDEST,
+	VIDEO_INPUT_DROP_NEWEST,
+};
+
+struct video_input_dispatch {
+	/** frames that can wait for the input's thread (max 32), 0 calls the
+	 * callback from the video thread like video_output_connect */
+	size_t                       queue_depth;
+	enum video_input_drop_policy drop_policy;
+};
+
+struct video_input_stats {
+	uint32_t total_frames;
+	uint32_t dropped_frames;
+	uint32_t queued_frames;
+
+	/** nanoseconds the last/slowest frame waited in the queue */
+	uint64_t lag;
+	uint64_t max_lag;
+};
+
+/**
+ * Like video_output_connect, but the callback is called from a thread of its
+ * own fed by a bounded queue, so a slow input cannot delay the others.
+ * Frames that do not fit in the queue are dropped and counted.
+ */
+EXPORT bool video_output_connect_threaded(video_t *video,
+		const struct video_scale_info *conversion,
+		const struct video_input_dispatch *dispatch,
+		void (*callback)(void *param, struct video_data *frame),
+		void *param);
+
+EXPORT bool video_output_get_input_stats(video_t *video,
+		void (*callback)(void *param, struct video_data *frame),
+		void *param, struct video_input_stats *stats);
+
 EXPORT bool video_output_active(const video_t *video);
 
 EXPORT const struct video_output_info *video_output_get_info(
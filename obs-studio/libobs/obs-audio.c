@@ -16,6 +16,7 @@
 ******************************************************************************/
 
 #include <inttypes.h>
+#include <xmmintrin.h>
 #include "obs-internal.h"
 
 struct ts_info {
@@ -42,11 +43,39 @@ static inline size_t convert_time_to_frames(size_t sample_rate, uint64_t t)
 {
 	return (size_t)(t * (uint64_t)sample_rate / 1000000000ULL);
 }
+
+static inline void mix_float_buf(float *mix, const float *aud, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m128 m0 = _mm_add_ps(_mm_loadu_ps(mix + i),
+				_mm_loadu_ps(aud + i));
+		__m128 m1 = _mm_add_ps(_mm_loadu_ps(mix + i + 4),
+				_mm_loadu_ps(aud + i + 4));
+		__m128 m2 = _mm_add_ps(_mm_loadu_ps(mix + i + 8),
+				_mm_loadu_ps(aud + i + 8));
+		__m128 m3 = _mm_add_ps(_mm_loadu_ps(mix + i + 12),
+				_mm_loadu_ps(aud + i + 12));
+
+		_mm_storeu_ps(mix + i,      m0);
+		_mm_storeu_ps(mix + i + 4,  m1);
+		_mm_storeu_ps(mix + i + 8,  m2);
+		_mm_storeu_ps(mix + i + 12, m3);
+	}
+
+	for (; i < count; i++)
+		mix[i] += aud[i];
+}
+
 //混音（英语：Audio Mixing，常简称为mix）是把多种来源的声音，整合至一个立体音轨（Stereo）或单音音轨（Mono）中
 static inline void mix_audio(struct audio_output_data *mixes,
-		obs_source_t *source, size_t channels, size_t sample_rate,
-		struct ts_info *ts)
+		obs_source_t *source, uint32_t mixers, size_t channels,
+		size_t sample_rate, struct ts_info *ts)
 {
+	/* obs_source_audio_render leaves mixes the source isn't routed to
+	 * (or that no output uses) silent, so they can be skipped */
+	uint32_t source_mixers = source->audio_mixers & mixers;
 	size_t total_floats = AUDIO_OUTPUT_FRAMES;
 	size_t start_point = 0;
 
@@ -63,18 +92,13 @@ static inline void mix_audio(struct audio_output_data *mixes,
 	}
 
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
-		for (size_t ch = 0; ch < channels; ch++) {
-			register float *mix = mixes[mix_idx].data[ch];
-			register float *aud =
-				source->audio_output_buf[mix_idx][ch];
-			register float *end;
-
-			mix += start_point;
-			end = aud + total_floats;
+		if ((source_mixers & (1 << mix_idx)) == 0)
+			continue;
 
-			while (aud < end)
-				*(mix++) += *(aud++);
-		}
+		for (size_t ch = 0; ch < channels; ch++)
+			mix_float_buf(mixes[mix_idx].data[ch] + start_point,
+					source->audio_output_buf[mix_idx][ch],
+					total_floats);
 	}
 }
 
@@ -364,6 +388,8 @@ static inline void release_audio_sources(struct obs_core_audio *audio)
 	for (size_t i = 0; i < audio->render_order.num; i++)
 		obs_source_release(audio->render_order.array[i]);
 }
+
+static const char *mix_audio_name = "mix_audio";
 //音频回调
 bool audio_callback(void *param,
 		uint64_t start_ts_in, uint64_t end_ts_in, uint64_t *out_ts,
@@ -437,6 +463,8 @@ bool audio_callback(void *param,
 	/* ------------------------------------------------ */
 	/* mix audio */
 	if (!audio->buffering_wait_ticks) {
+		profile_start(mix_audio_name);
+
 		for (size_t i = 0; i < audio->root_nodes.num; i++) {
 			obs_source_t *source = audio->root_nodes.array[i];
 
@@ -446,11 +474,13 @@ bool audio_callback(void *param,
 			pthread_mutex_lock(&source->audio_buf_mutex);
 
 			if (source->audio_output_buf[0][0] && source->audio_ts)
-				mix_audio(mixes, source, channels, sample_rate,
-						&ts);
+				mix_audio(mixes, source, mixers, channels,
+						sample_rate, &ts);
 
 			pthread_mutex_unlock(&source->audio_buf_mutex);
 		}
+
+		profile_end(mix_audio_name);
 	}
 
 	/* ------------------------------------------------ */
@@ -148,6 +148,36 @@ void obs_parse_avc_packet(struct encoder_packet *avc_packet,
 	avc_packet->drop_priority = get_drop_priority(avc_packet->priority);
 }
 
+void obs_parse_avc_packet_priority(struct encoder_packet *packet)
+{
+	const uint8_t *nal_start, *nal_end;
+	const uint8_t *end = packet->data + packet->size;
+	int type;
+
+	/* only the NAL headers are looked at, and only up to the first slice;
+	 * every slice of a frame has the same type and reference priority */
+	nal_start = obs_avc_find_startcode(packet->data, end);
+	while (true) {
+		while (nal_start < end && !*(nal_start++));
+
+		if (nal_start == end)
+			break;
+
+		type = nal_start[0] & 0x1F;
+
+		if (type == OBS_NAL_SLICE_IDR || type == OBS_NAL_SLICE) {
+			packet->keyframe = (type == OBS_NAL_SLICE_IDR);
+			packet->priority = nal_start[0] >> 5;
+			break;
+		}
+
+		nal_end = obs_avc_find_startcode(nal_start, end);
+		nal_start = nal_end;
+	}
+
+	packet->drop_priority = get_drop_priority(packet->priority);
+}
+
 static inline bool has_start_code(const uint8_t *data)
 {
 	if (data[0] != 0 || data[1] != 0)
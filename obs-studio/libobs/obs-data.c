@@ -20,6 +20,7 @@
 #include "util/dstr.h"
 #include "util/darray.h"
 #include "util/platform.h"
+#include "util/str-hash.h"
 #include "graphics/vec2.h"
 #include "graphics/vec3.h"
 #include "graphics/vec4.h"
@@ -32,6 +33,8 @@ struct obs_data_item {
 	volatile long        ref;
 	struct obs_data      *parent;
 	struct obs_data_item *next;
+	struct obs_data_item *hash_next;
+	uint32_t             name_hash;
 	enum obs_data_type   type;
 	size_t               name_len;
 	size_t               data_len;
@@ -46,8 +49,21 @@ struct obs_data {
 	volatile long        ref;
 	char                 *json;
 	struct obs_data_item *first_item;
+	size_t               num_items;
+
+	/* name lookup table, only built once there are more than
+	 * INDEX_MIN_ITEMS items.  the item list stays the canonical (sorted)
+	 * order that everything iterates in */
+	struct obs_data_item **index;
+	size_t               index_size;
+
+	/* the same items in list order, kept alongside the index so list
+	 * positions can be found with a binary search */
+	DARRAY(struct obs_data_item*) sorted;
 };
 
+#define INDEX_MIN_ITEMS 16
+
 struct obs_data_array {
 	volatile long        ref;
 	DARRAY(obs_data_t*)   objects;
@@ -261,6 +277,170 @@ static inline void item_autoselect_data_addref(struct obs_data_item *item)
 	}
 }
 
+/* ------------------------------------------------------------------------- */
+/* Name index */
+
+static inline struct obs_data_item **get_index_slot(struct obs_data *data,
+		uint32_t hash)
+{
+	return &data->index[hash & (data->index_size - 1)];
+}
+
+static inline void index_insert(struct obs_data *data,
+		struct obs_data_item *item)
+{
+	struct obs_data_item **slot = get_index_slot(data, item->name_hash);
+
+	item->hash_next = *slot;
+	*slot = item;
+}
+
+/* returns the pointer that points to item, or NULL if it isn't indexed */
+static struct obs_data_item **index_find_ref(struct obs_data *data,
+		struct obs_data_item *item)
+{
+	struct obs_data_item **ref = get_index_slot(data, item->name_hash);
+
+	while (*ref) {
+		if (*ref == item)
+			return ref;
+		ref = &(*ref)->hash_next;
+	}
+
+	return NULL;
+}
+
+static void index_rebuild(struct obs_data *data, size_t size)
+{
+	struct obs_data_item *item = data->first_item;
+
+	bfree(data->index);
+	data->index      = bzalloc(size * sizeof(struct obs_data_item*));
+	data->index_size = size;
+
+	da_resize(data->sorted, 0);
+	da_reserve(data->sorted, size);
+
+	while (item) {
+		index_insert(data, item);
+		da_push_back(data->sorted, &item);
+		item = item->next;
+	}
+}
+
+/* returns the position of the first item in the sorted array whose name is
+ * not less than name.  only valid once the index is built.  item may be a
+ * pointer that was just reallocated and is only compared, never read */
+static size_t sorted_lower_bound(struct obs_data *data,
+		struct obs_data_item *item, const char *name)
+{
+	size_t lo = 0;
+	size_t hi = data->sorted.num;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		struct obs_data_item *mid_item = data->sorted.array[mid];
+		const char *mid_name = mid_item == item ?
+			name : get_item_name(mid_item);
+
+		if (strcmp(mid_name, name) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static size_t sorted_find(struct obs_data *data, struct obs_data_item *item,
+		const char *name)
+{
+	size_t idx = sorted_lower_bound(data, item, name);
+
+	if (idx < data->sorted.num && data->sorted.array[idx] == item)
+		return idx;
+
+	return DARRAY_INVALID;
+}
+
+static void index_add_item(struct obs_data *data, struct obs_data_item *item)
+{
+	data->num_items++;
+
+	if (data->index) {
+		if (data->num_items > data->index_size)
+			index_rebuild(data, data->index_size * 2);
+		else
+			index_insert(data, item);
+
+	} else if (data->num_items > INDEX_MIN_ITEMS) {
+		index_rebuild(data, INDEX_MIN_ITEMS * 2);
+	}
+}
+
+static void index_remove_item(struct obs_data *data,
+		struct obs_data_item *item)
+{
+	struct obs_data_item **ref;
+
+	data->num_items--;
+
+	if (data->index) {
+		size_t idx = sorted_find(data, item, get_item_name(item));
+		if (idx != DARRAY_INVALID)
+			da_erase(data->sorted, idx);
+
+		ref = index_find_ref(data, item);
+		if (ref)
+			*ref = item->hash_next;
+	}
+
+	item->hash_next = NULL;
+}
+
+/* the item was reallocated, so only compare the old pointer */
+static void index_replace_item(struct obs_data *data,
+		struct obs_data_item *old_ptr, struct obs_data_item *new_ptr)
+{
+	struct obs_data_item **ref;
+	size_t idx;
+
+	if (!data->index)
+		return;
+
+	idx = sorted_find(data, old_ptr, get_item_name(new_ptr));
+	if (idx != DARRAY_INVALID)
+		data->sorted.array[idx] = new_ptr;
+
+	ref = get_index_slot(data, new_ptr->name_hash);
+	while (*ref) {
+		if (*ref == old_ptr) {
+			*ref = new_ptr;
+			return;
+		}
+		ref = &(*ref)->hash_next;
+	}
+}
+
+static struct obs_data_item *index_get_item(struct obs_data *data,
+		const char *name)
+{
+	uint32_t hash = str_hash(name);
+	struct obs_data_item *item = *get_index_slot(data, hash);
+
+	while (item) {
+		if (item->name_hash == hash &&
+		    strcmp(get_item_name(item), name) == 0)
+			return item;
+
+		item = item->hash_next;
+	}
+
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
 static struct obs_data_item *obs_data_item_create(const char *name,
 		const void *data, size_t size, enum obs_data_type type,
 		bool default_data, bool autoselect_data)
@@ -276,10 +456,11 @@ static struct obs_data_item *obs_data_item_create(const char *name,
 
 	item = bzalloc(total_size);
 
-	item->capacity = total_size;
-	item->type     = type;
-	item->name_len = name_size;
-	item->ref      = 1;
+	item->capacity  = total_size;
+	item->type      = type;
+	item->name_len  = name_size;
+	item->name_hash = str_hash(name);
+	item->ref       = 1;
 
 	if (default_data) {
 		item->default_len = size;
@@ -300,12 +481,24 @@ static struct obs_data_item *obs_data_item_create(const char *name,
 	return item;
 }
 
+/* current may already have been reallocated, so name is passed separately
+ * and current is only compared, never dereferenced */
 static struct obs_data_item **get_item_prev_next(struct obs_data *data,
-		struct obs_data_item *current)
+		struct obs_data_item *current, const char *name)
 {
 	if (!current || !data)
 		return NULL;
 
+	if (data->index) {
+		size_t idx = sorted_find(data, current, name);
+
+		if (idx == DARRAY_INVALID)
+			return NULL;
+
+		return idx ? &data->sorted.array[idx - 1]->next :
+			&data->first_item;
+	}
+
 	struct obs_data_item **prev_next = &data->first_item;
 	struct obs_data_item *item       = data->first_item;
 
@@ -323,11 +516,12 @@ static struct obs_data_item **get_item_prev_next(struct obs_data *data,
 static inline void obs_data_item_detach(struct obs_data_item *item)
 {
 	struct obs_data_item **prev_next = get_item_prev_next(item->parent,
-			item);
+			item, get_item_name(item));
 
 	if (prev_next) {
 		*prev_next = item->next;
 		item->next = NULL;
+		index_remove_item(item->parent, item);
 	}
 }
 
@@ -335,10 +529,12 @@ static inline void obs_data_item_reattach(struct obs_data_item *old_ptr,
 		struct obs_data_item *new_ptr)
 {
 	struct obs_data_item **prev_next = get_item_prev_next(new_ptr->parent,
-			old_ptr);
+			old_ptr, get_item_name(new_ptr));
 
-	if (prev_next)
+	if (prev_next) {
 		*prev_next = new_ptr;
+		index_replace_item(new_ptr->parent, old_ptr, new_ptr);
+	}
 }
 
 static struct obs_data_item *obs_data_item_ensure_capacity(
@@ -703,6 +899,12 @@ static inline void obs_data_destroy(struct obs_data *data)
 {
 	struct obs_data_item *item = data->first_item;
 
+	/* items are released front to back, which the plain list handles
+	 * without the index */
+	bfree(data->index);
+	da_free(data->sorted);
+	data->index = NULL;
+
 	while (item) {
 		struct obs_data_item *next = item->next;
 		obs_data_item_release(&item);
@@ -765,6 +967,8 @@ bool obs_data_save_json_safe(obs_data_t *data, const char *file,
 static struct obs_data_item *get_item(struct obs_data *data, const char *name)
 {
 	if (!data) return NULL;
+	if (data->index)
+		return index_get_item(data, name);
 
 	struct obs_data_item *item = data->first_item;
 
@@ -778,6 +982,41 @@ static struct obs_data_item *get_item(struct obs_data *data, const char *name)
 	return NULL;
 }
 
+/* links a new item in to the list in name order */
+static void insert_item(struct obs_data *data, struct obs_data_item *new_item)
+{
+	const char *name = get_item_name(new_item);
+	struct obs_data_item *prev = NULL;
+	size_t idx = 0;
+
+	if (data->index) {
+		idx = sorted_lower_bound(data, NULL, name);
+		if (idx)
+			prev = data->sorted.array[idx - 1];
+	} else {
+		struct obs_data_item *item = data->first_item;
+
+		while (item && strcmp(get_item_name(item), name) < 0) {
+			prev = item;
+			item = item->next;
+		}
+	}
+
+	new_item->parent = data;
+	if (prev) {
+		new_item->next = prev->next;
+		prev->next     = new_item;
+	} else {
+		new_item->next   = data->first_item;
+		data->first_item = new_item;
+	}
+
+	if (data->index)
+		da_insert(data->sorted, idx, &new_item);
+
+	index_add_item(data, new_item);
+}
+
 static void set_item_data(struct obs_data *data, struct obs_data_item **item,
 		const char *name, const void *ptr, size_t size,
 		enum obs_data_type type,
@@ -788,31 +1027,8 @@ static void set_item_data(struct obs_data *data, struct obs_data_item **item,
 	if ((!item || (item && !*item)) && data) {
 		new_item = obs_data_item_create(name, ptr, size, type,
 				default_data, autoselect_data);
-
-		obs_data_item_t *prev = obs_data_first(data);
-		obs_data_item_t *next = obs_data_first(data);
-		obs_data_item_next(&next);
-		for (; prev && next; obs_data_item_next(&prev),
-				obs_data_item_next(&next)) {
-			if (strcmp(get_item_name(next), name) > 0)
-				break;
-		}
-
-		new_item->parent = data;
-		if (prev && strcmp(get_item_name(prev), name) < 0) {
-			prev->next     = new_item;
-			new_item->next = next;
-
-		} else {
-			data->first_item = new_item;
-			new_item->next   = prev;
-		}
-
-		if (!prev)
-			data->first_item = new_item;
-
-		obs_data_item_release(&prev);
-		obs_data_item_release(&next);
+		if (new_item)
+			insert_item(data, new_item);
 
 	} else if (default_data) {
 		obs_data_item_set_default_data(item, ptr, size, type);
@@ -115,7 +115,8 @@ static struct obs_encoder *create_encoder(const char *id,
 
 	obs_context_data_insert(&encoder->context,
 			&obs->data.encoders_mutex,
-			&obs->data.first_encoder);
+			&obs->data.first_encoder,
+			&obs->data.encoders_index);
 
 	blog(LOG_DEBUG, "encoder '%s' (%s) created", name, id);
 	return encoder;
@@ -208,8 +209,9 @@ static void add_connection(struct obs_encoder *encoder)
 		struct video_scale_info info = {0};
 		get_video_info(encoder, &info);
 
-		video_output_connect(encoder->media, &info, receive_video,
-			encoder);
+		video_output_connect_threaded(encoder->media, &info,
+				&encoder->video_dispatch, receive_video,
+				encoder);
 	}
 
 	set_encoder_active(encoder, true);
@@ -873,6 +875,17 @@ static void receive_video(void *param, struct video_data *frame)
 	if (!encoder->start_ts)
 		encoder->start_ts = frame->timestamp;
 
+	/* frames dropped by a full dispatch queue leave gaps in the
+	 * timestamps, so count frames from the timestamp instead */
+	if (encoder->video_dispatch.queue_depth) {
+		uint64_t frame_time = video_output_get_frame_time(
+				encoder->media);
+		uint64_t frames = (frame->timestamp - encoder->start_ts +
+				frame_time / 2) / frame_time;
+
+		encoder->cur_pts = (int64_t)frames * encoder->timebase_num;
+	}
+
 	enc_frame.frames = 1;
 	enc_frame.pts    = encoder->cur_pts;
 
@@ -1125,6 +1138,40 @@ enum video_format obs_encoder_get_preferred_video_format(
 	return encoder->preferred_format;
 }
 
+void obs_encoder_set_video_dispatch(obs_encoder_t *encoder,
+		size_t queue_depth, enum video_input_drop_policy drop_policy)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_set_video_dispatch"))
+		return;
+	if (encoder->info.type != OBS_ENCODER_VIDEO) {
+		blog(LOG_WARNING, "obs_encoder_set_video_dispatch: "
+				"encoder '%s' is not a video encoder",
+				obs_encoder_get_name(encoder));
+		return;
+	}
+	if (encoder_active(encoder)) {
+		blog(LOG_WARNING, "encoder '%s': Cannot change video "
+		                  "dispatch while the encoder is active",
+		                  obs_encoder_get_name(encoder));
+		return;
+	}
+
+	encoder->video_dispatch.queue_depth = queue_depth;
+	encoder->video_dispatch.drop_policy = drop_policy;
+}
+
+bool obs_encoder_get_video_stats(obs_encoder_t *encoder,
+		struct video_input_stats *stats)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_get_video_stats"))
+		return false;
+	if (encoder->info.type != OBS_ENCODER_VIDEO)
+		return false;
+
+	return video_output_get_input_stats(encoder->media, receive_video,
+			encoder, stats);
+}
+
 void obs_encoder_addref(obs_encoder_t *encoder)
 {
 	if (!encoder)
@@ -458,29 +458,42 @@ static inline void enum_bindings(obs_hotkey_binding_internal_enum_func func,
 	}
 }
 
-struct obs_hotkey_internal_find_forward {
-	obs_hotkey_id id;
-	bool          found;
-	size_t        idx;
-};
-
-static inline bool find_id_helper(void *data, size_t idx, obs_hotkey_t *hotkey)
+/*
+ * Ids are handed out in increasing order and hotkeys/pairs are only ever
+ * appended or erased, so both arrays are sorted by id and an id can be at
+ * most (id - first id) entries in.  Without gaps that entry is the one.
+ */
+static inline bool find_id(obs_hotkey_id id, size_t *idx)
 {
-	struct obs_hotkey_internal_find_forward *find = data;
-	if (hotkey->id != find->id)
+	const size_t num    = obs->hotkeys.hotkeys.num;
+	obs_hotkey_t *array = obs->hotkeys.hotkeys.array;
+	size_t lo = 0, hi;
+
+	if (!num || id < array[0].id)
+		return false;
+
+	hi = id - array[0].id;
+	if (hi >= num)
+		hi = num - 1;
+	if (array[hi].id == id) {
+		*idx = hi;
 		return true;
+	}
 
-	find->idx   = idx;
-	find->found = true;
-	return false;
-}
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
 
-static inline bool find_id(obs_hotkey_id id, size_t *idx)
-{
-	struct obs_hotkey_internal_find_forward find = {id, false, 0};
-	enum_hotkeys(find_id_helper, &find);
-	*idx = find.idx;
-	return find.found;
+		if (array[mid].id < id) {
+			lo = mid + 1;
+		} else if (array[mid].id > id) {
+			hi = mid;
+		} else {
+			*idx = mid;
+			return true;
+		}
+	}
+
+	return false;
 }
 
 static inline bool pointer_fixup_func(void *data,
@@ -510,30 +523,37 @@ static inline void fixup_pointers(void)
 	enum_bindings(pointer_fixup_func, NULL);
 }
 
-struct obs_hotkey_internal_find_pair_forward {
-	obs_hotkey_pair_id id;
-	bool               found;
-	size_t             idx;
-};
-
-static inline bool find_pair_id_helper(size_t idx, obs_hotkey_pair_t *pair,
-		void *data)
+static inline bool find_pair_id(obs_hotkey_pair_id id, size_t *idx)
 {
-	struct obs_hotkey_internal_find_pair_forward *find = data;
-	if (pair->pair_id != find->id)
+	const size_t num         = obs->hotkeys.hotkey_pairs.num;
+	obs_hotkey_pair_t *array = obs->hotkeys.hotkey_pairs.array;
+	size_t lo = 0, hi;
+
+	if (!num || id < array[0].pair_id)
+		return false;
+
+	hi = id - array[0].pair_id;
+	if (hi >= num)
+		hi = num - 1;
+	if (array[hi].pair_id == id) {
+		*idx = hi;
 		return true;
+	}
 
-	find->idx   = idx;
-	find->found = true;
-	return false;
-}
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
 
-static inline bool find_pair_id(obs_hotkey_pair_id id, size_t *idx)
-{
-	struct obs_hotkey_internal_find_pair_forward find = {id, false, 0};
-	enum_hotkey_pairs(find_pair_id_helper, &find);
-	*idx = find.idx;
-	return find.found;
+		if (array[mid].pair_id < id) {
+			lo = mid + 1;
+		} else if (array[mid].pair_id > id) {
+			hi = mid;
+		} else {
+			*idx = mid;
+			return true;
+		}
+	}
+
+	return false;
 }
 
 static inline bool pair_pointer_fixup_func(size_t idx,
@@ -589,6 +609,8 @@ static inline void create_binding(obs_hotkey_t *hotkey,
 	binding->key = combo;
 	binding->hotkey_id = hotkey->id;
 	binding->hotkey    = hotkey;
+
+	obs->hotkeys.bindings_by_key_dirty = true;
 }
 
 static inline void load_binding(obs_hotkey_t *hotkey, obs_data_t *data)
@@ -877,44 +899,36 @@ obs_data_t *obs_hotkeys_save_source(obs_source_t *source)
 	return result;
 }
 
-struct binding_find_data {
-	obs_hotkey_id id;
-	size_t *idx;
-	bool found;
-};
-
-static inline bool binding_finder(void *data,
-		size_t idx, obs_hotkey_binding_t *binding)
-{
-	struct binding_find_data *find = data;
-	if (binding->hotkey_id != find->id)
-		return true;
-
-	*find->idx  = idx;
-	find->found = true;
-	return false;
-}
-
-static inline bool find_binding(obs_hotkey_id id, size_t *idx)
-{
-	struct binding_find_data data = {id, idx, false};
-	enum_bindings(binding_finder, &data);
-	return data.found;
-}
-
 static inline void release_pressed_binding(obs_hotkey_binding_t *binding);
 
 static inline void remove_bindings(obs_hotkey_id id)
 {
-	size_t idx;
-	while (find_binding(id, &idx)) {
+	size_t num, kept = 0;
+
+	for (size_t i = 0; i < obs->hotkeys.bindings.num; i++) {
 		obs_hotkey_binding_t *binding =
-			&obs->hotkeys.bindings.array[idx];
+			&obs->hotkeys.bindings.array[i];
 
-		if (binding->pressed)
+		if (binding->hotkey_id == id && binding->pressed)
 			release_pressed_binding(binding);
+	}
+
+	/* compact in one pass instead of erasing bindings one by one */
+	num = obs->hotkeys.bindings.num;
+	for (size_t i = 0; i < num; i++) {
+		obs_hotkey_binding_t *binding =
+			&obs->hotkeys.bindings.array[i];
+
+		if (binding->hotkey_id == id)
+			continue;
+		if (kept != i)
+			obs->hotkeys.bindings.array[kept] = *binding;
+		kept++;
+	}
 
-		da_erase(obs->hotkeys.bindings, idx);
+	if (kept != num) {
+		da_resize(obs->hotkeys.bindings, kept);
+		obs->hotkeys.bindings_by_key_dirty = true;
 	}
 }
 
@@ -1069,6 +1083,7 @@ void obs_hotkeys_free(void)
 		release_registerer(&hotkeys[i]);
 	}
 	da_free(obs->hotkeys.bindings);
+	da_free(obs->hotkeys.bindings_by_key);
 	da_free(obs->hotkeys.hotkeys);
 	da_free(obs->hotkeys.hotkey_pairs);
 
@@ -1249,23 +1264,31 @@ void obs_hotkey_enable_strict_modifiers(bool enable)
 	unlock();
 }
 
-struct obs_query_hotkeys_helper {
-	uint32_t modifiers;
-	bool     no_press;
-	bool     strict_modifiers;
-};
+static int cmp_binding_keys(const void *a, const void *b)
+{
+	const obs_hotkey_binding_t *array = obs->hotkeys.bindings.array;
+	obs_key_t key_a = array[*(const size_t*)a].key.key;
+	obs_key_t key_b = array[*(const size_t*)b].key.key;
 
-static inline bool query_hotkey(void *data,
-		size_t idx, obs_hotkey_binding_t *binding)
+	return (key_a > key_b) - (key_a < key_b);
+}
+
+static void update_bindings_by_key(void)
 {
-	UNUSED_PARAMETER(idx);
+	const size_t num = obs->hotkeys.bindings.num;
+
+	if (!obs->hotkeys.bindings_by_key_dirty)
+		return;
 
-	struct obs_query_hotkeys_helper *param =
-		(struct obs_query_hotkeys_helper*)data;
-	handle_binding(binding, param->modifiers, param->no_press,
-			param->strict_modifiers, NULL);
+	da_resize(obs->hotkeys.bindings_by_key, num);
+	for (size_t i = 0; i < num; i++)
+		obs->hotkeys.bindings_by_key.array[i] = i;
 
-	return true;
+	if (num)
+		qsort(obs->hotkeys.bindings_by_key.array, num, sizeof(size_t),
+				cmp_binding_keys);
+
+	obs->hotkeys.bindings_by_key_dirty = false;
 }
 
 static inline void query_hotkeys()
@@ -1280,12 +1303,24 @@ static inline void query_hotkeys()
 	if (is_pressed(OBS_KEY_META))
 		modifiers |= INTERACT_COMMAND_KEY;
 
-	struct obs_query_hotkeys_helper param = {
-		modifiers,
-		obs->hotkeys.thread_disable_press,
-		obs->hotkeys.strict_modifiers,
-	};
-	enum_bindings(query_hotkey, &param);
+	bool no_press         = obs->hotkeys.thread_disable_press;
+	bool strict_modifiers = obs->hotkeys.strict_modifiers;
+
+	update_bindings_by_key();
+
+	/* query each bound key once, however many bindings use it */
+	const size_t num = obs->hotkeys.bindings_by_key.num;
+	const size_t *by_key = obs->hotkeys.bindings_by_key.array;
+	obs_hotkey_binding_t *bindings = obs->hotkeys.bindings.array;
+
+	for (size_t i = 0; i < num;) {
+		obs_key_t key = bindings[by_key[i]].key.key;
+		bool pressed  = key != OBS_KEY_NONE && is_pressed(key);
+
+		for (; i < num && bindings[by_key[i]].key.key == key; i++)
+			handle_binding(&bindings[by_key[i]], modifiers,
+					no_press, strict_modifiers, &pressed);
+	}
 }
 
 #define NBSP "\xC2\xA0"
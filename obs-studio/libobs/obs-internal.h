@@ -24,6 +24,7 @@
 #include "util/threading.h"
 #include "util/platform.h"
 #include "util/profiler.h"
+#include "util/worker-pool.h"
 #include "callback/signal.h"
 #include "callback/proc.h"
 
@@ -250,6 +251,13 @@ struct obs_core_video {
 	pthread_t                       video_thread;
 	uint32_t                        total_frames;
 	uint32_t                        lagged_frames;
+
+	/* scene items skipped by culling while rendering the main output
+	 * texture, in the frame being rendered and in the last complete
+	 * frame.  previews and projectors are not counted */
+	bool                            count_culled_items;
+	uint32_t                        frame_culled_items;
+	uint32_t                        culled_items;
 	bool                            thread_initialized;
 
 	bool                            gpu_conversion;
@@ -258,6 +266,10 @@ struct obs_core_video {
 	uint32_t                        plane_offsets[3];
 	uint32_t                        plane_sizes[3];
 	uint32_t                        plane_linewidth[3];
+	worker_pool_t                   *conversion_pool;
+	worker_pool_t                   *tick_pool;
+	DARRAY(struct obs_source*)      tick_async_sources;
+	volatile bool                   profile_source_ticks;
 
 	uint32_t                        output_width;
 	uint32_t                        output_height;
@@ -302,6 +314,14 @@ struct obs_core_audio {
 };
 
 /* user sources, output channels, and displays */
+/* name lookup for one context list, protected by the list's mutex.  private
+ * contexts are not indexed */
+struct obs_context_index {
+	struct obs_context_data         **buckets;
+	size_t                          size;
+	size_t                          count;
+};
+
 struct obs_core_data {
 	struct obs_source               *first_source;//源
 	struct obs_source               *first_audio_source;//音频源
@@ -316,6 +336,10 @@ struct obs_core_data {
 	pthread_mutex_t                 encoders_mutex;
 	pthread_mutex_t                 services_mutex;
 	pthread_mutex_t                 audio_sources_mutex;
+	struct obs_context_index        sources_index;
+	struct obs_context_index        outputs_index;
+	struct obs_context_index        encoders_index;
+	struct obs_context_index        services_index;
 	pthread_mutex_t                 draw_callbacks_mutex;
 	DARRAY(struct draw_callback)    draw_callbacks;
 
@@ -342,6 +366,10 @@ struct obs_core_hotkeys {
 	bool                            reroute_hotkeys;
 	DARRAY(obs_hotkey_binding_t)    bindings;
 
+	/* indices of bindings sorted by key, rebuilt after bindings change */
+	DARRAY(size_t)                  bindings_by_key;
+	bool                            bindings_by_key_dirty;
+
 	obs_hotkey_callback_router_func router_func;
 	void                            *router_func_data;
 
@@ -425,6 +453,10 @@ struct obs_context_data {
 	struct obs_context_data         *next;
 	struct obs_context_data         **prev_next;
 
+	struct obs_context_index        *index;
+	struct obs_context_data         *hash_next;
+	uint32_t                        name_hash;
+
 	bool                            private;
 };
 
@@ -438,7 +470,8 @@ extern bool obs_context_data_init(
 extern void obs_context_data_free(struct obs_context_data *context);
 
 extern void obs_context_data_insert(struct obs_context_data *context,
-		pthread_mutex_t *mutex, void *first);
+		pthread_mutex_t *mutex, void *first,
+		struct obs_context_index *index);
 extern void obs_context_data_remove(struct obs_context_data *context);
 
 extern void obs_context_data_setname(struct obs_context_data *context,
@@ -565,6 +598,16 @@ struct obs_source {
 	uint64_t                        last_sys_timestamp;
 	bool                            async_rendered;
 
+	/* incremented whenever a source with static content changes */
+	volatile long                   content_version;
+
+	/* set when the async frame was selected ahead of the tick */
+	bool                            async_frame_selected;
+
+	/* profiler name for the source's tick, rebuilt if it's renamed */
+	const char                      *tick_profile_name;
+	const char                      *tick_profile_src;
+
 	/* audio */
 	bool                            audio_failed;
 	bool                            audio_pending;
@@ -613,6 +656,10 @@ struct obs_source {
 	struct obs_source_frame         *async_preload_frame;
 	DARRAY(struct async_frame)      async_cache;
 	DARRAY(struct obs_source_frame*)async_frames;
+	uint32_t                        async_frames_queued;
+	uint32_t                        async_frames_dropped;
+	uint32_t                        async_frames_late;
+	int                             async_drops_since_shown;
 	pthread_mutex_t                 async_mutex;
 	uint32_t                        async_width;//源的宽
 	uint32_t                        async_height;
@@ -766,6 +813,10 @@ extern bool set_async_texture_size(struct obs_source *source,
 		const struct obs_source_frame *frame);
 extern void remove_async_frame(obs_source_t *source,
 		struct obs_source_frame *frame);
+extern void obs_source_select_async_frame(obs_source_t *source);
+extern bool obs_source_get_content_version(obs_source_t *source,
+		long *version);
+extern bool obs_scene_get_content_version(obs_scene_t *scene, long *version);
 
 extern void set_deinterlace_texture_size(obs_source_t *source);
 extern void deinterlace_process_last_frame(obs_source_t *source,
@@ -787,6 +838,11 @@ struct delay_data {
 	enum delay_msg msg;
 	uint64_t ts;
 	struct encoder_packet packet;
+
+	/* packet data is in the on-disk delay log instead of memory */
+	bool on_disk;
+	uint64_t seg;
+	uint64_t offset;
 };
 
 typedef void (*encoded_callback_t)(void *data, struct encoder_packet *packet);
@@ -803,6 +859,13 @@ struct caption_text {
 	struct caption_text *next;
 };
 //
+#define MAX_INTERLEAVE_TRACKS (MAX_AUDIO_MIXES + 1)
+
+struct interleaved_packet {
+	struct encoder_packet           packet;
+	uint64_t                        seq;
+};
+
 struct obs_output {
 	struct obs_context_data         context;
 	struct obs_output_info          info;
@@ -822,7 +885,14 @@ struct obs_output {
 	pthread_t                       end_data_capture_thread;
 	os_event_t                      *stopping_event;
 	pthread_mutex_t                 interleaved_mutex;
-	DARRAY(struct encoder_packet)   interleaved_packets;
+
+	/* one dts ordered queue of struct interleaved_packet per track (video
+	 * first, then the audio mixes), merged by a min-heap of the track
+	 * indices ordered by the first packet of each queue */
+	struct circlebuf                interleave_queues[MAX_INTERLEAVE_TRACKS];
+	size_t                          interleave_heap[MAX_INTERLEAVE_TRACKS];
+	size_t                          interleave_heap_size;
+	uint64_t                        interleave_seq;
 	int                             stop_code;
 
 	int                             reconnect_retry_sec;
@@ -874,6 +944,15 @@ struct obs_output {
 	volatile bool                   delay_active;
 	volatile bool                   delay_capturing;
 
+	char                            *delay_dir;
+	FILE                            *delay_write_file;
+	FILE                            *delay_read_file;
+	uint64_t                        delay_write_seg;
+	uint64_t                        delay_write_offset;
+	uint64_t                        delay_flushed_offset;
+	uint64_t                        delay_read_seg;
+	bool                            delay_log_failed;
+
 	char                            *last_error_message;
 };
 
@@ -936,6 +1015,7 @@ struct obs_encoder {
 	uint32_t                        scaled_width;
 	uint32_t                        scaled_height;
 	enum video_format               preferred_format;
+	struct video_input_dispatch     video_dispatch;
 
 	volatile bool                   active;
 	bool                            initialized;
@@ -28,16 +28,169 @@ static inline bool delay_capturing(const struct obs_output *output)
 	return os_atomic_load_bool(&output->delay_capturing);
 }
 
+#define DELAY_SEGMENT_SIZE (64 * 1024 * 1024)
+
+static inline bool delay_on_disk(const struct obs_output *output)
+{
+	return (output->delay_cur_flags & OBS_OUTPUT_DELAY_DISK) != 0 &&
+		output->delay_dir && !output->delay_log_failed;
+}
+
+static inline void segment_path(struct obs_output *output, struct dstr *path,
+		uint64_t seg)
+{
+	dstr_printf(path, "%s/.obs-delay-%p-%"PRIu64".log",
+			output->delay_dir, output, seg);
+}
+
+static FILE *open_segment(struct obs_output *output, uint64_t seg,
+		const char *mode)
+{
+	struct dstr path = {0};
+	FILE *file;
+
+	segment_path(output, &path, seg);
+
+	file = os_fopen(path.array, mode);
+	if (!file)
+		blog(LOG_WARNING, "Output '%s': Failed to open delay log "
+		                  "'%s'", output->context.name, path.array);
+
+	dstr_free(&path);
+	return file;
+}
+
+static void remove_segment(struct obs_output *output, uint64_t seg)
+{
+	struct dstr path = {0};
+
+	segment_path(output, &path, seg);
+	os_unlink(path.array);
+	dstr_free(&path);
+}
+
+static void close_delay_log(struct obs_output *output)
+{
+	if (output->delay_write_file)
+		fclose(output->delay_write_file);
+	if (output->delay_read_file)
+		fclose(output->delay_read_file);
+
+	if (output->delay_dir) {
+		for (uint64_t seg = output->delay_read_seg;
+		     seg <= output->delay_write_seg; seg++)
+			remove_segment(output, seg);
+	}
+
+	output->delay_write_file = NULL;
+	output->delay_read_file = NULL;
+	output->delay_write_seg = 0;
+	output->delay_write_offset = 0;
+	output->delay_flushed_offset = 0;
+	output->delay_read_seg = 0;
+	output->delay_log_failed = false;
+}
+
+/* segments are deleted as soon as they have been read back, so the log only
+ * ever holds about delay_sec worth of data.  called with delay_mutex held */
+static bool write_to_log(struct obs_output *output, struct delay_data *dd,
+		const struct encoder_packet *packet)
+{
+	if (output->delay_write_file &&
+	    output->delay_write_offset + packet->size > DELAY_SEGMENT_SIZE) {
+		fclose(output->delay_write_file);
+		output->delay_write_file = NULL;
+		output->delay_write_seg++;
+		output->delay_write_offset = 0;
+		output->delay_flushed_offset = 0;
+	}
+
+	if (!output->delay_write_file) {
+		output->delay_write_file = open_segment(output,
+				output->delay_write_seg, "wb");
+		if (!output->delay_write_file)
+			return false;
+	}
+
+	if (fwrite(packet->data, 1, packet->size, output->delay_write_file) !=
+			packet->size)
+		return false;
+
+	dd->packet = *packet;
+	dd->packet.data = NULL;
+	dd->on_disk = true;
+	dd->seg = output->delay_write_seg;
+	dd->offset = output->delay_write_offset;
+
+	output->delay_write_offset += packet->size;
+	return true;
+}
+
+/* called with delay_mutex held */
+static bool read_from_log(struct obs_output *output, struct delay_data *dd)
+{
+	size_t size = dd->packet.size;
+	long *p_refs;
+
+	while (output->delay_read_seg < dd->seg) {
+		if (output->delay_read_file) {
+			fclose(output->delay_read_file);
+			output->delay_read_file = NULL;
+		}
+
+		remove_segment(output, output->delay_read_seg++);
+	}
+
+	if (output->delay_write_file &&
+	    dd->seg == output->delay_write_seg &&
+	    dd->offset + size > output->delay_flushed_offset) {
+		fflush(output->delay_write_file);
+		output->delay_flushed_offset = output->delay_write_offset;
+	}
+
+	if (!output->delay_read_file) {
+		output->delay_read_file = open_segment(output, dd->seg, "rb");
+		if (!output->delay_read_file)
+			return false;
+	}
+
+	p_refs = bmalloc(size + sizeof(long));
+	*p_refs = 1;
+	dd->packet.data = (void*)(p_refs + 1);
+	dd->on_disk = false;
+
+	if (os_fseeki64(output->delay_read_file, (int64_t)dd->offset,
+				SEEK_SET) != 0 ||
+	    fread(dd->packet.data, 1, size, output->delay_read_file) != size) {
+		obs_encoder_packet_release(&dd->packet);
+		return false;
+	}
+
+	return true;
+}
+
 static inline void push_packet(struct obs_output *output,
 		struct encoder_packet *packet, uint64_t t)
 {
 	struct delay_data dd = {0};
+	bool on_disk = delay_on_disk(output);
 
 	dd.msg = DELAY_MSG_PACKET;
 	dd.ts  = t;
-	obs_encoder_packet_create_instance(&dd.packet, packet);
+
+	if (!on_disk)
+		obs_encoder_packet_create_instance(&dd.packet, packet);
 
 	pthread_mutex_lock(&output->delay_mutex);
+
+	if (on_disk && !write_to_log(output, &dd, packet)) {
+		blog(LOG_WARNING, "Output '%s': Failed to write to the delay "
+		                  "log, keeping delayed packets in memory",
+		                  output->context.name);
+		output->delay_log_failed = true;
+		obs_encoder_packet_create_instance(&dd.packet, packet);
+	}
+
 	circlebuf_push_back(&output->delay_data, &dd, sizeof(dd));
 	pthread_mutex_unlock(&output->delay_mutex);
 }
@@ -67,11 +220,13 @@ void obs_output_cleanup_delay(obs_output_t *output)
 
 	while (output->delay_data.size) {
 		circlebuf_pop_front(&output->delay_data, &dd, sizeof(dd));
-		if (dd.msg == DELAY_MSG_PACKET) {
+		if (dd.msg == DELAY_MSG_PACKET && !dd.on_disk) {
 			obs_encoder_packet_release(&dd.packet);
 		}
 	}
 
+	close_delay_log(output);
+
 	output->active_delay_ns = 0;
 	os_atomic_set_long(&output->delay_restart_refs, 0);
 }
@@ -81,6 +236,7 @@ static inline bool pop_packet(struct obs_output *output, uint64_t t)
 	uint64_t elapsed_time;
 	struct delay_data dd;
 	bool popped = false;
+	bool dropped = false;
 	bool preserve;
 
 	/* ------------------------------------------------ */
@@ -100,6 +256,13 @@ static inline bool pop_packet(struct obs_output *output, uint64_t t)
 			circlebuf_pop_front(&output->delay_data, NULL,
 					sizeof(dd));
 			popped = true;
+
+			if (dd.on_disk && !read_from_log(output, &dd)) {
+				blog(LOG_WARNING, "Output '%s': Failed to "
+				                  "read packet from the delay "
+				                  "log", output->context.name);
+				dropped = true;
+			}
 		}
 	}
 
@@ -107,7 +270,7 @@ static inline bool pop_packet(struct obs_output *output, uint64_t t)
 
 	/* ------------------------------------------------ */
 
-	if (popped)
+	if (popped && !dropped)
 		process_delay_data(output, &dd);
 
 	return popped;
@@ -197,6 +360,22 @@ void obs_output_set_delay(obs_output_t *output, uint32_t delay_sec,
 	output->delay_flags = flags;
 }
 
+void obs_output_set_delay_dir(obs_output_t *output, const char *dir)
+{
+	if (!obs_output_valid(output, "obs_output_set_delay_dir"))
+		return;
+
+	if (delay_active(output)) {
+		blog(LOG_WARNING, "Output '%s': Tried to change the delay "
+		                  "directory while delay is active",
+		                  output->context.name);
+		return;
+	}
+
+	bfree(output->delay_dir);
+	output->delay_dir = (dir && *dir) ? bstrdup(dir) : NULL;
+}
+
 uint32_t obs_output_get_delay(const obs_output_t *output)
 {
 	return obs_output_valid(output, "obs_output_set_delay") ?
@@ -147,7 +147,8 @@ obs_output_t *obs_output_create(const char *id, const char *name,
 
 	obs_context_data_insert(&output->context,
 			&obs->data.outputs_mutex,
-			&obs->data.first_output);
+			&obs->data.first_output,
+			&obs->data.outputs_index);
 
 	if (info)
 		output->context.data = info->create(output->context.settings,
@@ -163,12 +164,7 @@ fail:
 	return NULL;
 }
 
-static inline void free_packets(struct obs_output *output)
-{
-	for (size_t i = 0; i < output->interleaved_packets.num; i++)
-		obs_encoder_packet_release(output->interleaved_packets.array+i);
-	da_free(output->interleaved_packets);
-}
+static void free_interleaved_packets(struct obs_output *output);
 
 void obs_output_destroy(obs_output_t *output)
 {
@@ -189,7 +185,7 @@ void obs_output_destroy(obs_output_t *output)
 		if (output->context.data)
 			output->info.destroy(output->context.data);
 
-		free_packets(output);
+		free_interleaved_packets(output);
 
 		if (output->video_encoder) {
 			obs_encoder_remove_output(output->video_encoder,
@@ -211,6 +207,7 @@ void obs_output_destroy(obs_output_t *output)
 		os_event_destroy(output->reconnect_stop_event);
 		obs_context_data_free(&output->context);
 		circlebuf_free(&output->delay_data);
+		bfree(output->delay_dir);
 		if (output->owns_info_id)
 			bfree((void*)output->info.id);
 		if (output->last_error_message)
@@ -1003,17 +1000,223 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 }
 #endif
 
+/* ------------------------------------------------------------------------ */
+/* interleave queues */
+
+static inline size_t packet_track(const struct encoder_packet *packet)
+{
+	return packet->type == OBS_ENCODER_VIDEO ? 0 : packet->track_idx + 1;
+}
+
+static inline struct interleaved_packet *queue_packet(
+		struct obs_output *output, size_t track, size_t idx)
+{
+	struct circlebuf *queue = &output->interleave_queues[track];
+	size_t offset = idx * sizeof(struct interleaved_packet);
+
+	return offset < queue->size ? circlebuf_data(queue, offset) : NULL;
+}
+
+static inline size_t queue_count(struct obs_output *output, size_t track)
+{
+	return output->interleave_queues[track].size /
+		sizeof(struct interleaved_packet);
+}
+
+static inline struct interleaved_packet *queue_first(
+		struct obs_output *output, size_t track)
+{
+	return queue_packet(output, track, 0);
+}
+
+static inline struct interleaved_packet *queue_last(
+		struct obs_output *output, size_t track)
+{
+	size_t count = queue_count(output, track);
+	return count ? queue_packet(output, track, count - 1) : NULL;
+}
+
+/* packets with the same timestamp keep the order they arrived in */
+static inline bool packet_before(const struct interleaved_packet *a,
+		const struct interleaved_packet *b)
+{
+	if (a->packet.dts_usec != b->packet.dts_usec)
+		return a->packet.dts_usec < b->packet.dts_usec;
+	return a->seq < b->seq;
+}
+
+static inline bool track_before(struct obs_output *output, size_t a, size_t b)
+{
+	return packet_before(queue_first(output, a), queue_first(output, b));
+}
+
+static inline void heap_swap(struct obs_output *output, size_t a, size_t b)
+{
+	size_t track = output->interleave_heap[a];
+	output->interleave_heap[a] = output->interleave_heap[b];
+	output->interleave_heap[b] = track;
+}
+
+static void heap_sift_up(struct obs_output *output, size_t pos)
+{
+	size_t *heap = output->interleave_heap;
+
+	while (pos) {
+		size_t parent = (pos - 1) / 2;
+		if (!track_before(output, heap[pos], heap[parent]))
+			break;
+
+		heap_swap(output, pos, parent);
+		pos = parent;
+	}
+}
+
+static void heap_sift_down(struct obs_output *output, size_t pos)
+{
+	size_t *heap = output->interleave_heap;
+	size_t size = output->interleave_heap_size;
+
+	for (;;) {
+		size_t left = pos * 2 + 1;
+		size_t right = left + 1;
+		size_t first = pos;
+
+		if (left < size && track_before(output, heap[left], heap[first]))
+			first = left;
+		if (right < size && track_before(output, heap[right],
+					heap[first]))
+			first = right;
+		if (first == pos)
+			break;
+
+		heap_swap(output, pos, first);
+		pos = first;
+	}
+}
+
+static inline void heap_push(struct obs_output *output, size_t track)
+{
+	size_t pos = output->interleave_heap_size++;
+	output->interleave_heap[pos] = track;
+	heap_sift_up(output, pos);
+}
+
+/* needed whenever packets are discarded or timestamps change */
+static void rebuild_interleave_heap(struct obs_output *output)
+{
+	output->interleave_heap_size = 0;
+
+	for (size_t i = 0; i < MAX_INTERLEAVE_TRACKS; i++) {
+		if (output->interleave_queues[i].size)
+			heap_push(output, i);
+	}
+}
+
+static inline struct interleaved_packet *first_interleaved_packet(
+		struct obs_output *output)
+{
+	return output->interleave_heap_size ?
+		queue_first(output, output->interleave_heap[0]) : NULL;
+}
+
+static void pop_first_interleaved_packet(struct obs_output *output,
+		struct encoder_packet *out)
+{
+	size_t track = output->interleave_heap[0];
+	struct circlebuf *queue = &output->interleave_queues[track];
+	struct interleaved_packet packet;
+
+	circlebuf_pop_front(queue, &packet, sizeof(packet));
+	*out = packet.packet;
+
+	if (!queue->size) {
+		size_t last = --output->interleave_heap_size;
+		output->interleave_heap[0] = output->interleave_heap[last];
+	}
+
+	heap_sift_down(output, 0);
+}
+
+/* each encoder emits its packets in dts order, so a packet always goes to
+ * the back of its track's queue */
+static inline void insert_interleaved_packet(struct obs_output *output,
+		struct encoder_packet *out)
+{
+	size_t track = packet_track(out);
+	struct circlebuf *queue = &output->interleave_queues[track];
+	struct interleaved_packet packet = {*out, output->interleave_seq++};
+	bool was_empty = !queue->size;
+
+	circlebuf_push_back(queue, &packet, sizeof(packet));
+
+	if (was_empty)
+		heap_push(output, track);
+}
+
+/* releases every packet that sorts before the given position */
+static void discard_before(struct obs_output *output, int64_t dts_usec,
+		uint64_t seq)
+{
+	struct interleaved_packet limit = {.seq = seq};
+	bool discarded = false;
+
+	limit.packet.dts_usec = dts_usec;
+
+	for (size_t i = 0; i < MAX_INTERLEAVE_TRACKS; i++) {
+		struct circlebuf *queue = &output->interleave_queues[i];
+
+		while (queue->size) {
+			struct interleaved_packet packet;
+
+			if (!packet_before(queue_first(output, i), &limit))
+				break;
+
+			circlebuf_pop_front(queue, &packet, sizeof(packet));
+			obs_encoder_packet_release(&packet.packet);
+			discarded = true;
+		}
+	}
+
+	if (discarded)
+		rebuild_interleave_heap(output);
+}
+
+static void free_interleaved_packets(struct obs_output *output)
+{
+	for (size_t i = 0; i < MAX_INTERLEAVE_TRACKS; i++) {
+		struct circlebuf *queue = &output->interleave_queues[i];
+
+		while (queue->size) {
+			struct interleaved_packet packet;
+			circlebuf_pop_front(queue, &packet, sizeof(packet));
+			obs_encoder_packet_release(&packet.packet);
+		}
+
+		circlebuf_free(queue);
+	}
+
+	output->interleave_heap_size = 0;
+	output->interleave_seq = 0;
+}
+
+/* ------------------------------------------------------------------------ */
+
+static const char *send_interleaved_name = "send_interleaved";
+
 static inline void send_interleaved(struct obs_output *output)
 {
-	struct encoder_packet out = output->interleaved_packets.array[0];
+	struct interleaved_packet *first = first_interleaved_packet(output);
+	struct encoder_packet out;
 
 	/* do not send an interleaved packet if there's no packet of the
 	 * opposing type of a higher timestamp in the interleave buffer.
 	 * this ensures that the timestamps are monotonic */
-	if (!has_higher_opposing_ts(output, &out))
+	if (!first || !has_higher_opposing_ts(output, &first->packet))
 		return;
 
-	da_erase(output->interleaved_packets, 0);
+	profile_start(send_interleaved_name);
+
+	pop_first_interleaved_packet(output, &out);
 
 	if (out.type == OBS_ENCODER_VIDEO) {
 		output->total_frames++;
@@ -1044,6 +1247,8 @@ static inline void send_interleaved(struct obs_output *output)
 
     output->info.encoded_packet(output->context.data, &out);//编码  保存，调用ffmpeg_mux_data
 	obs_encoder_packet_release(&out);
+
+	profile_end(send_interleaved_name);
 }
 
 static inline void set_higher_ts(struct obs_output *output,
@@ -1060,184 +1265,136 @@ static inline void set_higher_ts(struct obs_output *output,
 
 static inline struct encoder_packet *find_first_packet_type(
 		struct obs_output *output, enum obs_encoder_type type,
-		size_t audio_idx);
-static int find_first_packet_type_idx(struct obs_output *output,
-		enum obs_encoder_type type, size_t audio_idx);
+		size_t audio_idx)
+{
+	size_t track = type == OBS_ENCODER_VIDEO ? 0 : audio_idx + 1;
+	struct interleaved_packet *packet = queue_first(output, track);
+	return packet ? &packet->packet : NULL;
+}
+
+static inline struct encoder_packet *find_last_packet_type(
+		struct obs_output *output, enum obs_encoder_type type,
+		size_t audio_idx)
+{
+	size_t track = type == OBS_ENCODER_VIDEO ? 0 : audio_idx + 1;
+	struct interleaved_packet *packet = queue_last(output, track);
+	return packet ? &packet->packet : NULL;
+}
 
 /* gets the point where audio and video are closest together */
-static size_t get_interleaved_start_idx(struct obs_output *output)
+static struct interleaved_packet *get_interleaved_start(
+		struct obs_output *output)
 {
 	int64_t closest_diff = 0x7FFFFFFFFFFFFFFFLL;
-	struct encoder_packet *first_video = find_first_packet_type(output,
-			OBS_ENCODER_VIDEO, 0);
-	size_t video_idx = DARRAY_INVALID;
-	size_t idx = 0;
-
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		int64_t diff;
-
-		if (packet->type != OBS_ENCODER_AUDIO) {
-			if (packet == first_video)
-				video_idx = i;
-			continue;
-		}
-
-		diff = llabs(packet->dts_usec - first_video->dts_usec);
-		if (diff < closest_diff) {
-			closest_diff = diff;
-			idx = i;
+	struct interleaved_packet *first_video = queue_first(output, 0);
+	struct interleaved_packet *closest = NULL;
+
+	for (size_t i = 1; i < MAX_INTERLEAVE_TRACKS; i++) {
+		size_t count = queue_count(output, i);
+
+		for (size_t j = 0; j < count; j++) {
+			struct interleaved_packet *packet =
+				queue_packet(output, i, j);
+			int64_t diff = llabs(packet->packet.dts_usec -
+					first_video->packet.dts_usec);
+
+			if (diff < closest_diff ||
+			    (diff == closest_diff &&
+			     packet_before(packet, closest))) {
+				closest_diff = diff;
+				closest = packet;
+			}
 		}
 	}
 
-	return video_idx < idx ? video_idx : idx;
+	if (!closest)
+		return NULL;
+
+	return packet_before(first_video, closest) ? first_video : closest;
 }
 
-static int prune_premature_packets(struct obs_output *output)
+static inline void discard_to_interleaved_start(struct obs_output *output)
+{
+	struct interleaved_packet *start = get_interleaved_start(output);
+	if (start)
+		discard_before(output, start->packet.dts_usec, start->seq);
+}
+
+/* returns -1 if a track has no packets yet, otherwise whether the packets up
+ * to and including *last were premature */
+static int prune_premature_packets(struct obs_output *output,
+		struct interleaved_packet *last)
 {
 	size_t audio_mixes = num_audio_mixes(output);
-	struct encoder_packet *video;
-	int video_idx;
-	int max_idx;
+	struct interleaved_packet *video;
 	int64_t duration_usec;
 	int64_t max_diff = 0;
 	int64_t diff = 0;
 
-	video_idx = find_first_packet_type_idx(output, OBS_ENCODER_VIDEO, 0);
-	if (video_idx == -1) {
+	video = queue_first(output, 0);
+	if (!video) {
 		output->received_video = false;
 		return -1;
 	}
 
-	max_idx = video_idx;
-	video = &output->interleaved_packets.array[video_idx];
-	duration_usec = video->timebase_num * 1000000LL / video->timebase_den;
+	*last = *video;
+	duration_usec = video->packet.timebase_num * 1000000LL /
+		video->packet.timebase_den;
 
 	for (size_t i = 0; i < audio_mixes; i++) {
-		struct encoder_packet *audio;
-		int audio_idx;
+		struct interleaved_packet *audio = queue_first(output, i + 1);
 
-		audio_idx = find_first_packet_type_idx(output,
-				OBS_ENCODER_AUDIO, i);
-		if (audio_idx == -1) {
+		if (!audio) {
 			output->received_audio = false;
 			return -1;
 		}
 
-		audio = &output->interleaved_packets.array[audio_idx];
-		if (audio_idx > max_idx)
-			max_idx = audio_idx;
+		if (packet_before(last, audio))
+			*last = *audio;
 
-		diff = audio->dts_usec - video->dts_usec;
+		diff = audio->packet.dts_usec - video->packet.dts_usec;
 		if (diff > max_diff)
 			max_diff = diff;
 	}
 
-	return diff > duration_usec ? max_idx + 1 : 0;
-}
-
-static void discard_to_idx(struct obs_output *output, size_t idx)
-{
-	for (size_t i = 0; i < idx; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		obs_encoder_packet_release(packet);
-	}
-
-	da_erase_range(output->interleaved_packets, 0, idx);
+	return diff > duration_usec ? 1 : 0;
 }
 
 #define DEBUG_STARTING_PACKETS 0
 
 static bool prune_interleaved_packets(struct obs_output *output)
 {
-	size_t start_idx = 0;
-	int prune_start = prune_premature_packets(output);
+	struct interleaved_packet last;
+	int prune = prune_premature_packets(output, &last);
 
 #if DEBUG_STARTING_PACKETS == 1
-	blog(LOG_DEBUG, "--------- Pruning! %d ---------", prune_start);
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		blog(LOG_DEBUG, "packet: %s %d, ts: %lld, pruned = %s",
-				packet->type == OBS_ENCODER_AUDIO ?
-				"audio" : "video", (int)packet->track_idx,
-				packet->dts_usec,
-				(int)i < prune_start ? "true" : "false");
+	blog(LOG_DEBUG, "--------- Pruning! %d ---------", prune);
+	for (size_t i = 0; i < MAX_INTERLEAVE_TRACKS; i++) {
+		for (size_t j = 0; j < queue_count(output, i); j++) {
+			struct interleaved_packet *packet =
+				queue_packet(output, i, j);
+			blog(LOG_DEBUG, "packet: %s %d, ts: %lld, pruned = %s",
+					i == 0 ? "video" : "audio",
+					(int)i - 1,
+					packet->packet.dts_usec,
+					prune == 1 &&
+					!packet_before(&last, packet) ?
+					"true" : "false");
+		}
 	}
 #endif
 
 	/* prunes the first video packet if it's too far away from audio */
-	if (prune_start == -1)
+	if (prune == -1)
 		return false;
-	else if (prune_start != 0)
-		start_idx = (size_t)prune_start;
+	else if (prune == 1)
+		discard_before(output, last.packet.dts_usec, last.seq + 1);
 	else
-		start_idx = get_interleaved_start_idx(output);
-
-	if (start_idx)
-		discard_to_idx(output, start_idx);
+		discard_to_interleaved_start(output);
 
 	return true;
 }
 
-static int find_first_packet_type_idx(struct obs_output *output,
-		enum obs_encoder_type type, size_t audio_idx)
-{
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-
-		if (packet->type == type) {
-			if (type == OBS_ENCODER_AUDIO &&
-			    packet->track_idx != audio_idx) {
-				continue;
-			}
-
-			return (int)i;
-		}
-	}
-
-	return -1;
-}
-
-static int find_last_packet_type_idx(struct obs_output *output,
-		enum obs_encoder_type type, size_t audio_idx)
-{
-	for (size_t i = output->interleaved_packets.num; i > 0; i--) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i - 1];
-
-		if (packet->type == type) {
-			if (type == OBS_ENCODER_AUDIO &&
-			    packet->track_idx != audio_idx) {
-				continue;
-			}
-
-			return (int)(i - 1);
-		}
-	}
-
-	return -1;
-}
-
-static inline struct encoder_packet *find_first_packet_type(
-		struct obs_output *output, enum obs_encoder_type type,
-		size_t audio_idx)
-{
-	int idx = find_first_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
-}
-
-static inline struct encoder_packet *find_last_packet_type(
-		struct obs_output *output, enum obs_encoder_type type,
-		size_t audio_idx)
-{
-	int idx = find_last_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
-}
-
 static bool get_audio_and_video_packets(struct obs_output *output,
 		struct encoder_packet **video,
 		struct encoder_packet **audio, size_t audio_mixes)
@@ -1261,13 +1418,44 @@ static bool get_audio_and_video_packets(struct obs_output *output,
 	return true;
 }
 
+/* numbers the packets in their current merge order, so that packets which
+ * end up with the same timestamp once the offsets are applied still come
+ * out in that order */
+static void renumber_interleaved_packets(struct obs_output *output)
+{
+	size_t pos[MAX_INTERLEAVE_TRACKS] = {0};
+	uint64_t seq = 0;
+
+	for (;;) {
+		struct interleaved_packet *first = NULL;
+		size_t first_track = 0;
+
+		for (size_t i = 0; i < MAX_INTERLEAVE_TRACKS; i++) {
+			struct interleaved_packet *packet =
+				queue_packet(output, i, pos[i]);
+
+			if (packet && (!first || packet_before(packet, first))) {
+				first = packet;
+				first_track = i;
+			}
+		}
+
+		if (!first)
+			break;
+
+		first->seq = seq++;
+		pos[first_track]++;
+	}
+
+	output->interleave_seq = seq;
+}
+
 static bool initialize_interleaved_packets(struct obs_output *output)
 {
 	struct encoder_packet *video;
 	struct encoder_packet *audio[MAX_AUDIO_MIXES];
 	struct encoder_packet *last_audio[MAX_AUDIO_MIXES];
 	size_t audio_mixes = num_audio_mixes(output);
-	size_t start_idx;
 
 	if (!get_audio_and_video_packets(output, &video, audio, audio_mixes))
 		return false;
@@ -1285,13 +1473,9 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 	}
 
 	/* clear out excess starting audio if it hasn't been already */
-	start_idx = get_interleaved_start_idx(output);
-	if (start_idx) {
-		discard_to_idx(output, start_idx);
-		if (!get_audio_and_video_packets(output, &video, audio,
-					audio_mixes))
-			return false;
-	}
+	discard_to_interleaved_start(output);
+	if (!get_audio_and_video_packets(output, &video, audio, audio_mixes))
+		return false;
 
 	/* get new offsets */
 	output->video_offset = video->dts;
@@ -1313,61 +1497,32 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 	output->highest_video_ts -= video->dts_usec;
 
 	/* apply new offsets to all existing packet DTS/PTS values */
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		apply_interleaved_packet_offset(output, packet);
-	}
-
-	return true;
-}
+	renumber_interleaved_packets(output);
 
-static inline void insert_interleaved_packet(struct obs_output *output,
-		struct encoder_packet *out)
-{
-	size_t idx;
-	for (idx = 0; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *cur_packet;
-		cur_packet = output->interleaved_packets.array + idx;
+	for (size_t i = 0; i < MAX_INTERLEAVE_TRACKS; i++) {
+		size_t count = queue_count(output, i);
 
-		if (out->dts_usec < cur_packet->dts_usec)
-			break;
+		for (size_t j = 0; j < count; j++) {
+			struct interleaved_packet *packet =
+				queue_packet(output, i, j);
+			apply_interleaved_packet_offset(output,
+					&packet->packet);
+		}
 	}
 
-	da_insert(output->interleaved_packets, idx, out);
-}
-
-static void resort_interleaved_packets(struct obs_output *output)
-{
-	DARRAY(struct encoder_packet) old_array;
-
-	old_array.da = output->interleaved_packets.da;
-	memset(&output->interleaved_packets, 0,
-			sizeof(output->interleaved_packets));
-
-	for (size_t i = 0; i < old_array.num; i++)
-		insert_interleaved_packet(output, &old_array.array[i]);
-
-	da_free(old_array);
+	/* every track got its own offset, so the merge order changed */
+	rebuild_interleave_heap(output);
+	return true;
 }
 
-static void discard_unused_audio_packets(struct obs_output *output,
+static inline void discard_unused_audio_packets(struct obs_output *output,
 		int64_t dts_usec)
 {
-	size_t idx = 0;
-
-	for (; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *p =
-			&output->interleaved_packets.array[idx];
-
-		if (p->dts_usec >= dts_usec)
-			break;
-	}
-
-	if (idx)
-		discard_to_idx(output, idx);
+	discard_before(output, dts_usec, 0);
 }
 
+static const char *interleave_packets_name = "interleave_packets";
+
 static void interleave_packets(void *data, struct encoder_packet *packet)
 {
 	struct obs_output     *output = data;
@@ -1381,12 +1536,14 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 		packet->track_idx = get_track_index(output, packet);
 
 	pthread_mutex_lock(&output->interleaved_mutex);
+	profile_start(interleave_packets_name);
 
 	/* if first video frame is not a keyframe, discard until received */
 	if (!output->received_video &&
 	    packet->type == OBS_ENCODER_VIDEO &&
 	    !packet->keyframe) {
 		discard_unused_audio_packets(output, packet->dts_usec);
+		profile_end(interleave_packets_name);
 		pthread_mutex_unlock(&output->interleaved_mutex);
 
 		if (output->active_delay_ns)
@@ -1414,16 +1571,15 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
     if (output->received_audio && output->received_video) {
         if (!was_started) {
             if (prune_interleaved_packets(output)) {
-                if (initialize_interleaved_packets(output)) {
-                    resort_interleaved_packets(output);
+                if (initialize_interleaved_packets(output))
                     send_interleaved(output);
-                }
             }
         } else {
             send_interleaved(output);//录制才会保存xialai
         }
     }
 
+	profile_end(interleave_packets_name);
 	pthread_mutex_unlock(&output->interleaved_mutex);
 }
 
@@ -1487,7 +1643,7 @@ static void reset_packet_data(obs_output_t *output)
 	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++)
 		output->audio_offsets[0] = 0;
 
-	free_packets(output);
+	free_interleaved_packets(output);
 }
 
 static inline bool preserve_active(struct obs_output *output)
@@ -1521,6 +1677,13 @@ static void hook_data_capture(struct obs_output *output, bool encoded,
 			               output->context.name,
 			               output->delay_sec,
 			               preserve_active(output) ? "on" : "off");
+
+			if ((output->delay_cur_flags & OBS_OUTPUT_DELAY_DISK) &&
+			    output->delay_dir)
+				blog(LOG_INFO, "Output '%s': keeping delayed "
+				               "packets on disk in '%s'",
+				               output->context.name,
+				               output->delay_dir);
 		}
 
 		if (has_audio)
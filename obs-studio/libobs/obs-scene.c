@@ -42,12 +42,19 @@ static const char *obs_scene_signals[] = {
 	NULL
 };
 
+static inline void scene_content_changed(struct obs_scene *scene)
+{
+	os_atomic_inc_long(&scene->content_version);
+}
+
 //obs_scene_item移除
 static inline void signal_item_remove(struct obs_scene_item *item)
 {
 	struct calldata params;
 	uint8_t stack[128];
 
+	scene_content_changed(item->parent);
+
 	calldata_init_fixed(&params, stack, sizeof(stack));
 	calldata_set_ptr(&params, "scene", item->parent);
 	calldata_set_ptr(&params, "item", item);
@@ -387,6 +394,8 @@ static void update_item_transform(struct obs_scene_item *item)
 	item->last_width  = width;
 	item->last_height = height;
 
+	scene_content_changed(item->parent);
+
 	calldata_init_fixed(&params, stack, sizeof(stack));
 	calldata_set_ptr(&params, "scene", item->parent);
 	calldata_set_ptr(&params, "item", item);
@@ -468,6 +477,39 @@ static void render_item_texture(struct obs_scene_item *item)
 		obs_source_draw(tex, 0, 0, 0, 0, 0);
 }
 
+static inline bool crop_equal(const struct obs_sceneitem_crop *crop1,
+		const struct obs_sceneitem_crop *crop2)
+{
+	return crop1->left   == crop2->left  &&
+	       crop1->right  == crop2->right &&
+	       crop1->top    == crop2->top   &&
+	       crop1->bottom == crop2->bottom;
+}
+
+/* returns true if the item texture still holds what the source would draw,
+ * otherwise records what the texture is about to be rendered from */
+static bool item_texture_cached(struct obs_scene_item *item,
+		uint32_t width, uint32_t height, bool *cacheable)
+{
+	long version = 0;
+
+	*cacheable = obs_source_get_content_version(item->source, &version);
+
+	if (*cacheable && item->texture_cached &&
+	    item->cached_version == version &&
+	    item->cached_width   == width &&
+	    item->cached_height  == height &&
+	    crop_equal(&item->cached_crop, &item->crop))
+		return true;
+
+	item->texture_cached = false;
+	item->cached_version = version;
+	item->cached_width   = width;
+	item->cached_height  = height;
+	item->cached_crop    = item->crop;
+	return false;
+}
+
 static inline void render_item(struct obs_scene_item *item)
 {
 	if (item->item_render) {
@@ -475,8 +517,11 @@ static inline void render_item(struct obs_scene_item *item)
 		uint32_t height = obs_source_get_height(item->source);
 		uint32_t cx = calc_cx(item, width);
 		uint32_t cy = calc_cy(item, height);
+		bool cacheable = false;
 
-		if (cx && cy && gs_texrender_begin(item->item_render, cx, cy)) {
+		if (cx && cy &&
+		    !item_texture_cached(item, width, height, &cacheable) &&
+		    gs_texrender_begin(item->item_render, cx, cy)) {
 			float cx_scale = (float)width  / (float)cx;
 			float cy_scale = (float)height / (float)cy;
 			struct vec4 clear_color;
@@ -494,6 +539,8 @@ static inline void render_item(struct obs_scene_item *item)
 
 			obs_source_video_render(item->source);
 			gs_texrender_end(item->item_render);
+
+			item->texture_cached = cacheable;
 		}
 	}
 
@@ -524,14 +571,173 @@ static void scene_video_tick(void *data, float seconds)
 	UNUSED_PARAMETER(seconds);
 }
 
+bool obs_scene_get_content_version(obs_scene_t *scene, long *version)
+{
+	struct obs_scene_item *item;
+	bool is_static = true;
+	bool changed = false;
+
+	video_lock(scene);
+	item = scene->first_item;
+
+	while (item) {
+		long item_version = 0;
+
+		/* let the next render pick up removals and size changes */
+		if (obs_source_removed(item->source) ||
+		    source_size_changed(item)) {
+			changed = true;
+
+		} else if (item->user_visible) {
+			if (!obs_source_get_content_version(item->source,
+						&item_version)) {
+				is_static = false;
+				break;
+			}
+
+			if (item->seen_version != item_version) {
+				item->seen_version = item_version;
+				changed = true;
+			}
+		}
+
+		item = item->next;
+	}
+
+	if (changed)
+		scene_content_changed(scene);
+	*version = os_atomic_load_long(&scene->content_version);
+
+	video_unlock(scene);
+	return is_static;
+}
+
+/* gets the corners of the area the item draws to, in canvas coordinates */
+static bool get_item_corners(const struct obs_scene_item *item,
+		const struct matrix4 *world, struct vec3 corners[4])
+{
+	uint32_t width  = obs_source_get_width(item->source);
+	uint32_t height = obs_source_get_height(item->source);
+	struct matrix4 transform;
+	float cx, cy;
+
+	if (!width || !height)
+		return false;
+
+	if (item->item_render) {
+		cx = (float)calc_cx(item, width);
+		cy = (float)calc_cy(item, height);
+	} else {
+		cx = (float)width;
+		cy = (float)height;
+	}
+
+	matrix4_mul(&transform, &item->draw_transform, world);
+
+	vec3_set(&corners[0], 0.0f, 0.0f, 0.0f);
+	vec3_set(&corners[1], cx,   0.0f, 0.0f);
+	vec3_set(&corners[2], cx,   cy,   0.0f);
+	vec3_set(&corners[3], 0.0f, cy,   0.0f);
+
+	for (size_t i = 0; i < 4; i++)
+		vec3_transform(&corners[i], &corners[i], &transform);
+	return true;
+}
+
+static bool item_off_canvas(const struct obs_scene_item *item,
+		const struct matrix4 *world)
+{
+	float canvas_cx = (float)obs->video.base_width;
+	float canvas_cy = (float)obs->video.base_height;
+	struct vec3 corners[4];
+	struct vec3 min, max;
+
+	if (!get_item_corners(item, world, corners))
+		return false;
+
+	vec3_copy(&min, &corners[0]);
+	vec3_copy(&max, &corners[0]);
+	for (size_t i = 1; i < 4; i++) {
+		vec3_min(&min, &min, &corners[i]);
+		vec3_max(&max, &max, &corners[i]);
+	}
+
+	return max.x <= 0.0f || max.y <= 0.0f ||
+	       min.x >= canvas_cx || min.y >= canvas_cy;
+}
+
+static inline bool source_opaque(const struct obs_source *source)
+{
+	if ((source->info.output_flags & OBS_SOURCE_OPAQUE) == 0)
+		return false;
+	if (!source->enabled || source->filters.num)
+		return false;
+
+	/* async sources only cover anything once they have a frame, and only
+	 * if that frame has no alpha */
+	if ((source->info.output_flags & OBS_SOURCE_ASYNC) != 0) {
+		if (!source->async_active || !source->async_texture)
+			return false;
+		if (source->async_format != VIDEO_FORMAT_BGRX &&
+		    !format_is_yuv(source->async_format))
+			return false;
+	}
+
+	return true;
+}
+
+static inline bool point_in_quad(const struct vec3 quad[4], float x, float y)
+{
+	bool pos = false, neg = false;
+
+	for (size_t i = 0; i < 4; i++) {
+		const struct vec3 *a = &quad[i];
+		const struct vec3 *b = &quad[(i + 1) % 4];
+		float cross = (b->x - a->x) * (y - a->y) -
+			(b->y - a->y) * (x - a->x);
+
+		if (cross > EPSILON)
+			pos = true;
+		else if (cross < -EPSILON)
+			neg = true;
+	}
+
+	return !(pos && neg);
+}
+
+static bool item_covers_canvas(const struct obs_scene_item *item,
+		const struct matrix4 *world)
+{
+	float canvas_cx = (float)obs->video.base_width;
+	float canvas_cy = (float)obs->video.base_height;
+	struct vec3 corners[4];
+
+	if (!source_opaque(item->source))
+		return false;
+	if (!get_item_corners(item, world, corners))
+		return false;
+
+	return point_in_quad(corners, 0.0f,      0.0f)      &&
+	       point_in_quad(corners, canvas_cx, 0.0f)      &&
+	       point_in_quad(corners, canvas_cx, canvas_cy) &&
+	       point_in_quad(corners, 0.0f,      canvas_cy);
+}
+
 static void scene_video_render(void *data, gs_effect_t *effect)
 {
 	DARRAY(struct obs_scene_item*) remove_items;
 	struct obs_scene *scene = data;
 	struct obs_scene_item *item;
+	struct obs_scene_item *first_shown = NULL;
+	struct matrix4 world;
+	bool occluded;
 
 	da_init(remove_items);
 
+	/* the item bounds are tested against the canvas in the current world
+	 * space, so nested scenes are culled against the outer canvas */
+	gs_matrix_get(&world);
+
 	video_lock(scene);
 	item = scene->first_item;
 
@@ -551,8 +757,25 @@ static void scene_video_render(void *data, gs_effect_t *effect)
 		if (source_size_changed(item))
 			update_item_transform(item);
 
-		if (item->user_visible)
-			render_item(item);
+		if (item->user_visible && item_covers_canvas(item, &world))
+			first_shown = item;
+
+		item = item->next;
+	}
+
+	occluded = first_shown != NULL;
+	item = scene->first_item;
+
+	while (item) {
+		if (item == first_shown)
+			occluded = false;
+
+		if (item->user_visible) {
+			if (!occluded && !item_off_canvas(item, &world))
+				render_item(item);
+			else if (obs->video.count_culled_items)
+				obs->video.frame_culled_items++;
+		}
 
 		item = item->next;
 	}
@@ -665,6 +888,7 @@ static void scene_load_item(struct obs_scene *scene, obs_data_t *item_data)
 	} else if (!item->item_render && item_texture_enabled(item)) {
 		obs_enter_graphics();
 		item->item_render = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+		item->texture_cached = false;
 		obs_leave_graphics();
 	}
 
@@ -1392,6 +1616,8 @@ obs_sceneitem_t *obs_scene_add(obs_scene_t *scene, obs_source_t *source)
 
 	full_unlock(scene);
 
+	scene_content_changed(scene);
+
 	if (!scene->source->context.private)
 		init_hotkeys(scene, item, obs_source_get_name(source));
 
@@ -1541,6 +1767,8 @@ static inline void signal_reorder(struct obs_scene_item *item)
 
 	command = "reorder";
 
+	scene_content_changed(item->parent);
+
 	calldata_init_fixed(&params, stack, sizeof(stack));
 	calldata_set_ptr(&params, "scene", item->parent);
 
@@ -1769,6 +1997,7 @@ bool obs_sceneitem_set_visible(obs_sceneitem_t *item, bool visible)
 	}
 
 	item->user_visible = visible;
+	scene_content_changed(item->parent);
 
 	calldata_init_fixed(&cd, stack, sizeof(stack));
 	calldata_set_ptr(&cd, "scene", item->parent);
@@ -1888,15 +2117,6 @@ void obs_scene_atomic_update(obs_scene_t *scene,
 	obs_scene_release(scene);
 }
 
-static inline bool crop_equal(const struct obs_sceneitem_crop *crop1,
-		const struct obs_sceneitem_crop *crop2)
-{
-	return crop1->left   == crop2->left  &&
-	       crop1->right  == crop2->right &&
-	       crop1->top    == crop2->top   &&
-	       crop1->bottom == crop2->bottom;
-}
-
 void obs_sceneitem_set_crop(obs_sceneitem_t *item,
 		const struct obs_sceneitem_crop *crop)
 {
@@ -1920,6 +2140,7 @@ void obs_sceneitem_set_crop(obs_sceneitem_t *item,
 
 	} else if (!item->item_render) {
 		item->item_render = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+		item->texture_cached = false;
 	}
 
 	memcpy(&item->crop, crop, sizeof(*crop));
@@ -1960,6 +2181,7 @@ void obs_sceneitem_set_scale_filter(obs_sceneitem_t *item,
 
 	} else if (!item->item_render) {
 		item->item_render = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+		item->texture_cached = false;
 	}
 
 	obs_leave_graphics();
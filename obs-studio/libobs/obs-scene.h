@@ -67,6 +67,17 @@ struct obs_scene_item {
     uint32_t              bounds_align;
     struct vec2           bounds;
 
+    /* content version of the source when the item texture was last
+     * rendered, see render_item */
+    bool                  texture_cached;
+    long                  cached_version;
+    uint32_t              cached_width;
+    uint32_t              cached_height;
+    struct obs_sceneitem_crop cached_crop;
+
+    /* content version of the source last seen by the scene */
+    long                  seen_version;
+
     obs_hotkey_pair_id    toggle_visibility;
 
     pthread_mutex_t       actions_mutex;
@@ -85,4 +96,7 @@ struct obs_scene {
     pthread_mutex_t       video_mutex;
     pthread_mutex_t       audio_mutex;
     struct obs_scene_item *first_item;//场景的第一item
+
+    /* incremented whenever the rendered scene may look different */
+    volatile long         content_version;
 };
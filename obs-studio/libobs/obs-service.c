@@ -64,7 +64,8 @@ static obs_service_t *obs_service_create_internal(const char *id,
 
 	obs_context_data_insert(&service->context,
 			&obs->data.services_mutex,
-			&obs->data.first_service);
+			&obs->data.first_service,
+			&obs->data.services_index);
 
 	blog(LOG_DEBUG, "service '%s' (%s) created", name, id);
 	return service;
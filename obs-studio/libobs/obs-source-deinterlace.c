@@ -32,6 +32,7 @@ static bool ready_deinterlace_frames(obs_source_t *source, uint64_t sys_time)
 			da_erase(source->async_frames, 0);
 			remove_async_frame(source, next_frame);
 			next_frame = source->async_frames.array[0];
+			source->async_frames_late++;
 		}
 
 		if (source->async_frames.num == 2)
@@ -63,6 +64,7 @@ static bool ready_deinterlace_frames(obs_source_t *source, uint64_t sys_time)
 		if (prev_frame) {
 			da_erase(source->async_frames, 0);
 			remove_async_frame(source, prev_frame);
+			source->async_frames_late++;
 		}
 
 		if (source->async_frames.num <= 2) {
@@ -140,6 +142,7 @@ static inline void deinterlace_get_closest_frames(obs_source_t *s,
 
 		s->prev_async_frame = NULL;
 		s->cur_async_frame = s->async_frames.array[0];
+		s->async_drops_since_shown = 0;
 
 		da_erase(s->async_frames, 0);
 
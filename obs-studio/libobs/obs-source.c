@@ -196,7 +196,8 @@ bool obs_source_init(struct obs_source *source)
 
 	obs_context_data_insert(&source->context,
 			&obs->data.sources_mutex,
-			&obs->data.first_source);
+			&obs->data.first_source,
+			&obs->data.sources_index);
 	return true;
 }
 
@@ -771,6 +772,35 @@ static void obs_source_deferred_update(obs_source_t *source)
 				source->context.settings);
 
 	source->defer_update = false;
+	os_atomic_inc_long(&source->content_version);
+}
+
+void obs_source_content_changed(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_content_changed"))
+		return;
+
+	os_atomic_inc_long(&source->content_version);
+}
+
+/* returns false if the output of the source may change every frame,
+ * otherwise version changes whenever the output does */
+bool obs_source_get_content_version(obs_source_t *source, long *version)
+{
+	obs_scene_t *scene;
+
+	if (!source->enabled || source->filters.num)
+		return false;
+
+	scene = obs_scene_from_source(source);
+	if (scene)
+		return obs_scene_get_content_version(scene, version);
+
+	if ((source->info.output_flags & OBS_SOURCE_STATIC_CONTENT) == 0)
+		return false;
+
+	*version = os_atomic_load_long(&source->content_version);
+	return true;
 }
 
 //更新源source的设置settings；
@@ -968,7 +998,7 @@ static inline struct obs_source_frame *get_closest_frame(obs_source_t *source,
 bool set_async_texture_size(struct obs_source *source,
 		const struct obs_source_frame *frame);
 //获取捕获的视频帧
-static void async_tick(obs_source_t *source)
+void obs_source_select_async_frame(obs_source_t *source)
 {
 	uint64_t sys_time = obs->video.video_time;
 
@@ -988,7 +1018,16 @@ static void async_tick(obs_source_t *source)
 	}
 
 	source->last_sys_timestamp = sys_time;
+	source->async_frame_selected = true;
 	pthread_mutex_unlock(&source->async_mutex);
+}
+
+static void async_tick(obs_source_t *source)
+{
+	/* the frame may already have been selected on a tick worker */
+	if (!source->async_frame_selected)
+		obs_source_select_async_frame(source);
+	source->async_frame_selected = false;
 
 	if (source->cur_async_frame)
 		source->async_update_texture = set_async_texture_size(source,
@@ -2246,14 +2285,14 @@ static void copy_frame_data(struct obs_source_frame *dst,
 }
 
 static inline bool async_texture_changed(struct obs_source *source,
-		const struct obs_source_frame *frame)
+		enum video_format format, uint32_t width, uint32_t height)
 {
 	enum convert_type prev, cur;
 	prev = get_convert_type(source->async_cache_format);
-	cur  = get_convert_type(frame->format);
+	cur  = get_convert_type(format);
 
-	return source->async_cache_width  != frame->width ||
-	       source->async_cache_height != frame->height ||
+	return source->async_cache_width  != width ||
+	       source->async_cache_height != height ||
 	       prev != cur;
 }
 
@@ -2287,25 +2326,48 @@ static void clean_cache(obs_source_t *source)
 
 #define MAX_ASYNC_FRAMES 30
 
-static inline struct obs_source_frame *cache_video(struct obs_source *source,
-		const struct obs_source_frame *frame)
+/* makes room for a new frame by dropping the oldest queued ones, their cache
+ * entries stay allocated so they can be reused right away */
+static void drop_oldest_async_frames(struct obs_source *source)
 {
-	struct obs_source_frame *new_frame = NULL;
+	while (source->async_frames.num >= MAX_ASYNC_FRAMES) {
+		struct obs_source_frame *frame = source->async_frames.array[0];
 
-	pthread_mutex_lock(&source->async_mutex);
+		da_erase(source->async_frames, 0);
+		remove_async_frame(source, frame);
 
-	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
-		free_async_cache(source);
+		source->async_frames_dropped++;
+		source->async_drops_since_shown++;
+	}
+
+	/* if a whole queue has gone by without anything being shown, the
+	 * frame timing is off, so resync to the next frame */
+	if (source->async_drops_since_shown >= MAX_ASYNC_FRAMES) {
+		blog(LOG_DEBUG, "Source '%s' dropped %d frames without showing "
+				"any, resyncing frame timing",
+				source->context.name, MAX_ASYNC_FRAMES);
+		source->async_drops_since_shown = 0;
 		source->last_frame_ts = 0;
-		pthread_mutex_unlock(&source->async_mutex);
-		return NULL;
 	}
+}
+
+/* returns an unused cache frame with an extra reference held for the
+ * caller */
+static struct obs_source_frame *get_cache_frame(struct obs_source *source,
+		enum video_format format, uint32_t width, uint32_t height)
+{
+	struct obs_source_frame *new_frame = NULL;
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	if (source->async_frames.num >= MAX_ASYNC_FRAMES)
+		drop_oldest_async_frames(source);
 
-	if (async_texture_changed(source, frame)) {
+	if (async_texture_changed(source, format, width, height)) {
 		free_async_cache(source);
-		source->async_cache_width  = frame->width;
-		source->async_cache_height = frame->height;
-		source->async_cache_format = frame->format;
+		source->async_cache_width  = width;
+		source->async_cache_height = height;
+		source->async_cache_format = format;
 	}
 
 	for (size_t i = 0; i < source->async_cache.num; i++) {
@@ -2322,13 +2384,11 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source,
 
 	if (!new_frame) {
 		struct async_frame new_af;
-		enum video_format format = frame->format;
 
 		if (format == VIDEO_FORMAT_Y800)
 			format = VIDEO_FORMAT_BGRX;
 
-		new_frame = obs_source_frame_create(format,
-				frame->width, frame->height);
+		new_frame = obs_source_frame_create(format, width, height);
 		new_af.frame = new_frame;
 		new_af.used = true;
 		new_af.unused_count = 0;
@@ -2341,6 +2401,17 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source,
 
 	pthread_mutex_unlock(&source->async_mutex);
 
+	return new_frame;
+}
+
+static inline struct obs_source_frame *cache_video(struct obs_source *source,
+		const struct obs_source_frame *frame)
+{
+	struct obs_source_frame *new_frame = get_cache_frame(source,
+			frame->format, frame->width, frame->height);
+	if (!new_frame)
+		return NULL;
+
 	copy_frame_data(new_frame, frame);
 
 	if (os_atomic_dec_long(&new_frame->refs) == 0) {
@@ -2351,6 +2422,16 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source,
 	return new_frame;
 }
 
+static inline void queue_async_frame(struct obs_source *source,
+		struct obs_source_frame *frame)
+{
+	pthread_mutex_lock(&source->async_mutex);
+	da_push_back(source->async_frames, &frame);
+	source->async_frames_queued++;
+	pthread_mutex_unlock(&source->async_mutex);
+	source->async_active = true;
+}
+
 void obs_source_output_video(obs_source_t *source,
 		const struct obs_source_frame *frame)
 {
@@ -2367,12 +2448,63 @@ void obs_source_output_video(obs_source_t *source,
 
 	/* ------------------------------------------- */
 
-	if (output) {
-		pthread_mutex_lock(&source->async_mutex);
-		da_push_back(source->async_frames, &output);
-		pthread_mutex_unlock(&source->async_mutex);
-		source->async_active = true;
+	if (output)
+		queue_async_frame(source, output);
+}
+
+struct obs_source_frame *obs_source_acquire_video(obs_source_t *source,
+		enum video_format format, uint32_t width, uint32_t height)
+{
+	if (!obs_source_valid(source, "obs_source_acquire_video"))
+		return NULL;
+
+	/* Y800 is expanded to BGRX when copied, so it can't be written
+	 * in place */
+	if (format == VIDEO_FORMAT_Y800 || format == VIDEO_FORMAT_NONE)
+		return NULL;
+	if (!width || !height)
+		return NULL;
+
+	return get_cache_frame(source, format, width, height);
+}
+
+void obs_source_commit_video(obs_source_t *source,
+		struct obs_source_frame *frame)
+{
+	if (!frame)
+		return;
+	if (!obs_source_valid(source, "obs_source_commit_video")) {
+		obs_source_frame_destroy(frame);
+		return;
+	}
+
+	/* the cache was reset while the frame was being written */
+	if (os_atomic_dec_long(&frame->refs) == 0) {
+		obs_source_frame_destroy(frame);
+		return;
+	}
+
+	queue_async_frame(source, frame);
+}
+
+void obs_source_discard_video(obs_source_t *source,
+		struct obs_source_frame *frame)
+{
+	if (!frame)
+		return;
+	if (!obs_source_valid(source, "obs_source_discard_video")) {
+		obs_source_frame_destroy(frame);
+		return;
 	}
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	if (os_atomic_dec_long(&frame->refs) == 0)
+		obs_source_frame_destroy(frame);
+	else
+		remove_async_frame(source, frame);
+
+	pthread_mutex_unlock(&source->async_mutex);
 }
 
 static inline bool preload_frame_changed(obs_source_t *source,
@@ -2632,6 +2764,7 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 			da_erase(source->async_frames, 0);
 			remove_async_frame(source, next_frame);
 			next_frame = source->async_frames.array[0];
+			source->async_frames_late++;
 		}
 
 		source->last_frame_ts = next_frame->timestamp;
@@ -2668,8 +2801,10 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 		if ((source->last_frame_ts - next_frame->timestamp) < 2000000)
 			break;
 
-		if (frame)
+		if (frame) {
 			da_erase(source->async_frames, 0);
+			source->async_frames_late++;
+		}
 
 #if DEBUG_ASYNC_FRAMES
 		blog(LOG_DEBUG, "new frame, "
@@ -2718,6 +2853,7 @@ static inline struct obs_source_frame *get_closest_frame(obs_source_t *source,
 	if (!source->last_frame_ts || ready_async_frame(source, sys_time)) {
 		struct obs_source_frame *frame = source->async_frames.array[0];
 		da_erase(source->async_frames, 0);
+		source->async_drops_since_shown = 0;
 
 		if (!source->last_frame_ts)
 			source->last_frame_ts = frame->timestamp;
@@ -4065,3 +4201,21 @@ bool obs_source_async_unbuffered(const obs_source_t *source)
 	return obs_source_valid(source, "obs_source_async_unbuffered") ?
 		source->async_unbuffered : false;
 }
+
+uint32_t obs_source_get_async_frames_queued(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_async_frames_queued") ?
+		source->async_frames_queued : 0;
+}
+
+uint32_t obs_source_get_async_frames_dropped(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_async_frames_dropped") ?
+		source->async_frames_dropped : 0;
+}
+
+uint32_t obs_source_get_async_frames_late(const obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_async_frames_late") ?
+		source->async_frames_late : 0;
+}
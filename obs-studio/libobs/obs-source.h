@@ -130,6 +130,25 @@ enum obs_source_type {
  */
 #define OBS_SOURCE_DO_NOT_SELF_MONITOR (1<<9)
 
+/**
+ * Source is opaque
+ *
+ * Specifies that the source always fills its whole width and height with
+ * fully opaque pixels once it has something to draw.  Scenes use this to
+ * skip rendering items that are completely covered by it.
+ */
+#define OBS_SOURCE_OPAQUE (1<<10)
+
+/**
+ * Source content is static
+ *
+ * Specifies that the source only draws something different after its
+ * settings are updated or after it calls obs_source_content_changed.  Scenes
+ * can then reuse the cropped/scaled texture of the source from a previous
+ * frame instead of rendering it again.
+ */
+#define OBS_SOURCE_STATIC_CONTENT (1<<11)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent,
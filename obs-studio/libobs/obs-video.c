@@ -21,12 +21,57 @@
 #include "media-io/format-conversion.h"
 #include "media-io/video-frame.h"
 //获取捕获的视频帧cur_async_frame
+static const char *select_async_frames_name = "select_async_frames";
+
+static void select_async_frame(void *param, size_t idx)
+{
+	struct obs_source **sources = param;
+	obs_source_select_async_frame(sources[idx]);
+}
+
+/* picks the next frame of every async source on the tick pool, the rest of
+ * the tick needs the graphics thread */
+static void select_async_frames(struct obs_core_video *video)
+{
+	struct obs_source *source = obs->data.first_source;
+
+	da_resize(video->tick_async_sources, 0);
+
+	while (source) {
+		if ((source->info.output_flags & OBS_SOURCE_ASYNC) != 0)
+			da_push_back(video->tick_async_sources, &source);
+		source = (struct obs_source*)source->context.next;
+	}
+
+	profile_start(select_async_frames_name);
+	worker_pool_run(video->tick_pool, select_async_frame,
+			video->tick_async_sources.array,
+			video->tick_async_sources.num);
+	profile_end(select_async_frames_name);
+}
+
+static inline const char *source_tick_profile_name(struct obs_source *source)
+{
+	if (!source->tick_profile_name ||
+	    source->tick_profile_src != source->context.name) {
+		const char *name = source->context.name;
+		source->tick_profile_name = profile_store_name(
+				obs_get_profiler_name_store(),
+				"obs_source_video_tick(%s)", name ? name : "");
+		source->tick_profile_src = source->context.name;
+	}
+
+	return source->tick_profile_name;
+}
+
 static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 {
 	struct obs_core_data *data = &obs->data;
+	struct obs_core_video *video = &obs->video;
 	struct obs_source    *source;
 	uint64_t             delta_time;
 	float                seconds;
+	bool                 profile;
 
 	if (!last_time)
 		last_time = cur_time -
@@ -35,12 +80,25 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 	delta_time = cur_time - last_time;
 	seconds = (float)((double)delta_time / 1000000000.0);
 
+	profile = os_atomic_load_bool(&video->profile_source_ticks);
+
 	pthread_mutex_lock(&data->sources_mutex);
 
+	if (video->tick_pool)
+		select_async_frames(video);
+
 	/* call the tick function of each source */
 	source = data->first_source;
 	while (source) {//获取视频帧
-		obs_source_video_tick(source, seconds);
+		if (profile) {
+			const char *name = source_tick_profile_name(source);
+			profile_start(name);
+			obs_source_video_tick(source, seconds);
+			profile_end(name);
+		} else {
+			obs_source_video_tick(source, seconds);
+		}
+
 		source = (struct obs_source*)source->context.next;
 	}
 
@@ -117,7 +175,9 @@ static inline void render_main_texture(struct obs_core_video *video,
 
 	pthread_mutex_unlock(&obs->data.draw_callbacks_mutex);
 
+	video->count_culled_items = true;
 	obs_view_render(&obs->data.main_view);
+	video->count_culled_items = false;
 
 	video->textures_rendered[cur_texture] = true;
 
@@ -431,31 +491,81 @@ static void set_gpu_converted_data(struct obs_core_video *video,
 	}
 }
 
-static void convert_frame(
+static void convert_frame_rows(
 		struct video_frame *output, const struct video_data *input,
-		const struct video_output_info *info)
+		const struct video_output_info *info,
+		uint32_t start_y, uint32_t end_y)
 {
 	if (info->format == VIDEO_FORMAT_I420) {
 		compress_uyvx_to_i420(
 				input->data[0], input->linesize[0],
-				0, info->height,
+				start_y, end_y,
 				output->data, output->linesize);
 
 	} else if (info->format == VIDEO_FORMAT_NV12) {
 		compress_uyvx_to_nv12(
 				input->data[0], input->linesize[0],
-				0, info->height,
+				start_y, end_y,
 				output->data, output->linesize);
 
 	} else if (info->format == VIDEO_FORMAT_I444) {
 		convert_uyvx_to_i444(
 				input->data[0], input->linesize[0],
-				0, info->height,
+				start_y, end_y,
 				output->data, output->linesize);
+	}
+}
 
-	} else {
+struct convert_band_data {
+	struct video_frame              *output;
+	const struct video_data         *input;
+	const struct video_output_info  *info;
+	uint32_t                        band_height;
+};
+
+static void convert_frame_band(void *param, size_t idx)
+{
+	struct convert_band_data *data = param;
+	uint32_t start_y = (uint32_t)idx * data->band_height;
+	uint32_t end_y   = start_y + data->band_height;
+
+	if (end_y > data->info->height)
+		end_y = data->info->height;
+	if (start_y < end_y)
+		convert_frame_rows(data->output, data->input, data->info,
+				start_y, end_y);
+}
+
+static void convert_frame(struct obs_core_video *video,
+		struct video_frame *output, const struct video_data *input,
+		const struct video_output_info *info)
+{
+	struct convert_band_data data;
+	size_t bands;
+
+	if (info->format != VIDEO_FORMAT_I420 &&
+	    info->format != VIDEO_FORMAT_NV12 &&
+	    info->format != VIDEO_FORMAT_I444) {
 		blog(LOG_ERROR, "convert_frame: unsupported texture format");
+		return;
+	}
+
+	bands = worker_pool_num_threads(video->conversion_pool) + 1;
+	if (bands == 1) {
+		convert_frame_rows(output, input, info, 0, info->height);
+		return;
 	}
+
+	/* the kernels work on pairs of lines, so bands must be even */
+	data.output      = output;
+	data.input       = input;
+	data.info        = info;
+	data.band_height = (info->height + (uint32_t)bands - 1) /
+		(uint32_t)bands;
+	data.band_height = (data.band_height + 1) & ~1;
+
+	worker_pool_run(video->conversion_pool, convert_frame_band, &data,
+			bands);
 }
 
 static inline void copy_rgbx_frame(
@@ -495,7 +605,7 @@ static inline void output_video_data(struct obs_core_video *video,
 					input_frame, info);
 
 		} else if (format_is_yuv(info->format)) {
-			convert_frame(&output_frame, input_frame, info);
+			convert_frame(video, &output_frame, input_frame, info);
 		} else {
 			copy_rgbx_frame(&output_frame, input_frame, info);
 		}
@@ -619,6 +729,9 @@ void *obs_video_thread(void *param)//display绘制线程
         output_frame();
         profile_end(output_frame_name);
 
+        obs->video.culled_items = obs->video.frame_culled_items;
+        obs->video.frame_culled_items = 0;
+
         frame_time_ns = os_gettime_ns() - frame_start;
 
         profile_end(video_thread_name);
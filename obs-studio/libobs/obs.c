@@ -19,9 +19,11 @@
 
 #include "graphics/matrix4.h"
 #include "callback/calldata.h"
+#include "media-io/format-conversion.h"
 
 #include "obs.h"
 #include "obs-internal.h"
+#include "util/str-hash.h"
 
 struct obs_core *obs = NULL;
 
@@ -215,6 +217,44 @@ static bool obs_init_textures(struct obs_video_info *ovi)
 	return true;
 }
 
+static void obs_init_conversion_pool(struct obs_video_info *ovi)
+{
+	struct obs_core_video *video = &obs->video;
+	uint32_t threads = ovi->conversion_threads;
+	uint32_t max_threads = (uint32_t)os_get_logical_cores();
+
+	if (video->gpu_conversion || !format_is_yuv(ovi->output_format))
+		return;
+
+	if (max_threads && threads > max_threads)
+		threads = max_threads;
+	if (threads <= 1)
+		return;
+
+	/* the graphics thread converts one of the bands itself */
+	video->conversion_pool = worker_pool_create("frame conversion",
+			threads - 1);
+	if (video->conversion_pool)
+		blog(LOG_INFO, "Converting frames on %u threads", threads);
+}
+
+static void obs_init_tick_pool(struct obs_video_info *ovi)
+{
+	struct obs_core_video *video = &obs->video;
+	uint32_t threads = ovi->tick_threads;
+	uint32_t max_threads = (uint32_t)os_get_logical_cores();
+
+	if (max_threads && threads > max_threads)
+		threads = max_threads;
+	if (threads <= 1)
+		return;
+
+	/* the graphics thread selects frames along with the workers */
+	video->tick_pool = worker_pool_create("source tick", threads - 1);
+	if (video->tick_pool)
+		blog(LOG_INFO, "Selecting async frames on %u threads", threads);
+}
+
 gs_effect_t *obs_load_effect(gs_effect_t **effect, const char *file)
 {
 	if (!*effect) {
@@ -384,6 +424,9 @@ static int obs_init_video(struct obs_video_info *ovi)
 
 	gs_leave_context();
 
+	obs_init_conversion_pool(ovi);
+	obs_init_tick_pool(ovi);
+
 	errorcode = pthread_create(&video->video_thread, NULL,
             obs_video_thread, obs);//obs_video_thread线程创建
 	if (errorcode != 0)
@@ -417,6 +460,12 @@ static void obs_free_video(void)
 		video_output_close(video->video);
 		video->video = NULL;
 
+		worker_pool_destroy(video->conversion_pool);
+		video->conversion_pool = NULL;
+		worker_pool_destroy(video->tick_pool);
+		video->tick_pool = NULL;
+		da_free(video->tick_async_sources);
+
 		if (!video->graphics)
 			return;
 
@@ -583,6 +632,86 @@ void obs_main_view_free(struct obs_view *view)
 	pthread_mutex_destroy(&view->channels_mutex);
 }
 
+static inline struct obs_context_data **get_index_bucket(
+		struct obs_context_index *index, uint32_t hash)
+{
+	return &index->buckets[hash & (index->size - 1)];
+}
+
+static void context_index_insert(struct obs_context_index *index,
+		struct obs_context_data *context)
+{
+	struct obs_context_data **bucket;
+
+	bucket = get_index_bucket(index, context->name_hash);
+	context->hash_next = *bucket;
+	*bucket = context;
+}
+
+static void context_index_resize(struct obs_context_index *index,
+		size_t size)
+{
+	struct obs_context_data **old_buckets = index->buckets;
+	size_t old_size = index->size;
+
+	index->buckets = bzalloc(size * sizeof(struct obs_context_data*));
+	index->size    = size;
+
+	for (size_t i = 0; i < old_size; i++) {
+		struct obs_context_data *context = old_buckets[i];
+
+		while (context) {
+			struct obs_context_data *next = context->hash_next;
+			context_index_insert(index, context);
+			context = next;
+		}
+	}
+
+	bfree(old_buckets);
+}
+
+/* must be called with the list mutex held */
+static void context_index_add(struct obs_context_index *index,
+		struct obs_context_data *context)
+{
+	if (!index || context->private || !context->name)
+		return;
+
+	if (++index->count > index->size)
+		context_index_resize(index, index->size ? index->size * 2 : 64);
+
+	context->name_hash = str_hash(context->name);
+	context_index_insert(index, context);
+}
+
+/* must be called with the list mutex held */
+static void context_index_remove(struct obs_context_index *index,
+		struct obs_context_data *context)
+{
+	struct obs_context_data **ref;
+
+	if (!index || !index->size || context->private || !context->name)
+		return;
+
+	ref = get_index_bucket(index, context->name_hash);
+	while (*ref) {
+		if (*ref == context) {
+			*ref = context->hash_next;
+			context->hash_next = NULL;
+			index->count--;
+			return;
+		}
+
+		ref = &(*ref)->hash_next;
+	}
+}
+
+static void context_index_free(struct obs_context_index *index)
+{
+	bfree(index->buckets);
+	memset(index, 0, sizeof(*index));
+}
+
 #define FREE_OBS_LINKED_LIST(type) \
 	do { \
 		int unfreed = 0; \
@@ -619,6 +748,11 @@ static void obs_free_data(void)
 	pthread_mutex_destroy(&data->services_mutex);
 	pthread_mutex_destroy(&data->draw_callbacks_mutex);
 	da_free(data->draw_callbacks);
+
+	context_index_free(&data->sources_index);
+	context_index_free(&data->outputs_index);
+	context_index_free(&data->encoders_index);
+	context_index_free(&data->services_index);
 }
 
 //信号
@@ -759,6 +893,7 @@ static bool obs_init(const char *locale, const char *module_config_path,
 	}
 
     log_system_info();//打印系统信息
+	format_conversion_init();
 
 	if (!obs_init_data())
 		return false;
@@ -1304,21 +1439,30 @@ void obs_enum_services(bool (*enum_proc)(void*, obs_service_t*), void *param)
 			enum_proc, param);
 }
 
-static inline void *get_context_by_name(void *vfirst, const char *name,
-		pthread_mutex_t *mutex, void *(*addref)(void*))
+static inline void *get_context_by_name(struct obs_context_index *index,
+		const char *name, pthread_mutex_t *mutex,
+		void *(*addref)(void*))
 {
-	struct obs_context_data **first = vfirst;
-	struct obs_context_data *context;
+	struct obs_context_data *context = NULL;
+	uint32_t hash;
+
+	if (!name)
+		return NULL;
+
+	hash = str_hash(name);
 
 	pthread_mutex_lock(mutex);
 
-	context = *first;
+	if (index->size)
+		context = *get_index_bucket(index, hash);
+
 	while (context) {
-		if (!context->private && strcmp(context->name, name) == 0) {
+		if (context->name_hash == hash &&
+		    strcmp(context->name, name) == 0) {
 			context = addref(context);
 			break;
 		}
-		context = context->next;
+		context = context->hash_next;
 	}
 
 	pthread_mutex_unlock(mutex);
@@ -1356,7 +1500,7 @@ static inline void *obs_id_(void *data)
 obs_source_t *obs_get_source_by_name(const char *name)
 {
 	if (!obs) return NULL;
-	return get_context_by_name(&obs->data.first_source, name,
+	return get_context_by_name(&obs->data.sources_index, name,
 			&obs->data.sources_mutex, obs_source_addref_safe_);
 }
 /*****************
@@ -1366,7 +1510,7 @@ obs_source_t *obs_get_source_by_name(const char *name)
 obs_output_t *obs_get_output_by_name(const char *name)
 {
 	if (!obs) return NULL;
-	return get_context_by_name(&obs->data.first_output, name,
+	return get_context_by_name(&obs->data.outputs_index, name,
 			&obs->data.outputs_mutex, obs_output_addref_safe_);
 }
 /*****************
@@ -1376,7 +1520,7 @@ obs_output_t *obs_get_output_by_name(const char *name)
 obs_encoder_t *obs_get_encoder_by_name(const char *name)
 {
 	if (!obs) return NULL;
-	return get_context_by_name(&obs->data.first_encoder, name,
+	return get_context_by_name(&obs->data.encoders_index, name,
 			&obs->data.encoders_mutex, obs_encoder_addref_safe_);
 }
 /*****************
@@ -1386,7 +1530,7 @@ obs_encoder_t *obs_get_encoder_by_name(const char *name)
 obs_service_t *obs_get_service_by_name(const char *name)
 {
 	if (!obs) return NULL;
-	return get_context_by_name(&obs->data.first_service, name,
+	return get_context_by_name(&obs->data.services_index, name,
 			&obs->data.services_mutex, obs_service_addref_safe_);
 }
 
@@ -1810,7 +1954,8 @@ void obs_context_data_free(struct obs_context_data *context)
 }
 
 void obs_context_data_insert(struct obs_context_data *context,
-		pthread_mutex_t *mutex, void *pfirst)
+		pthread_mutex_t *mutex, void *pfirst,
+		struct obs_context_index *index)
 {
 	struct obs_context_data **first = pfirst;
 
@@ -1819,6 +1964,7 @@ void obs_context_data_insert(struct obs_context_data *context,
 	assert(first);
 
 	context->mutex = mutex;
+	context->index = index;
 
 	pthread_mutex_lock(mutex);
 	context->prev_next  = first;
@@ -1826,6 +1972,7 @@ void obs_context_data_insert(struct obs_context_data *context,
 	*first              = context;
 	if (context->next)
 		context->next->prev_next = &context->next;
+	context_index_add(index, context);
 	pthread_mutex_unlock(mutex);
 }
 
@@ -1837,15 +1984,26 @@ void obs_context_data_remove(struct obs_context_data *context)
 			*context->prev_next = context->next;
 		if (context->next)
 			context->next->prev_next = context->prev_next;
+		context_index_remove(context->index, context);
 		pthread_mutex_unlock(context->mutex);
 
 		context->mutex = NULL;
+		context->index = NULL;
 	}
 }
 
 void obs_context_data_setname(struct obs_context_data *context,
 		const char *name)
 {
+	pthread_mutex_t *mutex = context->mutex;
+
+	/* the list mutex is always taken before rename_cache_mutex, callers
+	 * may already hold it */
+	if (mutex) {
+		pthread_mutex_lock(mutex);
+		context_index_remove(context->index, context);
+	}
+
 	pthread_mutex_lock(&context->rename_cache_mutex);
 
 	if (context->name)
@@ -1853,6 +2011,11 @@ void obs_context_data_setname(struct obs_context_data *context,
 	context->name = dup_name(name, context->private);
 
 	pthread_mutex_unlock(&context->rename_cache_mutex);
+
+	if (mutex) {
+		context_index_add(context->index, context);
+		pthread_mutex_unlock(mutex);
+	}
 }
 
 profiler_name_store_t *obs_get_profiler_name_store(void)
@@ -1863,6 +2026,14 @@ profiler_name_store_t *obs_get_profiler_name_store(void)
 	return obs->name_store;
 }
 
+void obs_set_profile_source_ticks(bool enable)
+{
+	if (!obs)
+		return;
+
+	os_atomic_set_bool(&obs->video.profile_source_ticks, enable);
+}
+
 uint64_t obs_get_video_frame_time(void)
 {
 	return obs ? obs->video.video_time : 0;
@@ -1991,3 +2162,8 @@ uint32_t obs_get_lagged_frames(void)
 {
 	return obs ? obs->video.lagged_frames : 0;
 }
+
+uint32_t obs_get_culled_scene_items(void)
+{
+	return obs ? obs->video.culled_items : 0;
+}
@@ -175,6 +175,20 @@ struct obs_video_info {
 	enum video_range_type range;       /**< YUV range (if YUV) */
 
 	enum obs_scale_type scale_type;    /**< How to scale if scaling */
+
+	/**
+	 * Number of threads used to convert frames to the output format when
+	 * GPU conversion is not in use.  0 or 1 converts on the graphics
+	 * thread.
+	 */
+	uint32_t            conversion_threads;
+
+	/**
+	 * Number of threads used to select the next frame of async sources
+	 * each tick.  The rest of the tick stays on the graphics thread.  0
+	 * or 1 ticks every source on the graphics thread.
+	 */
+	uint32_t            tick_threads;
 };
 
 /**
@@ -279,6 +293,12 @@ EXPORT const char *obs_get_locale(void);
  */
 EXPORT profiler_name_store_t *obs_get_profiler_name_store(void);
 
+/**
+ * Records the tick time of each source in the profiler under tick_sources.
+ * Off by default, since it adds an entry per source.
+ */
+EXPORT void obs_set_profile_source_ticks(bool enable);
+
 /**
  * Sets base video output base resolution/fps/format.
  *
@@ -633,6 +653,13 @@ EXPORT uint64_t obs_get_average_frame_time_ns(void);
 EXPORT uint32_t obs_get_total_frames(void);
 EXPORT uint32_t obs_get_lagged_frames(void);
 
+/**
+ * Returns the number of visible scene items that were skipped while rendering
+ * the main output in the last frame because they were off the canvas or
+ * covered by an opaque item.  Preview and projector renders are not counted.
+ */
+EXPORT uint32_t obs_get_culled_scene_items(void);
+
 
 /* ------------------------------------------------------------------------- */
 /* Display context */
@@ -749,6 +776,12 @@ EXPORT obs_properties_t *obs_source_properties(const obs_source_t *source);
 /** Updates settings for this source */
 EXPORT void obs_source_update(obs_source_t *source, obs_data_t *settings);
 
+/**
+ * Tells libobs that a source with OBS_SOURCE_STATIC_CONTENT will draw
+ * something different from the last frame
+ */
+EXPORT void obs_source_content_changed(obs_source_t *source);
+
 /** Renders a video source. */
 EXPORT void obs_source_video_render(obs_source_t *source);
 
@@ -991,6 +1024,26 @@ EXPORT void obs_source_draw(gs_texture_t *image, int x, int y,
 EXPORT void obs_source_output_video(obs_source_t *source,
 		const struct obs_source_frame *frame);
 
+/**
+ * Gets a frame from the source's async frame cache so it can be written
+ * directly instead of being copied by obs_source_output_video.  The caller
+ * fills in the planes, timestamp and color values and then must pass the
+ * frame to either obs_source_commit_video or obs_source_discard_video.
+ *
+ * Returns NULL if the format can't be written in place (Y800), in which case
+ * use obs_source_output_video instead.
+ */
+EXPORT struct obs_source_frame *obs_source_acquire_video(obs_source_t *source,
+		enum video_format format, uint32_t width, uint32_t height);
+
+/** Queues a frame from obs_source_acquire_video for display */
+EXPORT void obs_source_commit_video(obs_source_t *source,
+		struct obs_source_frame *frame);
+
+/** Returns a frame from obs_source_acquire_video without displaying it */
+EXPORT void obs_source_discard_video(obs_source_t *source,
+		struct obs_source_frame *frame);
+
 /** Preloads asynchronous video data to allow instantaneous playback */
 EXPORT void obs_source_preload_video(obs_source_t *source,
 		const struct obs_source_frame *frame);
@@ -1108,6 +1161,19 @@ EXPORT void obs_source_set_async_unbuffered(obs_source_t *source,
 		bool unbuffered);
 EXPORT bool obs_source_async_unbuffered(const obs_source_t *source);
 
+/** Total number of async video frames output by the source */
+EXPORT uint32_t obs_source_get_async_frames_queued(const obs_source_t *source);
+
+/**
+ * Number of async video frames dropped because the queue was full, which
+ * means the frames arrive faster or earlier than they can be shown
+ */
+EXPORT uint32_t obs_source_get_async_frames_dropped(
+		const obs_source_t *source);
+
+/** Number of async video frames skipped because they were too late */
+EXPORT uint32_t obs_source_get_async_frames_late(const obs_source_t *source);
+
 /* ------------------------------------------------------------------------- */
 /* Transition-specific functions */
 enum obs_transition_target {
@@ -1370,6 +1436,13 @@ EXPORT void obs_output_stop(obs_output_t *output);
  */
 #define OBS_OUTPUT_DELAY_PRESERVE (1<<0)
 
+/**
+ * Keeps delayed packet data in a log on disk instead of memory, only an index
+ * of the packets stays in memory.  Requires a directory to be set with
+ * obs_output_set_delay_dir, otherwise the delay stays in memory.
+ */
+#define OBS_OUTPUT_DELAY_DISK     (1<<1)
+
 /**
  * Sets the current output delay, in seconds (if the output supports delay).
  *
@@ -1383,6 +1456,9 @@ EXPORT void obs_output_set_delay(obs_output_t *output, uint32_t delay_sec,
 /** Gets the currently set delay value, in seconds. */
 EXPORT uint32_t obs_output_get_delay(const obs_output_t *output);
 
+/** Sets the directory used for the delay log with OBS_OUTPUT_DELAY_DISK. */
+EXPORT void obs_output_set_delay_dir(obs_output_t *output, const char *dir);
+
 /** If delay is active, gets the currently active delay value, in seconds. */
 EXPORT uint32_t obs_output_get_active_delay(const obs_output_t *output);
 
@@ -1661,6 +1737,24 @@ EXPORT void obs_encoder_set_preferred_video_format(obs_encoder_t *encoder,
 EXPORT enum video_format obs_encoder_get_preferred_video_format(
 		const obs_encoder_t *encoder);
 
+/**
+ * Gives a video encoder its own thread with a queue of up to queue_depth raw
+ * frames, so it cannot hold up other encoders using the same video output.
+ * drop_policy decides which frame is dropped when the queue is full.  Set
+ * queue_depth to 0 (the default) to encode on the video output thread.  If
+ * the encoder is active, this function will trigger a warning, and do
+ * nothing.
+ */
+EXPORT void obs_encoder_set_video_dispatch(obs_encoder_t *encoder,
+		size_t queue_depth, enum video_input_drop_policy drop_policy);
+
+/**
+ * Gets the frame, drop and queue lag counters of an active video encoder's
+ * connection to its video output.
+ */
+EXPORT bool obs_encoder_get_video_stats(obs_encoder_t *encoder,
+		struct video_input_stats *stats);
+
 /** Gets the default settings for an encoder type */
 EXPORT obs_data_t *obs_encoder_defaults(const char *id);
 
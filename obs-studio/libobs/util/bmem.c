@@ -28,27 +28,21 @@
 
 #define ALIGNMENT 32
 
-/* TODO: use memalign for non-windows systems */
 #if defined(_WIN32)
 #define ALIGNED_MALLOC 1
 #else
-#define ALIGNMENT_HACK 1
+#define POSIX_MEMALIGN 1
 #endif
 
 static void *a_malloc(size_t size)
 {
 #ifdef ALIGNED_MALLOC
 	return _aligned_malloc(size, ALIGNMENT);
-#elif ALIGNMENT_HACK
+#elif POSIX_MEMALIGN
 	void *ptr = NULL;
-	long diff;
 
-	ptr  = malloc(size + ALIGNMENT);
-	if (ptr) {
-		diff = ((~(long)ptr) & (ALIGNMENT - 1)) + 1;
-		ptr  = (char *)ptr + diff;
-		((char *)ptr)[-1] = (char)diff;
-	}
+	if (posix_memalign(&ptr, ALIGNMENT, size ? size : 1) != 0)
+		return NULL;
 
 	return ptr;
 #else
@@ -60,16 +54,23 @@ static void *a_realloc(void *ptr, size_t size)
 {
 #ifdef ALIGNED_MALLOC
 	return _aligned_realloc(ptr, size, ALIGNMENT);
-#elif ALIGNMENT_HACK
-	long diff;
+#elif POSIX_MEMALIGN
+	void *new_ptr;
 
 	if (!ptr)
 		return a_malloc(size);
-	diff = ((char *)ptr)[-1];
-	ptr = realloc((char*)ptr - diff, size + diff);
-	if (ptr)
-		ptr = (char *)ptr + diff;
-	return ptr;
+
+	/* realloc only guarantees malloc's alignment, so move the data again
+	 * in the (uncommon) case that the new block isn't aligned enough */
+	ptr = realloc(ptr, size);
+	if (!ptr || ((uintptr_t)ptr & (ALIGNMENT - 1)) == 0)
+		return ptr;
+
+	new_ptr = a_malloc(size);
+	if (new_ptr)
+		memcpy(new_ptr, ptr, size);
+	free(ptr);
+	return new_ptr;
 #else
 	return realloc(ptr, size);
 #endif
@@ -79,14 +80,244 @@ static void a_free(void *ptr)
 {
 #ifdef ALIGNED_MALLOC
 	_aligned_free(ptr);
-#elif ALIGNMENT_HACK
-	if (ptr)
-		free((char *)ptr - ((char*)ptr)[-1]);
 #else
 	free(ptr);
 #endif
 }
 
+/* ------------------------------------------------------------------------- */
+/* Pool allocator */
+
+/*
+ * Every block has a header of ALIGNMENT bytes in front of it holding its
+ * size class.  Freed blocks of up to POOL_MAX_SIZE bytes go in to a cache
+ * owned by the freeing thread instead of back to the system, and are handed
+ * out again by that thread's next allocation of the same class.
+ */
+
+#define POOL_MIN_SHIFT    5
+#define POOL_MAX_SIZE     ((size_t)1 << (POOL_MIN_SHIFT + \
+			BASE_POOL_SIZE_CLASSES - 1))
+#define POOL_LARGE        BASE_POOL_SIZE_CLASSES
+#define POOL_CACHE_BYTES  (256 * 1024)
+
+struct pool_header {
+	size_t size;
+	size_t size_class;
+};
+
+struct pool_block {
+	struct pool_block *next;
+};
+
+struct pool_cache {
+	struct pool_block *blocks[BASE_POOL_SIZE_CLASSES];
+	size_t            count[BASE_POOL_SIZE_CLASSES];
+};
+
+struct pool_class_stats {
+	volatile long allocs;
+	volatile long cache_hits;
+	volatile long in_use;
+};
+
+static struct pool_class_stats pool_stats[BASE_POOL_SIZE_CLASSES];
+static pthread_once_t pool_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t pool_key;
+
+static inline size_t pool_class_size(size_t size_class)
+{
+	return (size_t)1 << (size_class + POOL_MIN_SHIFT);
+}
+
+static inline size_t pool_get_class(size_t size)
+{
+	size_t size_class = 0;
+
+	if (size > POOL_MAX_SIZE)
+		return POOL_LARGE;
+
+	while (pool_class_size(size_class) < size)
+		size_class++;
+
+	return size_class;
+}
+
+static inline struct pool_header *pool_get_header(void *ptr)
+{
+	return (struct pool_header*)((uint8_t*)ptr - ALIGNMENT);
+}
+
+static void pool_cache_destroy(void *param)
+{
+	struct pool_cache *cache = param;
+
+	for (size_t i = 0; i < BASE_POOL_SIZE_CLASSES; i++) {
+		struct pool_block *block = cache->blocks[i];
+
+		while (block) {
+			struct pool_block *next = block->next;
+			a_free(pool_get_header(block));
+			block = next;
+		}
+	}
+
+	a_free(cache);
+}
+
+static void pool_init_key(void)
+{
+	pthread_key_create(&pool_key, pool_cache_destroy);
+}
+
+static struct pool_cache *pool_get_cache(void)
+{
+	struct pool_cache *cache;
+
+	pthread_once(&pool_key_once, pool_init_key);
+
+	cache = pthread_getspecific(pool_key);
+	if (!cache) {
+		cache = a_malloc(sizeof(struct pool_cache));
+		if (!cache)
+			return NULL;
+
+		memset(cache, 0, sizeof(struct pool_cache));
+		pthread_setspecific(pool_key, cache);
+	}
+
+	return cache;
+}
+
+static void *pool_malloc(size_t size)
+{
+	size_t size_class = pool_get_class(size);
+	struct pool_header *header;
+	struct pool_cache *cache;
+
+	if (size_class != POOL_LARGE) {
+		struct pool_class_stats *stats = &pool_stats[size_class];
+
+		os_atomic_inc_long(&stats->allocs);
+		os_atomic_inc_long(&stats->in_use);
+
+		cache = pool_get_cache();
+		if (cache && cache->blocks[size_class]) {
+			struct pool_block *block = cache->blocks[size_class];
+
+			cache->blocks[size_class] = block->next;
+			cache->count[size_class]--;
+			os_atomic_inc_long(&stats->cache_hits);
+
+			pool_get_header(block)->size = size;
+			return block;
+		}
+
+		header = a_malloc(ALIGNMENT + pool_class_size(size_class));
+	} else {
+		header = a_malloc(ALIGNMENT + size);
+	}
+
+	if (!header) {
+		if (size_class != POOL_LARGE)
+			os_atomic_dec_long(&pool_stats[size_class].in_use);
+		return NULL;
+	}
+
+	header->size       = size;
+	header->size_class = size_class;
+	return (uint8_t*)header + ALIGNMENT;
+}
+
+static void pool_free(void *ptr)
+{
+	struct pool_header *header;
+	struct pool_cache *cache;
+	size_t size_class;
+
+	if (!ptr)
+		return;
+
+	header     = pool_get_header(ptr);
+	size_class = header->size_class;
+
+	if (size_class == POOL_LARGE) {
+		a_free(header);
+		return;
+	}
+
+	os_atomic_dec_long(&pool_stats[size_class].in_use);
+
+	cache = pool_get_cache();
+	if (cache && cache->count[size_class] * pool_class_size(size_class) <
+			POOL_CACHE_BYTES) {
+		struct pool_block *block = ptr;
+
+		block->next = cache->blocks[size_class];
+		cache->blocks[size_class] = block;
+		cache->count[size_class]++;
+		return;
+	}
+
+	a_free(header);
+}
+
+static void *pool_realloc(void *ptr, size_t size)
+{
+	struct pool_header *header;
+	void *new_ptr;
+
+	if (!ptr)
+		return pool_malloc(size);
+
+	header = pool_get_header(ptr);
+
+	if (header->size_class == POOL_LARGE) {
+		if (size > POOL_MAX_SIZE) {
+			header = a_realloc(header, ALIGNMENT + size);
+			if (!header)
+				return NULL;
+
+			header->size = size;
+			return (uint8_t*)header + ALIGNMENT;
+		}
+
+	} else if (size <= pool_class_size(header->size_class)) {
+		header->size = size;
+		return ptr;
+	}
+
+	new_ptr = pool_malloc(size);
+	if (!new_ptr)
+		return NULL;
+
+	memcpy(new_ptr, ptr, header->size < size ? header->size : size);
+	pool_free(ptr);
+	return new_ptr;
+}
+
+static struct base_allocator pool_alloc = {
+	pool_malloc, pool_realloc, pool_free
+};
+
+struct base_allocator *base_get_pool_allocator(void)
+{
+	return &pool_alloc;
+}
+
+void base_get_pool_stats(struct base_pool_stats stats[BASE_POOL_SIZE_CLASSES])
+{
+	for (size_t i = 0; i < BASE_POOL_SIZE_CLASSES; i++) {
+		stats[i].size       = pool_class_size(i);
+		stats[i].allocs     = os_atomic_load_long(&pool_stats[i].allocs);
+		stats[i].cache_hits = os_atomic_load_long(
+				&pool_stats[i].cache_hits);
+		stats[i].in_use     = os_atomic_load_long(&pool_stats[i].in_use);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
 static struct base_allocator alloc = {a_malloc, a_realloc, a_free};
 static long num_allocs = 0;
 
@@ -33,6 +33,27 @@ struct base_allocator {
 
 EXPORT void base_set_allocator(struct base_allocator *defs);
 
+/**
+ * Returns an allocator that caches freed blocks of up to 4096 bytes per
+ * thread, grouped in to power-of-two size classes, so that small short-lived
+ * allocations mostly avoid the system allocator.  To use it, pass it to
+ * base_set_allocator before anything has been allocated.
+ */
+EXPORT struct base_allocator *base_get_pool_allocator(void);
+
+#define BASE_POOL_SIZE_CLASSES 8
+
+struct base_pool_stats {
+	size_t size;
+	long   allocs;
+	long   cache_hits;
+	long   in_use;
+};
+
+/** Gets the counters of each pool allocator size class, smallest first */
+EXPORT void base_get_pool_stats(
+		struct base_pool_stats stats[BASE_POOL_SIZE_CLASSES]);
+
 EXPORT void *bmalloc(size_t size);
 EXPORT void *brealloc(void *ptr, size_t size);
 EXPORT void bfree(void *ptr);
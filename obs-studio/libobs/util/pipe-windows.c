@@ -179,3 +179,9 @@ size_t os_process_pipe_write(os_process_pipe_t *pp, const uint8_t *data,
 
 	return 0;
 }
+
+bool os_process_pipe_flush(os_process_pipe_t *pp)
+{
+	/* WriteFile is not buffered on our side */
+	return pp && !pp->read_pipe;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2013-2014 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "worker-pool.h"
+#include "threading.h"
+#include "platform.h"
+#include "bmem.h"
+#include "dstr.h"
+#include "base.h"
+
+struct worker_pool {
+	pthread_t              *threads;
+	size_t                 num_threads;
+	size_t                 num_started;
+	char                   *name;
+
+	/* serializes worker_pool_run callers */
+	pthread_mutex_t        run_mutex;
+
+	os_sem_t               *start_sem;
+	os_event_t             *done_event;
+	volatile bool          stop;
+
+	worker_pool_job_t      job;
+	void                   *param;
+	long                   count;
+	volatile long          next_idx;
+	volatile long          active_workers;
+};
+
+static inline void process_jobs(struct worker_pool *pool)
+{
+	long idx;
+
+	while ((idx = os_atomic_inc_long(&pool->next_idx) - 1) < pool->count)
+		pool->job(pool->param, (size_t)idx);
+}
+
+static void *worker_thread(void *data)
+{
+	struct worker_pool *pool = data;
+
+	os_set_thread_name(pool->name);
+
+	while (os_sem_wait(pool->start_sem) == 0) {
+		if (os_atomic_load_bool(&pool->stop))
+			break;
+
+		process_jobs(pool);
+
+		if (os_atomic_dec_long(&pool->active_workers) == 0)
+			os_event_signal(pool->done_event);
+	}
+
+	return NULL;
+}
+
+worker_pool_t *worker_pool_create(const char *name, size_t num_threads)
+{
+	struct worker_pool *pool = bzalloc(sizeof(struct worker_pool));
+	struct dstr thread_name = {0};
+
+	dstr_printf(&thread_name, "libobs: %s", name ? name : "worker pool");
+	pool->name = thread_name.array;
+
+	pthread_mutex_init_value(&pool->run_mutex);
+	if (pthread_mutex_init(&pool->run_mutex, NULL) != 0)
+		goto fail;
+	if (os_sem_init(&pool->start_sem, 0) != 0)
+		goto fail;
+	if (os_event_init(&pool->done_event, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail;
+
+	pool->threads = bzalloc(sizeof(pthread_t) * num_threads);
+	pool->num_threads = num_threads;
+
+	for (size_t i = 0; i < num_threads; i++) {
+		if (pthread_create(&pool->threads[i], NULL, worker_thread,
+					pool) != 0)
+			goto fail;
+		pool->num_started++;
+	}
+
+	return pool;
+
+fail:
+	blog(LOG_ERROR, "worker_pool_create: failed to create '%s'",
+			pool->name);
+	worker_pool_destroy(pool);
+	return NULL;
+}
+
+void worker_pool_destroy(worker_pool_t *pool)
+{
+	if (!pool)
+		return;
+
+	os_atomic_set_bool(&pool->stop, true);
+
+	for (size_t i = 0; i < pool->num_started; i++)
+		os_sem_post(pool->start_sem);
+	for (size_t i = 0; i < pool->num_started; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	os_event_destroy(pool->done_event);
+	os_sem_destroy(pool->start_sem);
+	pthread_mutex_destroy(&pool->run_mutex);
+	bfree(pool->threads);
+	bfree(pool->name);
+	bfree(pool);
+}
+
+size_t worker_pool_num_threads(const worker_pool_t *pool)
+{
+	return pool ? pool->num_threads : 0;
+}
+
+void worker_pool_run(worker_pool_t *pool, worker_pool_job_t job,
+		void *param, size_t count)
+{
+	size_t wake;
+
+	if (!count)
+		return;
+
+	if (!pool || !pool->num_threads || count == 1) {
+		for (size_t i = 0; i < count; i++)
+			job(param, i);
+		return;
+	}
+
+	pthread_mutex_lock(&pool->run_mutex);
+
+	wake = count - 1 < pool->num_threads ? count - 1 : pool->num_threads;
+
+	pool->job            = job;
+	pool->param          = param;
+	pool->count          = (long)count;
+	pool->next_idx       = 0;
+	pool->active_workers = (long)wake;
+
+	for (size_t i = 0; i < wake; i++)
+		os_sem_post(pool->start_sem);
+
+	process_jobs(pool);
+	os_event_wait(pool->done_event);
+
+	pthread_mutex_unlock(&pool->run_mutex);
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2013-2014 Hugh Bailey <obs.jim@gmail.com>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+
+/*
+ *   A small set of persistent threads for splitting a job into independent
+ * pieces.  worker_pool_run hands out job indices to the workers and to the
+ * calling thread, and returns once every index has been processed.
+ */
+
+#include "c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct worker_pool;
+typedef struct worker_pool worker_pool_t;
+
+typedef void (*worker_pool_job_t)(void *param, size_t idx);
+
+/* num_threads does not include the calling thread */
+EXPORT worker_pool_t *worker_pool_create(const char *name, size_t num_threads);
+EXPORT void worker_pool_destroy(worker_pool_t *pool);
+
+EXPORT size_t worker_pool_num_threads(const worker_pool_t *pool);
+
+/* calls job(param, idx) for every idx in [0, count) and waits for them all */
+EXPORT void worker_pool_run(worker_pool_t *pool, worker_pool_job_t job,
+		void *param, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
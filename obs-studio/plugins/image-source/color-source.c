@@ -109,7 +109,8 @@ static void color_source_defaults(obs_data_t *settings)
 struct obs_source_info color_source_info = {
     .id             = "color_source",//创建源的时候是通过id来创建是哪个源
     .type           = OBS_SOURCE_TYPE_INPUT,//源类型:场景,来源,过渡,过滤
-    .output_flags   = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW,//输出标志:OBS_SOURCE_VIDEO源有视频,没有OBS_SOURCE_AUDIO说明没有音频
+    .output_flags   = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW |
+                      OBS_SOURCE_STATIC_CONTENT,//输出标志:OBS_SOURCE_VIDEO源有视频,没有OBS_SOURCE_AUDIO说明没有音频
     .create         = color_source_create,//创建
     .destroy        = color_source_destroy,//销毁
     .update         = color_source_update,//更新
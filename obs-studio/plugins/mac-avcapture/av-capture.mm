@@ -2196,7 +2196,8 @@ bool obs_module_load(void)
 		.id             = "av_capture_input",
 		.type           = OBS_SOURCE_TYPE_INPUT,
 		.output_flags   = OBS_SOURCE_ASYNC_VIDEO |
-		                  OBS_SOURCE_DO_NOT_DUPLICATE,
+		                  OBS_SOURCE_DO_NOT_DUPLICATE |
+		                  OBS_SOURCE_OPAQUE,
 		.get_name       = av_capture_getname,
 		.create         = av_capture_create,
 		.destroy        = av_capture_destroy,
@@ -20,6 +20,11 @@
 #include <windows.h>
 #define inline __inline
 
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 #include <stdbool.h>
@@ -100,8 +105,158 @@ struct ffmpeg_mux {
 	int                    num_audio_streams;
 	bool                   initialized;
 	char error[4096];
+
+	struct ffm_shm_header  *shm;
+	size_t                 shm_size;
+	bool                   shm_active;
+#ifdef _WIN32
+	HANDLE                 shm_mapping;
+	HANDLE                 space_event;
+#endif
+
+	int                    frag_duration;
+	bool                   fragmented;
+	bool                   frag_started;
+	int64_t                frag_start;
 };
 
+/* ------------------------------------------------------------------------- */
+
+static bool check_shm(struct ffm_shm_header *shm, size_t size)
+{
+	return size >= FFM_SHM_HEADER_SIZE &&
+	       shm->magic == FFM_SHM_MAGIC &&
+	       shm->capacity &&
+	       (shm->capacity & (shm->capacity - 1)) == 0 &&
+	       shm->capacity <= size - FFM_SHM_HEADER_SIZE;
+}
+
+#ifdef _WIN32
+static void shm_close(struct ffmpeg_mux *ffm)
+{
+	if (ffm->shm)
+		UnmapViewOfFile(ffm->shm);
+	if (ffm->shm_mapping)
+		CloseHandle(ffm->shm_mapping);
+	if (ffm->space_event)
+		CloseHandle(ffm->space_event);
+
+	ffm->shm = NULL;
+	ffm->shm_mapping = NULL;
+	ffm->space_event = NULL;
+}
+
+/* the muxer polls instead if this can't be opened */
+static HANDLE open_space_event(const char *name)
+{
+	size_t size = strlen(name) + sizeof(FFM_SHM_EVENT_SUFFIX);
+	char *event_name = malloc(size);
+	wchar_t *wname;
+	HANDLE event = NULL;
+	int len;
+
+	snprintf(event_name, size, "%s%s", name, FFM_SHM_EVENT_SUFFIX);
+
+	len = MultiByteToWideChar(CP_UTF8, 0, event_name, -1, NULL, 0);
+	if (len) {
+		wname = malloc(len * sizeof(wchar_t));
+		MultiByteToWideChar(CP_UTF8, 0, event_name, -1, wname, len);
+		event = OpenEventW(EVENT_MODIFY_STATE, false, wname);
+		free(wname);
+	}
+
+	free(event_name);
+	return event;
+}
+
+static bool shm_open_ring(struct ffmpeg_mux *ffm, const char *name)
+{
+	MEMORY_BASIC_INFORMATION mbi;
+	wchar_t *wname;
+	int len;
+
+	len = MultiByteToWideChar(CP_UTF8, 0, name, -1, NULL, 0);
+	if (!len)
+		return false;
+
+	wname = malloc(len * sizeof(wchar_t));
+	MultiByteToWideChar(CP_UTF8, 0, name, -1, wname, len);
+
+	ffm->shm_mapping = OpenFileMappingW(FILE_MAP_ALL_ACCESS, false, wname);
+	free(wname);
+
+	if (!ffm->shm_mapping)
+		return false;
+
+	ffm->shm = MapViewOfFile(ffm->shm_mapping, FILE_MAP_ALL_ACCESS,
+			0, 0, 0);
+	if (!ffm->shm ||
+	    !VirtualQuery(ffm->shm, &mbi, sizeof(mbi))) {
+		shm_close(ffm);
+		return false;
+	}
+
+	ffm->shm_size = mbi.RegionSize;
+	ffm->space_event = open_space_event(name);
+	return true;
+}
+#else
+static void shm_close(struct ffmpeg_mux *ffm)
+{
+	if (ffm->shm)
+		munmap(ffm->shm, ffm->shm_size);
+
+	ffm->shm = NULL;
+}
+
+static bool shm_open_ring(struct ffmpeg_mux *ffm, const char *name)
+{
+	struct stat st;
+	void *data;
+	int fd;
+
+	fd = shm_open(name, O_RDWR, 0);
+	if (fd == -1)
+		return false;
+
+	/* nobody else needs to find it anymore */
+	shm_unlink(name);
+
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		close(fd);
+		return false;
+	}
+
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+		return false;
+
+	ffm->shm = data;
+	ffm->shm_size = (size_t)st.st_size;
+	return true;
+}
+#endif
+
+/* if this fails the muxer never switches over and keeps using the pipe */
+static void ffmpeg_mux_init_shm(struct ffmpeg_mux *ffm, const char *name)
+{
+	if (!shm_open_ring(ffm, name)) {
+		fprintf(stderr, "Couldn't open shared memory '%s'\n", name);
+		return;
+	}
+
+	if (!check_shm(ffm->shm, ffm->shm_size)) {
+		fprintf(stderr, "Invalid shared memory header\n");
+		shm_close(ffm);
+		return;
+	}
+
+	ffm_atomic_store(&ffm->shm->reader_ready, 1);
+}
+
 static void header_free(struct header *header)
 {
 	free(header->data);
@@ -128,6 +283,11 @@ static void free_avformat(struct ffmpeg_mux *ffm)
 
 static void ffmpeg_mux_free(struct ffmpeg_mux *ffm)
 {
+	/* lets the muxer know nothing reads the ring anymore */
+	if (ffm->shm)
+		ffm_atomic_store(&ffm->shm->reader_ready, 0);
+	shm_close(ffm);
+
 	if (ffm->initialized) {
 		av_write_trailer(ffm->output);
 	}
@@ -407,15 +567,83 @@ static size_t safe_read(void *vdata, size_t size)
 	return total;
 }
 
+/* lets the muxer know there is room in the ring again */
+static inline void signal_space(struct ffmpeg_mux *ffm)
+{
+	if (!ffm_atomic_exchange(&ffm->shm->writer_waiting, 0))
+		return;
+
+#ifdef _WIN32
+	if (ffm->space_event)
+		SetEvent(ffm->space_event);
+#elif defined(FFM_SHM_SPACE_SEM)
+	sem_post(&ffm->shm->space_sem);
+#endif
+}
+
+static size_t shm_read(struct ffmpeg_mux *ffm, void *vdata, size_t size)
+{
+	struct ffm_shm_header *shm = ffm->shm;
+	uint8_t *data = vdata;
+	size_t  total = size;
+
+	while (size > 0) {
+		size_t in_size = ffm_shm_read(shm, data, size);
+		if (in_size) {
+			size -= in_size;
+			data += in_size;
+			signal_space(ffm);
+			continue;
+		}
+
+		/* ask for a wakeup, then check again in case the data arrived
+		 * before the writer could see the request */
+		ffm_atomic_store(&shm->reader_waiting, 1);
+
+		if (!ffm_shm_used(shm)) {
+			uint8_t wake;
+			if (fread(&wake, 1, 1, stdin) == 0 &&
+			    !ffm_shm_used(shm))
+				return 0;
+		}
+
+		ffm_atomic_store(&shm->reader_waiting, 0);
+	}
+
+	return total;
+}
+
+static inline size_t ffmpeg_mux_read(struct ffmpeg_mux *ffm, void *data,
+		size_t size)
+{
+	return ffm->shm_active ?
+		shm_read(ffm, data, size) : safe_read(data, size);
+}
+
+static bool ffmpeg_mux_read_info(struct ffmpeg_mux *ffm,
+		struct ffm_packet_info *info)
+{
+	for (;;) {
+		if (ffmpeg_mux_read(ffm, info, sizeof(*info)) != sizeof(*info))
+			return false;
+		if (info->type != FFM_PACKET_SWITCH_SHM)
+			return true;
+		if (!ffm->shm)
+			return false;
+
+		ffm->shm_active = true;
+	}
+}
+
 static bool ffmpeg_mux_get_header(struct ffmpeg_mux *ffm)
 {
 	struct ffm_packet_info info = {0};
 
-	bool success = safe_read(&info, sizeof(info)) == sizeof(info);
+	bool success = ffmpeg_mux_read_info(ffm, &info);
 	if (success) {
 		uint8_t *data = malloc(info.size);
 
-		if (safe_read(data, info.size) == info.size) {
+		if (ffmpeg_mux_read(ffm, data, info.size) == info.size) {
 			ffmpeg_mux_header(ffm, data, &info);
 		} else {
 			success = false;
@@ -448,6 +676,37 @@ static inline bool ffmpeg_mux_get_extra_data(struct ffmpeg_mux *ffm)
 #pragma warning(disable : 4996)
 #endif
 
+static inline bool is_mov_format(AVOutputFormat *format)
+{
+	return strcmp(format->name, "mp4") == 0 ||
+	       strcmp(format->name, "mov") == 0;
+}
+
+/* fragments are cut manually on keyframes (see check_fragment), so
+ * everything up to the last finished fragment stays playable if the
+ * process dies before the trailer is written */
+static void set_fragment_options(struct ffmpeg_mux *ffm, AVDictionary **dict)
+{
+	if (ffm->frag_duration <= 0)
+		return;
+
+	if (!is_mov_format(ffm->output->oformat)) {
+		printf("Fragmented output is only supported for mp4/mov, "
+		       "ignoring\n");
+		return;
+	}
+
+	if (av_dict_get(*dict, "movflags", NULL, 0)) {
+		printf("movflags set in muxer settings, not writing a "
+		       "fragmented file\n");
+		return;
+	}
+
+	av_dict_set(dict, "movflags",
+			"frag_custom+empty_moov+default_base_moof", 0);
+	ffm->fragmented = true;
+}
+
 static inline int open_output_file(struct ffmpeg_mux *ffm)
 {
 	AVOutputFormat *format = ffm->output->oformat;
@@ -476,6 +735,8 @@ static inline int open_output_file(struct ffmpeg_mux *ffm)
 		av_dict_free(&dict);
 	}
 
+	set_fragment_options(ffm, &dict);
+
 	if (av_dict_count(dict) > 0) {
 		printf("Using muxer settings:");
 
@@ -544,6 +805,19 @@ static int ffmpeg_mux_init_internal(struct ffmpeg_mux *ffm, int argc,
 {
 	argc--;
 	argv++;
+
+	while (argc >= 2) {
+		if (strcmp(argv[0], "--shm") == 0)
+			ffmpeg_mux_init_shm(ffm, argv[1]);
+		else if (strcmp(argv[0], "--frag") == 0)
+			ffm->frag_duration = atoi(argv[1]);
+		else
+			break;
+
+		argc -= 2;
+		argv += 2;
+	}
+
 	if (!init_params(&argc, &argv, &ffm->params, &ffm->audio))
 		return FFM_ERROR;
 
@@ -604,6 +878,43 @@ static inline int64_t rescale_ts(struct ffmpeg_mux *ffm, int64_t val, int idx)
 			AV_ROUND_NEAR_INF | AV_ROUND_PASS_MINMAX);
 }
 
+/* cuts a fragment at the first keyframe (or audio packet, for audio-only
+ * files) once the fragment duration has been reached */
+static bool check_fragment(struct ffmpeg_mux *ffm, AVPacket *packet)
+{
+	AVStream *stream = get_stream(ffm, packet->stream_index);
+	AVStream *sync = ffm->video_stream ? ffm->video_stream :
+		ffm->audio_streams[0];
+	int64_t dts_usec;
+
+	if (!ffm->fragmented || stream != sync)
+		return true;
+	if (stream == ffm->video_stream && !(packet->flags & AV_PKT_FLAG_KEY))
+		return true;
+
+	dts_usec = av_rescale_q(packet->dts, stream->time_base,
+			AV_TIME_BASE_Q);
+
+	if (!ffm->frag_started) {
+		ffm->frag_started = true;
+		ffm->frag_start = dts_usec;
+		return true;
+	}
+
+	if (dts_usec - ffm->frag_start < ffm->frag_duration * 1000LL)
+		return true;
+
+	if (av_interleaved_write_frame(ffm->output, NULL) < 0 ||
+	    av_write_frame(ffm->output, NULL) < 0) {
+		printf("Failed to write fragment\n");
+		return false;
+	}
+
+	avio_flush(ffm->output->pb);
+	ffm->frag_start = dts_usec;
+	return true;
+}
+
 static inline bool ffmpeg_mux_packet(struct ffmpeg_mux *ffm, uint8_t *buf,
 		struct ffm_packet_info *info)
 {
@@ -626,6 +937,9 @@ static inline bool ffmpeg_mux_packet(struct ffmpeg_mux *ffm, uint8_t *buf,
 	if (info->keyframe)
 		packet.flags = AV_PKT_FLAG_KEY;
 
+	if (!check_fragment(ffm, &packet))
+		return false;
+
 	return av_interleaved_write_frame(ffm->output, &packet) >= 0;
 }
 
@@ -669,10 +983,10 @@ int main(int argc, char *argv[])
 		return ret;
 	}
 
-	while (!fail && safe_read(&info, sizeof(info)) == sizeof(info)) {
+	while (!fail && ffmpeg_mux_read_info(&ffm, &info)) {
 		resize_buf_resize(&rb, info.size);
 
-		if (safe_read(rb.buf, info.size) == info.size) {
+		if (ffmpeg_mux_read(&ffm, rb.buf, info.size) == info.size) {
 			ffmpeg_mux_packet(&ffm, rb.buf, &info);
 		} else {
 			fail = true;
@@ -17,10 +17,23 @@
 #pragma once
 
 #include <stdint.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/* process shared semaphores aren't available on macOS, where a writer with
+ * a full ring falls back to polling */
+#if !defined(_WIN32) && !defined(__APPLE__)
+#define FFM_SHM_SPACE_SEM
+#include <semaphore.h>
+#endif
 
 enum ffm_packet_type {
 	FFM_PACKET_VIDEO,
-	FFM_PACKET_AUDIO
+	FFM_PACKET_AUDIO,
+	FFM_PACKET_SWITCH_SHM
 };
 
 #define FFM_SUCCESS      0
@@ -35,3 +48,128 @@ struct ffm_packet_info {
 	enum ffm_packet_type type;
 	bool                 keyframe;
 };
+
+/* ------------------------------------------------------------------------- */
+/* shared memory transport
+ *
+ * Packets can be handed over through a ring in shared memory instead of the
+ * pipe.  The name of the mapping is passed with --shm before the regular
+ * arguments.  ffmpeg-mux sets reader_ready once it has mapped the ring, and
+ * the muxer then switches over by sending an FFM_PACKET_SWITCH_SHM info
+ * through the pipe.  If either side cannot set up the mapping, everything
+ * simply keeps going through the pipe.
+ *
+ * After the switch the pipe only carries single byte wakeups, written while
+ * reader_waiting is set, and the end of the stream.
+ *
+ * The other way around, the muxer sets writer_waiting when the ring is full,
+ * and the reader signals space_sem (or on windows the named event with
+ * FFM_SHM_EVENT_SUFFIX appended to the mapping name) once it has advanced
+ * read_pos. */
+
+#define FFM_SHM_MAGIC        0x4d485346 /* "FSHM" */
+#define FFM_SHM_HEADER_SIZE  128
+#define FFM_SHM_CAPACITY     (16 * 1024 * 1024) /* must be a power of two */
+#define FFM_SHM_EVENT_SUFFIX "-space"
+
+struct ffm_shm_header {
+	uint32_t             magic;
+	uint32_t             capacity;
+	volatile long        write_pos;
+	volatile long        read_pos;
+	volatile long        reader_ready;
+	volatile long        reader_waiting;
+	volatile long        writer_waiting;
+#ifdef FFM_SHM_SPACE_SEM
+	sem_t                space_sem;
+#endif
+};
+
+typedef char ffm_shm_header_fits[
+	sizeof(struct ffm_shm_header) <= FFM_SHM_HEADER_SIZE ? 1 : -1];
+
+#ifdef _MSC_VER
+static inline long ffm_atomic_load(volatile long *ptr)
+{
+	return _InterlockedOr(ptr, 0);
+}
+
+static inline long ffm_atomic_exchange(volatile long *ptr, long val)
+{
+	return _InterlockedExchange(ptr, val);
+}
+#else
+static inline long ffm_atomic_load(volatile long *ptr)
+{
+	return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+static inline long ffm_atomic_exchange(volatile long *ptr, long val)
+{
+	return __atomic_exchange_n(ptr, val, __ATOMIC_SEQ_CST);
+}
+#endif
+
+static inline void ffm_atomic_store(volatile long *ptr, long val)
+{
+	ffm_atomic_exchange(ptr, val);
+}
+
+static inline uint8_t *ffm_shm_data(struct ffm_shm_header *shm)
+{
+	return (uint8_t*)shm + FFM_SHM_HEADER_SIZE;
+}
+
+static inline size_t ffm_shm_used(struct ffm_shm_header *shm)
+{
+	unsigned long write_pos = (unsigned long)ffm_atomic_load(&shm->write_pos);
+	unsigned long read_pos = (unsigned long)ffm_atomic_load(&shm->read_pos);
+	return (size_t)(write_pos - read_pos);
+}
+
+/* copies as much as currently fits, returns the number of bytes written */
+static inline size_t ffm_shm_write(struct ffm_shm_header *shm,
+		const uint8_t *data, size_t size)
+{
+	unsigned long pos = (unsigned long)ffm_atomic_load(&shm->write_pos);
+	size_t space = shm->capacity - ffm_shm_used(shm);
+	size_t offset = pos & (shm->capacity - 1);
+	size_t first;
+
+	if (size > space)
+		size = space;
+
+	first = shm->capacity - offset;
+	if (first > size)
+		first = size;
+
+	memcpy(ffm_shm_data(shm) + offset, data, first);
+	memcpy(ffm_shm_data(shm), data + first, size - first);
+
+	ffm_atomic_store(&shm->write_pos, (long)(pos + size));
+	return size;
+}
+
+/* copies out as much as is currently available, returns the number of
+ * bytes read */
+static inline size_t ffm_shm_read(struct ffm_shm_header *shm,
+		uint8_t *data, size_t size)
+{
+	unsigned long pos = (unsigned long)ffm_atomic_load(&shm->read_pos);
+	size_t used = ffm_shm_used(shm);
+	size_t offset = pos & (shm->capacity - 1);
+	size_t first;
+
+	if (size > used)
+		size = used;
+
+	first = shm->capacity - offset;
+	if (first > size)
+		first = size;
+
+	memcpy(data, ffm_shm_data(shm) + offset, first);
+	memcpy(data + first, ffm_shm_data(shm), size - first);
+
+	ffm_atomic_store(&shm->read_pos, (long)(pos + size));
+	return size;
+}
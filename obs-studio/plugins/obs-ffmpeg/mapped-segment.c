@@ -0,0 +1,217 @@
+/******************************************************************************
+    Copyright (C) 2015 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <string.h>
+#include <util/platform.h>
+#include <util/bmem.h>
+#include "mapped-segment.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+bool mapped_segment_open(struct mapped_segment *seg, const char *path,
+		size_t size)
+{
+	LARGE_INTEGER li;
+	wchar_t *wpath = NULL;
+	HANDLE file;
+	HANDLE mapping;
+	void *data;
+
+	memset(seg, 0, sizeof(*seg));
+
+	if (!os_utf8_to_wcs_ptr(path, 0, &wpath))
+		return false;
+
+	file = CreateFileW(wpath, GENERIC_READ | GENERIC_WRITE,
+			FILE_SHARE_DELETE, NULL, CREATE_ALWAYS,
+			FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+			NULL);
+	bfree(wpath);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	li.QuadPart = (LONGLONG)size;
+	if (!SetFilePointerEx(file, li, NULL, FILE_BEGIN) ||
+	    !SetEndOfFile(file)) {
+		CloseHandle(file);
+		return false;
+	}
+
+	mapping = CreateFileMappingW(file, NULL, PAGE_READWRITE,
+			(DWORD)((uint64_t)size >> 32), (DWORD)size, NULL);
+	if (!mapping) {
+		CloseHandle(file);
+		return false;
+	}
+
+	data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (!data) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	seg->data = data;
+	seg->size = size;
+	seg->file = file;
+	seg->mapping = mapping;
+	return true;
+}
+
+bool mapped_segment_create_shared(struct mapped_segment *seg,
+		const char *name, size_t size)
+{
+	wchar_t *wname = NULL;
+	HANDLE mapping;
+	void *data;
+
+	memset(seg, 0, sizeof(*seg));
+
+	if (!os_utf8_to_wcs_ptr(name, 0, &wname))
+		return false;
+
+	mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL,
+			PAGE_READWRITE, (DWORD)((uint64_t)size >> 32),
+			(DWORD)size, wname);
+	bfree(wname);
+
+	if (!mapping)
+		return false;
+	if (GetLastError() == ERROR_ALREADY_EXISTS) {
+		CloseHandle(mapping);
+		return false;
+	}
+
+	data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (!data) {
+		CloseHandle(mapping);
+		return false;
+	}
+
+	seg->data = data;
+	seg->size = size;
+	seg->mapping = mapping;
+	return true;
+}
+
+void mapped_segment_close(struct mapped_segment *seg)
+{
+	if (seg->data)
+		UnmapViewOfFile(seg->data);
+	if (seg->mapping)
+		CloseHandle(seg->mapping);
+	if (seg->file)
+		CloseHandle(seg->file);
+
+	memset(seg, 0, sizeof(*seg));
+}
+
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static inline bool preallocate(int fd, size_t size)
+{
+#ifdef __linux__
+	/* reserve the blocks up front so writing into the mapping can't fail
+	 * with SIGBUS on a full disk later on */
+	if (posix_fallocate(fd, 0, (off_t)size) == 0)
+		return true;
+#endif
+	return ftruncate(fd, (off_t)size) == 0;
+}
+
+bool mapped_segment_open(struct mapped_segment *seg, const char *path,
+		size_t size)
+{
+	void *data;
+	int fd;
+
+	memset(seg, 0, sizeof(*seg));
+
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd == -1)
+		return false;
+
+	if (!preallocate(fd, size)) {
+		close(fd);
+		unlink(path);
+		return false;
+	}
+
+	data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	unlink(path);
+
+	if (data == MAP_FAILED)
+		return false;
+
+	seg->data = data;
+	seg->size = size;
+	return true;
+}
+
+bool mapped_segment_create_shared(struct mapped_segment *seg,
+		const char *name, size_t size)
+{
+	void *data;
+	int fd;
+
+	memset(seg, 0, sizeof(*seg));
+
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd == -1)
+		return false;
+
+	if (ftruncate(fd, (off_t)size) != 0) {
+		close(fd);
+		shm_unlink(name);
+		return false;
+	}
+
+	data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		shm_unlink(name);
+		return false;
+	}
+
+	seg->data = data;
+	seg->size = size;
+	seg->shm_name = bstrdup(name);
+	return true;
+}
+
+void mapped_segment_close(struct mapped_segment *seg)
+{
+	if (seg->data)
+		munmap(seg->data, seg->size);
+	if (seg->shm_name) {
+		shm_unlink(seg->shm_name);
+		bfree(seg->shm_name);
+	}
+
+	memset(seg, 0, sizeof(*seg));
+}
+
+#endif
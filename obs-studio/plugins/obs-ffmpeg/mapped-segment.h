@@ -0,0 +1,52 @@
+/******************************************************************************
+    Copyright (C) 2015 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <util/c99defs.h>
+
+/*
+ * Fixed size, pre-allocated file mapped into memory.  The backing file is
+ * removed as soon as it is mapped (or on close on Windows), so nothing is
+ * left behind if the process exits unexpectedly.
+ */
+struct mapped_segment {
+	uint8_t *data;
+	size_t  size;
+#ifdef _WIN32
+	void    *file;
+	void    *mapping;
+#else
+	char    *shm_name;
+#endif
+};
+
+extern bool mapped_segment_open(struct mapped_segment *seg, const char *path,
+		size_t size);
+
+/* Named shared memory instead of a file, for handing to another process.
+ * The name is removed again on close (or by the other process once it has
+ * opened it, whichever comes first). */
+extern bool mapped_segment_create_shared(struct mapped_segment *seg,
+		const char *name, size_t size);
+extern void mapped_segment_close(struct mapped_segment *seg);
+
+static inline bool mapped_segment_contains(const struct mapped_segment *seg,
+		const uint8_t *ptr)
+{
+	return ptr >= seg->data && ptr < seg->data + seg->size;
+}
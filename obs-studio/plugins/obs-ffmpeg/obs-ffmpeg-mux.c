@@ -15,6 +15,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <inttypes.h>
 #include <obs-module.h>
 #include <obs-hotkey.h>
 #include <obs-avc.h>
@@ -25,6 +26,15 @@
 #include <util/circlebuf.h>
 #include <util/threading.h>
 #include "ffmpeg-mux/ffmpeg-mux.h"
+#include "mapped-segment.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(FFM_SHM_SPACE_SEM)
+#include <errno.h>
+#include <time.h>
+#endif
 
 #include <libavformat/avformat.h>
 
@@ -38,9 +48,15 @@
 struct ffmpeg_muxer {
 	obs_output_t      *output;
 	os_process_pipe_t *pipe;
+	struct mapped_segment shm;
+	bool              shm_active;
+#ifdef _WIN32
+	HANDLE            space_event;
+#endif
 	int64_t           stop_ts;
 	uint64_t          total_bytes;
 	struct dstr       path;
+	struct dstr       shm_name;
 	bool              sent_headers;
 	volatile bool     active;
 	volatile bool     stopping;
@@ -60,23 +76,71 @@ struct ffmpeg_muxer {
 	pthread_t                     mux_thread;
 	bool                          mux_thread_joinable;
 	volatile bool                 muxing;
+
+	/* disk-backed replay buffer: packet payloads live in a ring of mapped
+	 * segment files and the packets circlebuf only holds the index */
+	struct mapped_segment         *segments;
+	size_t                        num_segments;
+	uint64_t                      write_seq;
+	size_t                        write_offset;
+	uint64_t                      mux_seq;
+	bool                          disk_stalled;
 };
 
+#define DISK_SEGMENT_SIZE     (64 * 1024 * 1024)
+#define DISK_SPARE_SEGMENTS   2
+
+/* how long the shared memory ring may stay full before ffmpeg-mux is
+ * considered gone */
+#define SHM_STALL_TIMEOUT_NS  (30ULL * 1000000000ULL)
+
+/* how often a full ring checks that ffmpeg-mux is still there */
+#define SHM_PROBE_INTERVAL_MS 50
+#define SHM_PROBE_INTERVAL_NS (SHM_PROBE_INTERVAL_MS * 1000000ULL)
+
 static const char *ffmpeg_mux_getname(void *type)
 {
 	UNUSED_PARAMETER(type);
 	return obs_module_text("FFmpegMuxer");
 }
 
+static inline void join_mux_thread(struct ffmpeg_muxer *stream)
+{
+	if (stream->mux_thread_joinable) {
+		pthread_join(stream->mux_thread, NULL);
+		stream->mux_thread_joinable = false;
+	}
+}
+
+static void free_segments(struct ffmpeg_muxer *stream)
+{
+	/* the mux thread reads straight out of the mappings */
+	join_mux_thread(stream);
+
+	for (size_t i = 0; i < stream->num_segments; i++)
+		mapped_segment_close(&stream->segments[i]);
+
+	bfree(stream->segments);
+	stream->segments = NULL;
+	stream->num_segments = 0;
+	stream->write_seq = 0;
+	stream->write_offset = 0;
+	stream->mux_seq = 0;
+	stream->disk_stalled = false;
+}
+
 static inline void replay_buffer_clear(struct ffmpeg_muxer *stream)
 {
 	while (stream->packets.size > 0) {
 		struct encoder_packet pkt;
 		circlebuf_pop_front(&stream->packets, &pkt, sizeof(pkt));
-		obs_encoder_packet_release(&pkt);
+		if (!stream->segments)
+			obs_encoder_packet_release(&pkt);
 	}
 
 	circlebuf_free(&stream->packets);
+	if (stream->segments)
+		free_segments(stream);
 	stream->cur_size = 0;
 	stream->cur_time = 0;
 	stream->max_size = 0;
@@ -85,17 +149,19 @@ static inline void replay_buffer_clear(struct ffmpeg_muxer *stream)
 	stream->keyframes = 0;
 }
 
+static int stop_pipe(struct ffmpeg_muxer *stream);
+
 static void ffmpeg_mux_destroy(void *data)
 {
 	struct ffmpeg_muxer *stream = data;
 
 	replay_buffer_clear(stream);
-	if (stream->mux_thread_joinable)
-		pthread_join(stream->mux_thread, NULL);
+	join_mux_thread(stream);
 	da_free(stream->mux_packets);
 
-	os_process_pipe_destroy(stream->pipe);
+	stop_pipe(stream);
 	dstr_free(&stream->path);
+	dstr_free(&stream->shm_name);
 	bfree(stream);
 }
 
@@ -220,6 +286,17 @@ static void add_muxer_params(struct dstr *cmd, struct ffmpeg_muxer *stream)
 	dstr_free(&mux);
 }
 
+static void add_fragment_params(struct dstr *cmd, struct ffmpeg_muxer *stream)
+{
+	obs_data_t *settings = obs_output_get_settings(stream->output);
+	int duration = (int)obs_data_get_int(settings, "fragment_duration");
+
+	if (obs_data_get_bool(settings, "fragmented") && duration > 0)
+		dstr_catf(cmd, "--frag %d ", duration);
+
+	obs_data_release(settings);
+}
+
 static void build_command_line(struct ffmpeg_muxer *stream, struct dstr *cmd,
 		const char *path)
 {
@@ -239,7 +316,14 @@ static void build_command_line(struct ffmpeg_muxer *stream, struct dstr *cmd,
 
 	dstr_init_move_array(cmd, obs_module_file(FFMPEG_MUX));
 	dstr_insert_ch(cmd, 0, '\"');
-	dstr_cat(cmd, "\" \"");
+	dstr_cat(cmd, "\" ");
+
+	if (stream->shm.data)
+		dstr_catf(cmd, "--shm \"%s\" ", stream->shm_name.array);
+
+	add_fragment_params(cmd, stream);
+
+	dstr_cat(cmd, "\"");
 
     dstr_copy(&stream->path, path);
 	dstr_replace(&stream->path, "\"", "\"\"");
@@ -261,13 +345,94 @@ static void build_command_line(struct ffmpeg_muxer *stream, struct dstr *cmd,
 	add_muxer_params(cmd, stream);
 }
 
+/* packets go through the pipe if this fails */
+static void init_shm(struct ffmpeg_muxer *stream)
+{
+	static volatile long shm_counter = 0;
+	struct ffm_shm_header *shm;
+	long id = os_atomic_inc_long(&shm_counter);
+
+#ifdef _WIN32
+	dstr_printf(&stream->shm_name, "Local\\obsmux-%"PRIx64"-%ld",
+			os_gettime_ns(), id);
+#else
+	dstr_printf(&stream->shm_name, "/obsmux-%"PRIx64"-%ld",
+			os_gettime_ns(), id);
+#endif
+
+	if (!mapped_segment_create_shared(&stream->shm, stream->shm_name.array,
+				FFM_SHM_HEADER_SIZE + FFM_SHM_CAPACITY)) {
+		warn("Failed to create shared memory, using the pipe");
+		return;
+	}
+
+	shm = (struct ffm_shm_header*)stream->shm.data;
+	shm->magic = FFM_SHM_MAGIC;
+	shm->capacity = FFM_SHM_CAPACITY;
+	stream->shm_active = false;
+
+#ifdef _WIN32
+	struct dstr event_name = {0};
+	wchar_t *wname = NULL;
+
+	dstr_printf(&event_name, "%s%s", stream->shm_name.array,
+			FFM_SHM_EVENT_SUFFIX);
+	if (os_utf8_to_wcs_ptr(event_name.array, 0, &wname)) {
+		stream->space_event = CreateEventW(NULL, false, false, wname);
+		bfree(wname);
+	}
+	dstr_free(&event_name);
+
+	if (!stream->space_event)
+		warn("Failed to create shared memory event, polling instead");
+#elif defined(FFM_SHM_SPACE_SEM)
+	if (sem_init(&shm->space_sem, 1, 0) != 0) {
+		warn("Failed to create shared memory semaphore, using the "
+		     "pipe");
+		mapped_segment_close(&stream->shm);
+	}
+#endif
+}
+
+static void free_shm(struct ffmpeg_muxer *stream)
+{
+#ifdef _WIN32
+	if (stream->space_event) {
+		CloseHandle(stream->space_event);
+		stream->space_event = NULL;
+	}
+#elif defined(FFM_SHM_SPACE_SEM)
+	if (stream->shm.data) {
+		struct ffm_shm_header *shm =
+			(struct ffm_shm_header*)stream->shm.data;
+		sem_destroy(&shm->space_sem);
+	}
+#endif
+
+	mapped_segment_close(&stream->shm);
+	stream->shm_active = false;
+}
+
 static inline void start_pipe(struct ffmpeg_muxer *stream, const char *path)
 {
 	struct dstr cmd;
+
+	init_shm(stream);
+
 	build_command_line(stream, &cmd, path);
 	stream->pipe = os_process_pipe_create(cmd.array, "w");
 	dstr_free(&cmd);
 }
+
+static int stop_pipe(struct ffmpeg_muxer *stream)
+{
+	/* waits for ffmpeg-mux to drain the ring and exit */
+	int ret = os_process_pipe_destroy(stream->pipe);
+	stream->pipe = NULL;
+
+	free_shm(stream);
+	return ret;
+}
 //开始读取stream->pipe
 static bool ffmpeg_mux_start(void *data)
 {
@@ -287,6 +452,7 @@ static bool ffmpeg_mux_start(void *data)
 
     if (!stream->pipe) {
         warn("Failed to create process pipe");
+        stop_pipe(stream);
         return false;
     }
 
@@ -305,8 +471,7 @@ static int deactivate(struct ffmpeg_muxer *stream)
 	int ret = -1;
 
 	if (active(stream)) {
-		ret = os_process_pipe_destroy(stream->pipe);
-		stream->pipe = NULL;
+		ret = stop_pipe(stream);
 
 		os_atomic_set_bool(&stream->active, false);
 		os_atomic_set_bool(&stream->sent_headers, false);
@@ -346,11 +511,151 @@ static void signal_failure(struct ffmpeg_muxer *stream)
 	os_atomic_set_bool(&stream->capturing, false);
 }
 
+/* ffmpeg-mux ignores stray wakeups, so this also doubles as a check that
+ * it is still alive: writing to the pipe fails once it has exited */
+static bool send_wakeup(struct ffmpeg_muxer *stream)
+{
+	uint8_t wake = 0;
+
+	return os_process_pipe_write(stream->pipe, &wake, 1) == 1 &&
+		os_process_pipe_flush(stream->pipe);
+}
+
+static bool wake_reader(struct ffmpeg_muxer *stream)
+{
+	struct ffm_shm_header *shm = (struct ffm_shm_header*)stream->shm.data;
+
+	if (!ffm_atomic_exchange(&shm->reader_waiting, 0))
+		return true;
+
+	return send_wakeup(stream);
+}
+
+/* blocks until ffmpeg-mux has made room in the ring, or for at most one
+ * probe interval */
+static void wait_for_space(struct ffmpeg_muxer *stream,
+		struct ffm_shm_header *shm)
+{
+	ffm_atomic_store(&shm->writer_waiting, 1);
+
+	/* the reader may have made room before it could see the flag */
+	if (ffm_shm_used(shm) < shm->capacity) {
+		ffm_atomic_store(&shm->writer_waiting, 0);
+		return;
+	}
+
+#ifdef _WIN32
+	if (stream->space_event) {
+		WaitForSingleObject(stream->space_event,
+				SHM_PROBE_INTERVAL_MS);
+		return;
+	}
+	os_sleep_ms(1);
+
+#elif defined(FFM_SHM_SPACE_SEM)
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_nsec += SHM_PROBE_INTERVAL_NS;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	while (sem_timedwait(&shm->space_sem, &ts) != 0 && errno == EINTR)
+		;
+
+	UNUSED_PARAMETER(stream);
+#else
+	os_sleep_ms(1);
+	UNUSED_PARAMETER(stream);
+#endif
+}
+
+static bool shm_write(struct ffmpeg_muxer *stream, const uint8_t *data,
+		size_t size)
+{
+	struct ffm_shm_header *shm = (struct ffm_shm_header*)stream->shm.data;
+	uint64_t stall_ts = 0;
+	uint64_t probe_ts = 0;
+
+	for (;;) {
+		size_t written;
+
+		if (!ffm_atomic_load(&shm->reader_ready)) {
+			warn("ffmpeg-mux stopped reading from shared memory");
+			return false;
+		}
+
+		written = ffm_shm_write(shm, data, size);
+		data += written;
+		size -= written;
+
+		if (!wake_reader(stream))
+			return false;
+		if (!size)
+			return true;
+
+		if (written) {
+			stall_ts = 0;
+		} else {
+			uint64_t ts = os_gettime_ns();
+
+			if (!stall_ts) {
+				stall_ts = probe_ts = ts;
+
+			} else if (ts - stall_ts > SHM_STALL_TIMEOUT_NS) {
+				warn("ffmpeg-mux stopped responding");
+				return false;
+
+			} else if (ts - probe_ts > SHM_PROBE_INTERVAL_NS) {
+				probe_ts = ts;
+				if (!send_wakeup(stream)) {
+					warn("ffmpeg-mux exited while the "
+					     "shared memory ring was full");
+					return false;
+				}
+			}
+		}
+
+		wait_for_space(stream, shm);
+	}
+}
+
+static inline bool write_data(struct ffmpeg_muxer *stream,
+		const uint8_t *data, size_t size)
+{
+	if (stream->shm_active)
+		return shm_write(stream, data, size);
+
+	return os_process_pipe_write(stream->pipe, data, size) == size;
+}
+
+/* switches over once ffmpeg-mux has mapped the shared memory */
+static inline bool check_shm_ready(struct ffmpeg_muxer *stream)
+{
+	struct ffm_shm_header *shm = (struct ffm_shm_header*)stream->shm.data;
+	struct ffm_packet_info info = {.type = FFM_PACKET_SWITCH_SHM};
+	size_t ret;
+
+	if (!shm || stream->shm_active || !ffm_atomic_load(&shm->reader_ready))
+		return true;
+
+	/* everything after this goes through the ring, so the switch must
+	 * not sit in the pipe's buffer */
+	ret = os_process_pipe_write(stream->pipe, (const uint8_t*)&info,
+			sizeof(info));
+	if (ret != sizeof(info) || !os_process_pipe_flush(stream->pipe))
+		return false;
+
+	stream->shm_active = true;
+	return true;
+}
+
 static bool write_packet(struct ffmpeg_muxer *stream,
 		struct encoder_packet *packet)
 {
 	bool is_video = packet->type == OBS_ENCODER_VIDEO;
-	size_t ret;
 
 	struct ffm_packet_info info = {
 		.pts = packet->pts,
@@ -361,16 +666,19 @@ static bool write_packet(struct ffmpeg_muxer *stream,
 		.keyframe = packet->keyframe
 	};
 
-	ret = os_process_pipe_write(stream->pipe, (const uint8_t*)&info,
-			sizeof(info));
-	if (ret != sizeof(info)) {
+	if (!check_shm_ready(stream)) {
+		warn("os_process_pipe_write for transport switch failed");
+		signal_failure(stream);
+		return false;
+	}
+
+	if (!write_data(stream, (const uint8_t*)&info, sizeof(info))) {
 		warn("os_process_pipe_write for info structure failed");
 		signal_failure(stream);
 		return false;
 	}
 //packet->data写入到stream->pipe，就可以读取stream->pipe的数据保存了
-	ret = os_process_pipe_write(stream->pipe, packet->data, packet->size);
-	if (ret != packet->size) {
+	if (!write_data(stream, packet->data, packet->size)) {
 		warn("os_process_pipe_write for packet data failed");
 		signal_failure(stream);
 		return false;
@@ -460,9 +768,19 @@ static obs_properties_t *ffmpeg_mux_properties(void *unused)
 	obs_properties_add_text(props, "path",
 			obs_module_text("FilePath"),
 			OBS_TEXT_DEFAULT);
+	obs_properties_add_bool(props, "fragmented",
+			obs_module_text("Fragmented"));
+	obs_properties_add_int(props, "fragment_duration",
+			obs_module_text("FragmentDuration"), 100, 60000, 100);
 	return props;
 }
 
+static void ffmpeg_mux_defaults(obs_data_t *s)
+{
+	obs_data_set_default_bool(s, "fragmented", false);
+	obs_data_set_default_int(s, "fragment_duration", 2000);
+}
+
 static uint64_t ffmpeg_mux_total_bytes(void *data)
 {
 	struct ffmpeg_muxer *stream = data;
@@ -481,6 +799,7 @@ struct obs_output_info ffmpeg_muxer = {
 	.stop           = ffmpeg_mux_stop,
 	.encoded_packet = ffmpeg_mux_data,
 	.get_total_bytes= ffmpeg_mux_total_bytes,
+	.get_defaults   = ffmpeg_mux_defaults,
 	.get_properties = ffmpeg_mux_properties
 };
 
@@ -536,6 +855,52 @@ static void replay_buffer_destroy(void *data)
 	ffmpeg_mux_destroy(data);
 }
 
+static void init_segments(struct ffmpeg_muxer *stream, obs_data_t *settings)
+{
+	const char *dir = obs_data_get_string(settings, "disk_buffer_dir");
+	struct dstr path = {0};
+	size_t count;
+
+	if (!stream->max_size) {
+		warn("Disk buffer requires a maximum size, keeping the "
+		     "replay buffer in memory");
+		return;
+	}
+
+	if (!dir || !*dir)
+		dir = obs_data_get_string(settings, "directory");
+
+	/* a save from a previous session still owns its packet refs */
+	join_mux_thread(stream);
+
+	count = (size_t)((stream->max_size + DISK_SEGMENT_SIZE - 1) /
+			DISK_SEGMENT_SIZE) + DISK_SPARE_SEGMENTS;
+
+	stream->segments = bzalloc(count * sizeof(struct mapped_segment));
+	stream->num_segments = count;
+
+	for (size_t i = 0; i < count; i++) {
+		dstr_printf(&path, "%s/.obs-replay-%p-%d.seg", dir, stream,
+				(int)i);
+
+		if (!mapped_segment_open(&stream->segments[i], path.array,
+					DISK_SEGMENT_SIZE)) {
+			warn("Failed to create disk buffer segment '%s', "
+			     "keeping the replay buffer in memory",
+			     path.array);
+			free_segments(stream);
+			break;
+		}
+	}
+
+	if (stream->segments)
+		info("Using %d disk buffer segments of %d MB in '%s'",
+				(int)count, DISK_SEGMENT_SIZE / (1024 * 1024),
+				dir);
+
+	dstr_free(&path);
+}
+
 static bool replay_buffer_start(void *data)
 {
 	struct ffmpeg_muxer *stream = data;
@@ -548,6 +913,9 @@ static bool replay_buffer_start(void *data)
 	obs_data_t *s = obs_output_get_settings(stream->output);
 	stream->max_time = obs_data_get_int(s, "max_time_sec") * 1000000LL;
 	stream->max_size = obs_data_get_int(s, "max_size_mb") * (1024 * 1024);
+
+	if (obs_data_get_bool(s, "use_disk_buffer"))
+		init_segments(stream, s);
 	obs_data_release(s);
 
 	os_atomic_set_bool(&stream->active, true);
@@ -580,7 +948,8 @@ static bool purge_front(struct ffmpeg_muxer *stream)
 		stream->cur_size -= (int64_t)pkt.size;
 	}
 
-	obs_encoder_packet_release(&pkt);
+	if (!stream->segments)
+		obs_encoder_packet_release(&pkt);
 	return keyframe;
 }
 
@@ -621,14 +990,19 @@ static inline void replay_buffer_purge(struct ffmpeg_muxer *stream,
 
 static void insert_packet(struct darray *array, struct encoder_packet *packet,
 		int64_t video_offset, int64_t *audio_offsets,
-		int64_t video_dts_offset, int64_t *audio_dts_offsets)
+		int64_t video_dts_offset, int64_t *audio_dts_offsets, bool ref)
 {
 	struct encoder_packet pkt;
 	DARRAY(struct encoder_packet) packets;
 	packets.da = *array;
 	size_t idx;
 
-	obs_encoder_packet_ref(&pkt, packet);
+	/* disk buffer payloads are not refcounted, they stay valid in their
+	 * segment until the mux thread is done with them */
+	if (ref)
+		obs_encoder_packet_ref(&pkt, packet);
+	else
+		pkt = *packet;
 
 	if (pkt.type == OBS_ENCODER_VIDEO) {
 		pkt.dts_usec -= video_offset;
@@ -670,14 +1044,14 @@ static void *replay_buffer_mux_thread(void *data)
 	for (size_t i = 0; i < stream->mux_packets.num; i++) {
 		struct encoder_packet *pkt = &stream->mux_packets.array[i];
 		write_packet(stream, pkt);
-		obs_encoder_packet_release(pkt);
+		if (!stream->segments)
+			obs_encoder_packet_release(pkt);
 	}
 
 	info("Wrote replay buffer to '%s'", stream->path.array);
 
 error:
-	os_process_pipe_destroy(stream->pipe);
-	stream->pipe = NULL;
+	stop_pipe(stream);
 	da_free(stream->mux_packets);
 	os_atomic_set_bool(&stream->muxing, false);
 	return NULL;
@@ -720,7 +1094,8 @@ static void replay_buffer_save(struct ffmpeg_muxer *stream)
 
 		insert_packet(&stream->mux_packets.da, pkt,
 				video_offset, audio_offsets,
-				video_dts_offset, audio_dts_offsets);
+				video_dts_offset, audio_dts_offsets,
+				!stream->segments);
 	}
 
 	/* ---------------------------- */
@@ -745,6 +1120,7 @@ static void replay_buffer_save(struct ffmpeg_muxer *stream)
 
 	/* ---------------------------- */
 
+	stream->mux_seq = stream->write_seq;
 	os_atomic_set_bool(&stream->muxing, true);
 	stream->mux_thread_joinable = pthread_create(&stream->mux_thread, NULL,
 			replay_buffer_mux_thread, stream) == 0;
@@ -761,6 +1137,101 @@ static void deactivate_replay_buffer(struct ffmpeg_muxer *stream)
 	replay_buffer_clear(stream);
 }
 
+/* drops everything stored in the segment about to be reused, then trims the
+ * front of the buffer back to a keyframe */
+static void purge_segment(struct ffmpeg_muxer *stream,
+		const struct mapped_segment *seg)
+{
+	struct encoder_packet pkt;
+	bool purged = false;
+
+	while (stream->packets.size) {
+		circlebuf_peek_front(&stream->packets, &pkt, sizeof(pkt));
+		if (!mapped_segment_contains(seg, pkt.data))
+			break;
+		purge_front(stream);
+		purged = true;
+	}
+
+	while (purged && stream->packets.size) {
+		circlebuf_peek_front(&stream->packets, &pkt, sizeof(pkt));
+		if (pkt.type == OBS_ENCODER_VIDEO && pkt.keyframe)
+			break;
+		purge_front(stream);
+	}
+}
+
+/* returns false if the next segment is still being read by a save */
+static bool next_segment(struct ffmpeg_muxer *stream)
+{
+	uint64_t seq = stream->write_seq + 1;
+	struct mapped_segment *seg =
+		&stream->segments[seq % stream->num_segments];
+
+	/* a save in progress still reads from the segment being recycled;
+	 * the spare segments make this unlikely, but it must not be
+	 * overwritten underneath the mux thread, and blocking here would
+	 * stall the encoders */
+	if (seq >= stream->num_segments &&
+	    seq - stream->num_segments <= stream->mux_seq &&
+	    os_atomic_load_bool(&stream->muxing)) {
+		warn("Replay save is behind the disk buffer, dropping "
+		     "packets until it finishes");
+		stream->disk_stalled = true;
+		return false;
+	}
+
+	stream->write_seq = seq;
+	purge_segment(stream, seg);
+	stream->write_offset = 0;
+	return true;
+}
+
+/* after dropping packets, only resume once the save is done, and on a
+ * keyframe so the buffer stays decodable */
+static bool disk_buffer_resume(struct ffmpeg_muxer *stream,
+		struct encoder_packet *packet)
+{
+	if (os_atomic_load_bool(&stream->muxing))
+		return false;
+
+	if (obs_output_get_video_encoder(stream->output) &&
+	    (packet->type != OBS_ENCODER_VIDEO || !packet->keyframe))
+		return false;
+
+	info("Replay save finished, resuming the disk buffer");
+	stream->disk_stalled = false;
+	return true;
+}
+
+static bool spill_packet(struct ffmpeg_muxer *stream,
+		struct encoder_packet *dst, struct encoder_packet *src)
+{
+	struct mapped_segment *seg;
+
+	if (src->size >= DISK_SEGMENT_SIZE) {
+		warn("Dropping %d byte packet, larger than a disk buffer "
+		     "segment", (int)src->size);
+		return false;
+	}
+
+	if (stream->disk_stalled && !disk_buffer_resume(stream, src))
+		return false;
+
+	if (stream->write_offset + src->size >= DISK_SEGMENT_SIZE &&
+	    !next_segment(stream))
+		return false;
+
+	seg = &stream->segments[stream->write_seq % stream->num_segments];
+
+	*dst = *src;
+	dst->data = seg->data + stream->write_offset;
+	memcpy(dst->data, src->data, src->size);
+
+	stream->write_offset += src->size;
+	return true;
+}
+
 static void replay_buffer_data(void *data, struct encoder_packet *packet)
 {
 	struct ffmpeg_muxer *stream = data;
@@ -776,26 +1247,29 @@ static void replay_buffer_data(void *data, struct encoder_packet *packet)
 		}
 	}
 
-	obs_encoder_packet_ref(&pkt, packet);
+	if (stream->segments) {
+		if (!spill_packet(stream, &pkt, packet))
+			return;
+	} else {
+		obs_encoder_packet_ref(&pkt, packet);
+	}
+
 	replay_buffer_purge(stream, &pkt);
 
 	if (!stream->packets.size)
 		stream->cur_time = pkt.dts_usec;
 	stream->cur_size += pkt.size;
 
-	circlebuf_push_back(&stream->packets, packet, sizeof(*packet));
+	circlebuf_push_back(&stream->packets, &pkt, sizeof(pkt));
 
-	if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe)
+	if (pkt.type == OBS_ENCODER_VIDEO && pkt.keyframe)
 		stream->keyframes++;
 
 	if (stream->save_ts && packet->sys_dts_usec >= stream->save_ts) {
 		if (os_atomic_load_bool(&stream->muxing))
 			return;
 
-		if (stream->mux_thread_joinable) {
-			pthread_join(stream->mux_thread, NULL);
-			stream->mux_thread_joinable = false;
-		}
+		join_mux_thread(stream);
 
 		stream->save_ts = 0;
 		replay_buffer_save(stream);
@@ -809,6 +1283,8 @@ static void replay_buffer_defaults(obs_data_t *s)
 	obs_data_set_default_string(s, "format", "%CCYY-%MM-%DD %hh-%mm-%ss");
 	obs_data_set_default_string(s, "extension", "mp4");
 	obs_data_set_default_bool(s, "allow_spaces", true);
+	obs_data_set_default_bool(s, "use_disk_buffer", false);
+	obs_data_set_default_string(s, "disk_buffer_dir", "");
 }
 
 struct obs_output_info replay_buffer = {
@@ -215,6 +215,25 @@ static void get_frame(void *opaque, struct obs_source_frame *f)
 	obs_source_output_video(s->source, f);
 }
 
+static struct obs_source_frame *acquire_frame(void *opaque,
+		enum video_format format, uint32_t width, uint32_t height)
+{
+	struct ffmpeg_source *s = opaque;
+	return obs_source_acquire_video(s->source, format, width, height);
+}
+
+static void commit_frame(void *opaque, struct obs_source_frame *f)
+{
+	struct ffmpeg_source *s = opaque;
+	obs_source_commit_video(s->source, f);
+}
+
+static void discard_frame(void *opaque, struct obs_source_frame *f)
+{
+	struct ffmpeg_source *s = opaque;
+	obs_source_discard_video(s->source, f);
+}
+
 static void preload_frame(void *opaque, struct obs_source_frame *f)
 {
 	struct ffmpeg_source *s = opaque;
@@ -240,12 +259,18 @@ static void media_stopped(void *opaque)
 
 static void ffmpeg_source_open(struct ffmpeg_source *s)
 {
-	if (s->input && *s->input)
-		s->media_valid = mp_media_init(&s->media,
-				s->input, s->input_format,
-				s->buffering_mb * 1024 * 1024,
-				s, get_frame, get_audio, media_stopped,
-				preload_frame, s->is_hw_decoding, s->range);
+	if (!s->input || !*s->input)
+		return;
+
+	s->media_valid = mp_media_init(&s->media,
+			s->input, s->input_format,
+			s->buffering_mb * 1024 * 1024,
+			s, get_frame, get_audio, media_stopped,
+			preload_frame, s->is_hw_decoding, s->range);
+
+	if (s->media_valid)
+		mp_media_set_direct_video(&s->media, acquire_frame,
+				commit_frame, discard_frame);
 }
 
 static void ffmpeg_source_tick(void *data, float seconds)
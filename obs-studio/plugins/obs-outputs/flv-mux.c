@@ -16,6 +16,7 @@
 ******************************************************************************/
 
 #include <obs.h>
+#include <obs-avc.h>
 #include <stdio.h>
 #include <util/dstr.h>
 #include <util/array-serializer.h>
@@ -177,10 +178,105 @@ bool flv_meta_data(obs_output_t *context, uint8_t **output, size_t *size,
 static int32_t last_time = 0;
 #endif
 
+size_t flv_packet_data_header(struct encoder_packet *packet, bool is_header,
+		uint8_t *header)
+{
+	if (packet->type == OBS_ENCODER_VIDEO) {
+		int64_t offset = packet->pts - packet->dts;
+		int32_t cts_ms = get_ms_time(packet, offset);
+
+		header[0] = packet->keyframe ? 0x17 : 0x27;
+		header[1] = is_header ? 0 : 1;
+		header[2] = (uint8_t)(cts_ms >> 16);
+		header[3] = (uint8_t)(cts_ms >> 8);
+		header[4] = (uint8_t)cts_ms;
+		return 5;
+	}
+
+	header[0] = 0xaf;
+	header[1] = is_header ? 0 : 1;
+	return 2;
+}
+
+static inline void push_piece(struct flv_body *body, const uint8_t *data,
+		size_t size)
+{
+	AVal *piece = da_push_back_new(body->pieces);
+	piece->av_val = (char*)data;
+	piece->av_len = (int)size;
+	body->size += size;
+}
+
+static void push_avc_nals(struct flv_body *body, const uint8_t *data,
+		size_t size)
+{
+	const uint8_t *nal_start, *nal_end;
+	const uint8_t *end = data + size;
+	uint8_t *prefix;
+
+	nal_start = obs_avc_find_startcode(data, end);
+	while (true) {
+		while (nal_start < end && !*(nal_start++));
+
+		if (nal_start == end)
+			break;
+
+		nal_end = obs_avc_find_startcode(nal_start, end);
+
+		size = nal_end - nal_start;
+		da_resize(body->prefixes, body->prefixes.num + 4);
+		prefix = body->prefixes.array + body->prefixes.num - 4;
+		prefix[0] = (uint8_t)(size >> 24);
+		prefix[1] = (uint8_t)(size >> 16);
+		prefix[2] = (uint8_t)(size >> 8);
+		prefix[3] = (uint8_t)size;
+
+		/* the prefix buffer can still move, so it is pointed at
+		 * once all NAL units are known */
+		push_piece(body, NULL, 4);
+		push_piece(body, nal_start, size);
+		nal_start = nal_end;
+	}
+
+	prefix = body->prefixes.array;
+	for (size_t i = 1; i < body->pieces.num; i++) {
+		AVal *piece = body->pieces.array + i;
+		if (!piece->av_val) {
+			piece->av_val = (char*)prefix;
+			prefix += 4;
+		}
+	}
+}
+
+void flv_body_build(struct flv_body *body, struct encoder_packet *packet,
+		bool is_header)
+{
+	da_resize(body->prefixes, 0);
+	da_resize(body->pieces, 0);
+	body->size = 0;
+
+	push_piece(body, body->header,
+			flv_packet_data_header(packet, is_header,
+				body->header));
+
+	/* codec headers are already in AVCC form */
+	if (packet->type == OBS_ENCODER_VIDEO && !is_header)
+		push_avc_nals(body, packet->data, packet->size);
+	else
+		push_piece(body, packet->data, packet->size);
+}
+
+void flv_body_free(struct flv_body *body)
+{
+	da_free(body->prefixes);
+	da_free(body->pieces);
+}
+
 static void flv_video(struct serializer *s, struct encoder_packet *packet,
 		bool is_header)
 {
-	int64_t offset  = packet->pts - packet->dts;
+	uint8_t header[FLV_MAX_DATA_HEADER_SIZE];
+	size_t  header_size;
 	int32_t time_ms = get_ms_time(packet, packet->dts);
 
 	if (!packet->data || !packet->size)
@@ -197,15 +293,14 @@ static void flv_video(struct serializer *s, struct encoder_packet *packet,
 	last_time = time_ms;
 #endif
 
-	s_wb24(s, (uint32_t)packet->size + 5);
+	header_size = flv_packet_data_header(packet, is_header, header);
+
+	s_wb24(s, (uint32_t)(packet->size + header_size));
 	s_wb24(s, time_ms);
 	s_w8(s, (time_ms >> 24) & 0x7F);
 	s_wb24(s, 0);
 
-	/* these are the 5 extra bytes mentioned above */
-	s_w8(s, packet->keyframe ? 0x17 : 0x27);
-	s_w8(s, is_header ? 0 : 1);
-	s_wb24(s, get_ms_time(packet, offset));
+	s_write(s, header, header_size);
 	s_write(s, packet->data, packet->size);
 
 	/* write tag size (starting byte doesn't count) */
@@ -215,6 +310,8 @@ static void flv_video(struct serializer *s, struct encoder_packet *packet,
 static void flv_audio(struct serializer *s, struct encoder_packet *packet,
 		bool is_header)
 {
+	uint8_t header[FLV_MAX_DATA_HEADER_SIZE];
+	size_t  header_size;
 	int32_t time_ms = get_ms_time(packet, packet->dts);
 
 	if (!packet->data || !packet->size)
@@ -231,14 +328,14 @@ static void flv_audio(struct serializer *s, struct encoder_packet *packet,
 	last_time = time_ms;
 #endif
 
-	s_wb24(s, (uint32_t)packet->size + 2);
+	header_size = flv_packet_data_header(packet, is_header, header);
+
+	s_wb24(s, (uint32_t)(packet->size + header_size));
 	s_wb24(s, time_ms);
 	s_w8(s, (time_ms >> 24) & 0x7F);
 	s_wb24(s, 0);
 
-	/* these are the two extra bytes mentioned above */
-	s_w8(s, 0xaf);
-	s_w8(s, is_header ? 0 : 1);
+	s_write(s, header, header_size);
 	s_write(s, packet->data, packet->size);
 
 	/* write tag size (starting byte doesn't count) */
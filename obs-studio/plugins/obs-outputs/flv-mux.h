@@ -18,6 +18,8 @@
 #pragma once
 
 #include <obs.h>
+#include <util/darray.h>
+#include "librtmp/amf.h"
 
 #define MILLISECOND_DEN   1000
 
@@ -32,3 +34,25 @@ extern bool flv_meta_data(obs_output_t *context, uint8_t **output, size_t *size,
 		bool write_header, size_t audio_idx);
 extern void flv_packet_mux(struct encoder_packet *packet,
 		uint8_t **output, size_t *size, bool is_header);
+
+#define FLV_TAG_HEADER_SIZE        11
+#define FLV_MAX_DATA_HEADER_SIZE   5
+
+/* writes the video/audio data header that precedes the packet payload in the
+ * FLV tag body, returns its size */
+extern size_t flv_packet_data_header(struct encoder_packet *packet,
+		bool is_header, uint8_t *header);
+
+/* FLV tag body of a packet as a list of pieces that point into the packet
+ * itself.  Annex B video is turned into AVCC by giving every NAL unit its
+ * own 4 byte length prefix piece instead of copying the payload. */
+struct flv_body {
+	uint8_t         header[FLV_MAX_DATA_HEADER_SIZE];
+	DARRAY(uint8_t) prefixes;
+	DARRAY(AVal)    pieces;
+	size_t          size;
+};
+
+extern void flv_body_build(struct flv_body *body,
+		struct encoder_packet *packet, bool is_header);
+extern void flv_body_free(struct flv_body *body);
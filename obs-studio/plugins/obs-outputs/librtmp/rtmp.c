@@ -3962,18 +3962,19 @@ RTMP_SendChunk(RTMP *r, RTMPChunk *chunk)
     return wrote;
 }
 
-int
-RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+/* grows the outgoing channel table, picks the most compact header type for
+ * the packet and encodes its chunk header so that it ends at hend.  returns
+ * the size of the header, or 0 on failure */
+static int
+EncodeChunkHeader(RTMP *r, RTMPPacket *packet, char *hend, char **pheader,
+                  int *pcSize, char *pc)
 {
     const RTMPPacket *prevPacket;
     uint32_t last = 0;
     int nSize;
     int hSize, cSize;
-    char *header, *hptr, *hend, hbuf[RTMP_MAX_HEADER_SIZE], c;
+    char *header, *hptr, c;
     uint32_t t;
-    char *buffer, *tbuf = NULL, *toff = NULL;
-    int nChunkSize;
-    int tlen;
 
     if (packet->m_nChannel >= r->m_channelsAllocatedOut)
     {
@@ -3984,7 +3985,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
             free(r->m_vecChannelsOut);
             r->m_vecChannelsOut = NULL;
             r->m_channelsAllocatedOut = 0;
-            return FALSE;
+            return 0;
         }
         r->m_vecChannelsOut = packets;
         memset(r->m_vecChannelsOut + r->m_channelsAllocatedOut, 0, sizeof(RTMPPacket*) * (n - r->m_channelsAllocatedOut));
@@ -4010,7 +4011,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     {
         RTMP_Log(RTMP_LOGERROR, "sanity failed!! trying to send header of type: 0x%02x.",
                  (unsigned char)packet->m_headerType);
-        return FALSE;
+        return 0;
     }
 
     nSize = packetSize[packet->m_headerType];
@@ -4018,16 +4019,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     cSize = 0;
     t = packet->m_nTimeStamp - last;
 
-    if (packet->m_body)
-    {
-        header = packet->m_body - nSize;
-        hend = packet->m_body;
-    }
-    else
-    {
-        header = hbuf + 6;
-        hend = hbuf + sizeof(hbuf);
-    }
+    header = hend - nSize;
 
     if (packet->m_nChannel > 319)
         cSize = 2;
@@ -4084,6 +4076,27 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     if (nSize > 1 && t >= 0xffffff)
         hptr = AMF_EncodeInt32(hptr, hend, t);
 
+    *pheader = header;
+    *pcSize = cSize;
+    *pc = c;
+    return hSize;
+}
+
+int
+RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+{
+    int nSize;
+    int hSize, cSize;
+    char *header, *hend, hbuf[RTMP_MAX_HEADER_SIZE], c;
+    char *buffer, *tbuf = NULL, *toff = NULL;
+    int nChunkSize;
+    int tlen;
+
+    hend = packet->m_body ? packet->m_body : hbuf + sizeof(hbuf);
+    hSize = EncodeChunkHeader(r, packet, hend, &header, &cSize, &c);
+    if (!hSize)
+        return FALSE;
+
     nSize = packet->m_nBodySize;
     buffer = packet->m_body;
     nChunkSize = r->m_outChunkSize;
@@ -4179,6 +4192,258 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     return TRUE;
 }
 
+/* gather list for RTMP_SendPacketV: chunk headers are encoded into hdr and
+ * everything else points straight at the caller's body buffers */
+#define RTMP_IOV_MAX 256
+
+typedef struct RTMPIovec
+{
+#ifdef _WIN32
+    WSABUF iov[RTMP_IOV_MAX];
+#else
+    struct iovec iov[RTMP_IOV_MAX];
+#endif
+    char hdr[RTMP_IOV_MAX / 2 * RTMP_MAX_HEADER_SIZE];
+    int num;
+    int hdrUsed;
+    int total;
+} RTMPIovec;
+
+static inline void
+IovAdd(RTMPIovec *v, const char *data, int len)
+{
+#ifdef _WIN32
+    v->iov[v->num].buf = (char *)data;
+    v->iov[v->num].len = (ULONG)len;
+#else
+    v->iov[v->num].iov_base = (void *)data;
+    v->iov[v->num].iov_len = (size_t)len;
+#endif
+    v->num++;
+    v->total += len;
+}
+
+static inline const char *
+IovData(const RTMPIovec *v, int i, int *len)
+{
+#ifdef _WIN32
+    *len = (int)v->iov[i].len;
+    return v->iov[i].buf;
+#else
+    *len = (int)v->iov[i].iov_len;
+    return v->iov[i].iov_base;
+#endif
+}
+
+/* drops the first n sent bytes from the list */
+static void
+IovConsume(RTMPIovec *v, int *first, int n)
+{
+    while (n > 0)
+    {
+        int len;
+        const char *data = IovData(v, *first, &len);
+
+        if (n < len)
+        {
+#ifdef _WIN32
+            v->iov[*first].buf = (char *)data + n;
+            v->iov[*first].len = (ULONG)(len - n);
+#else
+            v->iov[*first].iov_base = (char *)data + n;
+            v->iov[*first].iov_len = (size_t)(len - n);
+#endif
+            break;
+        }
+
+        n -= len;
+        (*first)++;
+    }
+}
+
+static int
+IovSend(RTMP *r, RTMPIovec *v)
+{
+    int first = 0;
+    int ret = TRUE;
+
+    if (!v->num)
+        return TRUE;
+
+    if ((r->Link.protocol & RTMP_FEATURE_HTTP) || r->m_sb.sb_ssl)
+    {
+        /* one request/record per gather list rather than one per entry */
+        char *buf = malloc(v->total);
+        char *ptr = buf;
+
+        if (!buf)
+            return FALSE;
+
+        for (int i = 0; i < v->num; i++)
+        {
+            int len;
+            const char *data = IovData(v, i, &len);
+            memcpy(ptr, data, len);
+            ptr += len;
+        }
+
+        ret = WriteN(r, buf, v->total);
+        free(buf);
+    }
+#ifdef CRYPTO
+    else if (r->m_bCustomSend || r->Link.rc4keyOut)
+#else
+    else if (r->m_bCustomSend)
+#endif
+    {
+        for (int i = 0; i < v->num && ret; i++)
+        {
+            int len;
+            const char *data = IovData(v, i, &len);
+            ret = WriteN(r, data, len);
+        }
+    }
+    else
+    {
+        while (first < v->num)
+        {
+            int nBytes;
+#ifdef _WIN32
+            DWORD sent = 0;
+            nBytes = WSASend(r->m_sb.sb_socket, v->iov + first,
+                             (DWORD)(v->num - first), &sent, 0, NULL, NULL);
+            if (nBytes == 0)
+                nBytes = (int)sent;
+#else
+            struct msghdr msg;
+
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = v->iov + first;
+            msg.msg_iovlen = v->num - first;
+            nBytes = (int)sendmsg(r->m_sb.sb_socket, &msg, 0);
+#endif
+
+            if (nBytes < 0)
+            {
+                int sockerr = GetSockError();
+                RTMP_Log(RTMP_LOGERROR, "%s, RTMP send error %d (%d bytes)",
+                         __FUNCTION__, sockerr, v->total);
+
+                if (sockerr == EINTR && !RTMP_ctrlC)
+                    continue;
+
+                r->last_error_code = sockerr;
+
+                RTMP_Close(r);
+                ret = FALSE;
+                break;
+            }
+
+            if (nBytes == 0)
+            {
+                ret = FALSE;
+                break;
+            }
+
+            IovConsume(v, &first, nBytes);
+        }
+    }
+
+    v->num = 0;
+    v->hdrUsed = 0;
+    v->total = 0;
+    return ret;
+}
+
+/* sends a packet whose body is the concatenation of nBody buffers without
+ * copying them: the chunk headers and the body pieces of every chunk are
+ * handed to the socket as one gather list.  packet->m_body is ignored */
+int
+RTMP_SendPacketV(RTMP *r, RTMPPacket *packet, const AVal *body, int nBody)
+{
+    RTMPIovec v;
+    int hSize, cSize;
+    char *header, c;
+    int nSize = 0;
+    int chunkLeft;
+    int i, off = 0;
+
+    for (i = 0; i < nBody; i++)
+        nSize += body[i].av_len;
+
+    packet->m_body = NULL;
+    packet->m_nBodySize = nSize;
+
+    v.num = 0;
+    v.hdrUsed = RTMP_MAX_HEADER_SIZE;
+    v.total = 0;
+
+    hSize = EncodeChunkHeader(r, packet, v.hdr + RTMP_MAX_HEADER_SIZE,
+                              &header, &cSize, &c);
+    if (!hSize)
+        return FALSE;
+
+    IovAdd(&v, header, hSize);
+    chunkLeft = r->m_outChunkSize;
+    i = 0;
+
+    while (nSize > 0)
+    {
+        int len = body[i].av_len - off;
+
+        if (len > chunkLeft)
+            len = chunkLeft;
+
+        /* keep room for this piece and the next chunk header */
+        if (v.num + 2 > RTMP_IOV_MAX ||
+                v.hdrUsed + 3 > (int)sizeof(v.hdr))
+        {
+            if (!IovSend(r, &v))
+                return FALSE;
+        }
+
+        if (len)
+            IovAdd(&v, body[i].av_val + off, len);
+
+        off += len;
+        nSize -= len;
+        chunkLeft -= len;
+
+        if (off == body[i].av_len)
+        {
+            i++;
+            off = 0;
+        }
+
+        if (!chunkLeft && nSize > 0)
+        {
+            header = v.hdr + v.hdrUsed;
+            hSize = 1;
+            header[0] = (0xc0 | c);
+            if (cSize)
+            {
+                int tmp = packet->m_nChannel - 64;
+                header[1] = tmp & 0xff;
+                if (cSize == 2)
+                    header[2] = tmp >> 8;
+                hSize += cSize;
+            }
+
+            v.hdrUsed += hSize;
+            IovAdd(&v, header, hSize);
+            chunkLeft = r->m_outChunkSize;
+        }
+    }
+
+    if (!IovSend(r, &v))
+        return FALSE;
+
+    if (!r->m_vecChannelsOut[packet->m_nChannel])
+        r->m_vecChannelsOut[packet->m_nChannel] = malloc(sizeof(RTMPPacket));
+    memcpy(r->m_vecChannelsOut[packet->m_nChannel], packet, sizeof(RTMPPacket));
+    return TRUE;
+}
+
 int
 RTMP_Serve(RTMP *r)
 {
@@ -0,0 +1,335 @@
+#ifdef __linux__
+#include "rtmp-stream.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <linux/sockios.h>
+#include <netinet/tcp.h>
+
+#ifndef TCP_NOTSENT_LOWAT
+#define TCP_NOTSENT_LOWAT 25
+#endif
+
+/* the kernel only reports the socket as writable once less than this much
+ * data is left unsent, so anything beyond it stays in write_buf where the
+ * congestion estimate can see it */
+#define MIN_NOTSENT_LOWAT 16384
+
+static void fatal_sock_shutdown(struct rtmp_stream *stream)
+{
+	close(stream->rtmp.m_sb.sb_socket);
+	stream->rtmp.m_sb.sb_socket = -1;
+	stream->write_buf_len = 0;
+	os_atomic_set_long(&stream->socket_unsent_bytes, 0);
+	os_event_signal(stream->buffer_space_available_event);
+}
+
+static inline void update_unsent_bytes(struct rtmp_stream *stream)
+{
+	int unsent = 0;
+
+	if (ioctl(stream->rtmp.m_sb.sb_socket, SIOCOUTQNSD, &unsent) == 0)
+		os_atomic_set_long(&stream->socket_unsent_bytes, unsent);
+}
+
+static bool socket_event(struct rtmp_stream *stream, uint32_t events,
+		bool *can_write, uint64_t last_send_time)
+{
+	if (events & (EPOLLERR | EPOLLHUP)) {
+		int err_code = 0;
+		socklen_t size = sizeof(err_code);
+
+		getsockopt(stream->rtmp.m_sb.sb_socket, SOL_SOCKET, SO_ERROR,
+				&err_code, &size);
+
+		if (last_send_time) {
+			uint32_t diff =
+				(os_gettime_ns() / 1000000) - last_send_time;
+
+			blog(LOG_ERROR, "socket_thread_linux: Socket closed, "
+					"%u ms since last send "
+					"(buffer: %d / %d)",
+					diff,
+					(int)stream->write_buf_len,
+					(int)stream->write_buf_size);
+		}
+
+		blog(LOG_ERROR, "socket_thread_linux: Aborting due to "
+				"socket error %d", err_code);
+
+		stream->rtmp.last_error_code = err_code;
+		fatal_sock_shutdown(stream);
+		return false;
+	}
+
+	if (events & EPOLLOUT)
+		*can_write = true;
+
+	if (events & (EPOLLIN | EPOLLRDHUP)) {
+		char discard[16384];
+
+		for (;;) {
+			ssize_t ret = recv(stream->rtmp.m_sb.sb_socket,
+					discard, sizeof(discard), 0);
+			int err_code;
+
+			if (ret > 0)
+				continue;
+
+			err_code = ret == 0 ? 0 : errno;
+			if (ret == -1 && err_code == EINTR)
+				continue;
+			if (ret == -1 && (err_code == EAGAIN ||
+			                  err_code == EWOULDBLOCK))
+				break;
+
+			blog(LOG_ERROR, "socket_thread_linux: "
+					"Socket error, recv() returned "
+					"%d, errno %d",
+					(int)ret, err_code);
+			stream->rtmp.last_error_code = err_code;
+			fatal_sock_shutdown(stream);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+enum data_ret {
+	RET_BREAK,
+	RET_FATAL,
+	RET_CONTINUE
+};
+
+static enum data_ret write_data(struct rtmp_stream *stream, bool *can_write,
+		uint64_t *last_send_time, size_t latency_packet_size,
+		int delay_time)
+{
+	bool exit_loop = false;
+	size_t send_len;
+	ssize_t ret;
+
+	pthread_mutex_lock(&stream->write_buf_mutex);
+
+	if (!stream->write_buf_len) {
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+		return RET_BREAK;
+	}
+
+	send_len = stream->write_buf_len;
+	if (stream->low_latency_mode && send_len > latency_packet_size)
+		send_len = latency_packet_size;
+
+	ret = send(stream->rtmp.m_sb.sb_socket, stream->write_buf, send_len,
+			MSG_NOSIGNAL);
+
+	if (ret > 0) {
+		if (stream->write_buf_len - ret)
+			memmove(stream->write_buf,
+					stream->write_buf + ret,
+					stream->write_buf_len - ret);
+		stream->write_buf_len -= ret;
+
+		*last_send_time = os_gettime_ns() / 1000000;
+
+		os_event_signal(stream->buffer_space_available_event);
+	} else {
+		int err_code = ret == 0 ? 0 : errno;
+
+		if (ret == -1 && err_code == EINTR) {
+			pthread_mutex_unlock(&stream->write_buf_mutex);
+			return RET_CONTINUE;
+		}
+
+		if (ret == -1 && (err_code == EAGAIN ||
+		                  err_code == EWOULDBLOCK)) {
+			*can_write = false;
+			pthread_mutex_unlock(&stream->write_buf_mutex);
+			return RET_BREAK;
+		}
+
+		blog(LOG_ERROR, "socket_thread_linux: "
+				"Socket error, send() returned %d, "
+				"errno %d",
+				(int)ret, err_code);
+
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+		stream->rtmp.last_error_code = err_code;
+		fatal_sock_shutdown(stream);
+		return RET_FATAL;
+	}
+
+	/* finish writing for now */
+	if (stream->write_buf_len <= 1000)
+		exit_loop = true;
+
+	pthread_mutex_unlock(&stream->write_buf_mutex);
+
+	if (delay_time)
+		os_sleep_ms(delay_time);
+
+	return exit_loop ? RET_BREAK : RET_CONTINUE;
+}
+
+static inline void clear_wake(struct rtmp_stream *stream)
+{
+	uint64_t val;
+	while (read(stream->socket_wake_fd, &val, sizeof(val)) > 0);
+}
+
+#define LATENCY_FACTOR 20
+
+static inline void socket_thread_linux_internal(struct rtmp_stream *stream,
+		int epoll_fd)
+{
+	int sock = stream->rtmp.m_sb.sb_socket;
+	bool can_write = true;
+
+	int delay_time;
+	size_t latency_packet_size;
+	uint64_t last_send_time = 0;
+
+	struct epoll_event ev = {0};
+	int lowat;
+
+	lowat = (int)(stream->write_buf_size / 8);
+	if (lowat < MIN_NOTSENT_LOWAT)
+		lowat = MIN_NOTSENT_LOWAT;
+
+	if (setsockopt(sock, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat,
+				sizeof(lowat)) != 0)
+		blog(LOG_WARNING, "socket_thread_linux: Failed to set "
+				"TCP_NOTSENT_LOWAT, errno %d", errno);
+
+	if (stream->low_latency_mode) {
+		delay_time = 1000 / LATENCY_FACTOR;
+		latency_packet_size = stream->write_buf_size / (LATENCY_FACTOR - 2);
+	} else {
+		latency_packet_size = stream->write_buf_size;
+		delay_time = 0;
+	}
+
+	/* edge triggered, EPOLLOUT behaves like FD_WRITE on windows: it is
+	 * only reported again once a send has hit EAGAIN */
+	ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	ev.data.fd = sock;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock, &ev) != 0) {
+		blog(LOG_ERROR, "socket_thread_linux: Aborting due to "
+				"epoll_ctl failure, errno %d", errno);
+		fatal_sock_shutdown(stream);
+		return;
+	}
+
+	ev.events = EPOLLIN;
+	ev.data.fd = stream->socket_wake_fd;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stream->socket_wake_fd, &ev);
+
+	for (;;) {
+		struct epoll_event events[2];
+		int num;
+
+		if (os_event_try(stream->send_thread_signaled_exit) != EAGAIN) {
+			pthread_mutex_lock(&stream->write_buf_mutex);
+			if (stream->write_buf_len == 0) {
+				pthread_mutex_unlock(&stream->write_buf_mutex);
+				os_event_reset(stream->send_thread_signaled_exit);
+				break;
+			}
+
+			pthread_mutex_unlock(&stream->write_buf_mutex);
+		}
+
+		num = epoll_wait(epoll_fd, events, 2, -1);
+		if (num == -1) {
+			if (errno == EINTR)
+				continue;
+
+			blog(LOG_ERROR, "socket_thread_linux: Aborting due "
+					"to epoll_wait failure, errno %d",
+					errno);
+			fatal_sock_shutdown(stream);
+			return;
+		}
+
+		for (int i = 0; i < num; i++) {
+			if (events[i].data.fd == stream->socket_wake_fd) {
+				clear_wake(stream);
+
+			} else if (!socket_event(stream, events[i].events,
+						&can_write, last_send_time)) {
+				return;
+			}
+		}
+
+		if (can_write) {
+			for (;;) {
+				enum data_ret ret = write_data(
+						stream,
+						&can_write,
+						&last_send_time,
+						latency_packet_size,
+						delay_time);
+
+				switch (ret) {
+				case RET_BREAK:
+					goto exit_write_loop;
+				case RET_FATAL:
+					return;
+				case RET_CONTINUE:;
+				}
+			}
+		}
+		exit_write_loop:
+
+		update_unsent_bytes(stream);
+	}
+
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, sock, NULL);
+	os_atomic_set_long(&stream->socket_unsent_bytes, 0);
+
+	blog(LOG_INFO, "socket_thread_linux: Normal exit");
+}
+
+void socket_thread_linux_wake(struct rtmp_stream *stream)
+{
+	uint64_t val = 1;
+	ssize_t ret = write(stream->socket_wake_fd, &val, sizeof(val));
+	UNUSED_PARAMETER(ret);
+}
+
+bool socket_thread_linux_init(struct rtmp_stream *stream)
+{
+	if (stream->socket_wake_fd == -1)
+		stream->socket_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	return stream->socket_wake_fd != -1;
+}
+
+void socket_thread_linux_free(struct rtmp_stream *stream)
+{
+	if (stream->socket_wake_fd != -1) {
+		close(stream->socket_wake_fd);
+		stream->socket_wake_fd = -1;
+	}
+}
+
+void *socket_thread_linux(void *data)
+{
+	struct rtmp_stream *stream = data;
+	int epoll_fd;
+
+	os_set_thread_name("rtmp-stream: socket_thread");
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd == -1) {
+		blog(LOG_ERROR, "socket_thread_linux: Aborting due to "
+				"epoll_create1 failure, errno %d", errno);
+		fatal_sock_shutdown(stream);
+		return NULL;
+	}
+
+	socket_thread_linux_internal(stream, epoll_fd);
+	close(epoll_fd);
+	return NULL;
+}
+#endif
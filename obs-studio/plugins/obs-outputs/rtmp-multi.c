@@ -0,0 +1,1229 @@
+/******************************************************************************
+    Copyright (C) 2014 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ * Fan-out RTMP output: one encode streamed to several ingest servers.
+ *
+ * Every packet is turned into an FLV tag body once and shared by reference
+ * between all destinations.  A single loop thread drives all of the
+ * (non-blocking) sockets; each destination only owns its queue of shared
+ * messages, its chunk header and its drop/reconnect state, so a slow or
+ * failing ingest never holds back the others.  Connecting (which is
+ * blocking in librtmp) happens on a short lived thread per destination.
+ */
+
+#include <obs-module.h>
+#include <obs-avc.h>
+#include <util/platform.h>
+#include <util/circlebuf.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/threading.h>
+#include "librtmp/rtmp.h"
+#include "flv-mux.h"
+#include "net-if.h"
+
+#ifdef _WIN32
+#define poll WSAPoll
+#else
+#include <sys/ioctl.h>
+#include <poll.h>
+#endif
+
+#define do_log(level, format, ...) \
+	blog(level, "[rtmp multi: '%s'] " format, \
+			obs_output_get_name(multi->output), ##__VA_ARGS__)
+
+#define warn(format, ...)  do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...)  do_log(LOG_INFO,    format, ##__VA_ARGS__)
+
+#define dest_log(level, format, ...) \
+	do_log(level, "[%d] " format, (int)dest->index, ##__VA_ARGS__)
+
+#define OPT_DESTINATIONS          "destinations"
+#define OPT_DROP_THRESHOLD        "drop_threshold_ms"
+#define OPT_PFRAME_DROP_THRESHOLD "pframe_drop_threshold_ms"
+#define OPT_MAX_SHUTDOWN_TIME_SEC "max_shutdown_time_sec"
+#define OPT_MAX_RETRIES           "max_retries"
+#define OPT_RETRY_DELAY_SEC       "retry_delay_sec"
+#define OPT_BIND_IP               "bind_ip"
+
+#define MAX_DESTINATIONS  16
+#define MAX_SEND_SEGS     64
+#define MEDIA_CHANNEL     0x04
+#define POLL_INTERVAL_MS  5
+#define IDLE_INTERVAL_MS  50
+
+/* ------------------------------------------------------------------------ */
+
+/* FLV tag body of one packet, shared by every destination */
+struct mux_msg {
+	volatile long         refs;
+	struct encoder_packet packet;
+	struct flv_body       body;
+	uint8_t               rtmp_type;
+	uint32_t              timestamp;
+};
+
+static inline void msg_addref(struct mux_msg *msg)
+{
+	os_atomic_inc_long(&msg->refs);
+}
+
+static inline void msg_release(struct mux_msg *msg)
+{
+	if (msg && os_atomic_dec_long(&msg->refs) == 0) {
+		obs_encoder_packet_release(&msg->packet);
+		flv_body_free(&msg->body);
+		bfree(msg);
+	}
+}
+
+struct send_seg {
+	const uint8_t *data;
+	size_t        size;
+};
+
+enum dest_state {
+	DEST_IDLE,
+	DEST_CONNECTING,
+	DEST_ACTIVE,
+	DEST_FAILED
+};
+
+struct rtmp_multi;
+
+struct rtmp_dest {
+	struct rtmp_multi *multi;
+	size_t            index;
+
+	struct dstr       url, key;
+	struct dstr       username, password;
+	struct dstr       encoder_name;
+	RTMP              rtmp;
+
+	/* owned by the loop thread, except while connecting */
+	enum dest_state   state;
+	pthread_t         connect_thread;
+	volatile bool     connecting;
+	volatile long     connect_result;
+	int               retries;
+	uint64_t          retry_ts;
+
+	struct circlebuf  queue;
+	bool              wait_keyframe;
+	int               min_priority;
+	int64_t           last_dts_usec;
+	float             congestion;
+
+	/* message currently being written */
+	struct mux_msg    *cur;
+	DARRAY(struct send_seg) segs;
+	size_t            seg_idx;
+	uint8_t           chunk_header[16];
+
+	uint64_t          total_bytes;
+	int               dropped_frames;
+	int               reconnects;
+};
+
+struct rtmp_multi {
+	obs_output_t      *output;
+
+	struct rtmp_dest  *dests[MAX_DESTINATIONS];
+	size_t            num_dests;
+
+	pthread_mutex_t   intake_mutex;
+	struct circlebuf  intake;
+	os_event_t        *data_event;
+	os_event_t        *stop_event;
+
+	pthread_t         loop_thread;
+	bool              loop_thread_joinable;
+	volatile bool     active;
+	uint64_t          stop_ts;
+	uint64_t          shutdown_timeout_ts;
+
+	int64_t           drop_threshold_usec;
+	int64_t           pframe_drop_threshold_usec;
+	int               max_shutdown_time_sec;
+	int               max_retries;
+	int               retry_delay_sec;
+	struct dstr       bind_ip;
+};
+
+static const char *multi_signals[] = {
+	"void destination_connected(ptr output, int index)",
+	"void destination_disconnected(ptr output, int index)",
+	NULL
+};
+
+static inline bool stopping(struct rtmp_multi *multi)
+{
+	return os_event_try(multi->stop_event) != EAGAIN;
+}
+
+static void dest_signal(struct rtmp_dest *dest, const char *signal)
+{
+	struct rtmp_multi *multi = dest->multi;
+	struct calldata params;
+	uint8_t stack[128];
+
+	calldata_init_fixed(&params, stack, sizeof(stack));
+	calldata_set_ptr(&params, "output", multi->output);
+	calldata_set_int(&params, "index", (long long)dest->index);
+	signal_handler_signal(obs_output_get_signal_handler(multi->output),
+			signal, &params);
+}
+
+/* ------------------------------------------------------------------------ */
+/* connecting (runs on the destination's connect thread) */
+
+static inline void set_rtmp_dstr(AVal *val, struct dstr *str)
+{
+	bool valid  = !dstr_is_empty(str);
+	val->av_val = valid ? str->array    : NULL;
+	val->av_len = valid ? (int)str->len : 0;
+}
+
+static bool send_tag(struct rtmp_dest *dest, struct encoder_packet *packet,
+		bool is_header)
+{
+	struct flv_body body = {0};
+	RTMPPacket pkt = {0};
+	bool success;
+
+	flv_body_build(&body, packet, is_header);
+
+	pkt.m_packetType = packet->type == OBS_ENCODER_VIDEO ?
+		RTMP_PACKET_TYPE_VIDEO : RTMP_PACKET_TYPE_AUDIO;
+	pkt.m_headerType = RTMP_PACKET_SIZE_LARGE;
+	pkt.m_nChannel = MEDIA_CHANNEL;
+	pkt.m_nInfoField2 = dest->rtmp.Link.streams[0].id;
+
+	success = !!RTMP_SendPacketV(&dest->rtmp, &pkt, body.pieces.array,
+			(int)body.pieces.num);
+	flv_body_free(&body);
+	return success;
+}
+
+static bool send_headers(struct rtmp_dest *dest)
+{
+	obs_output_t  *context  = dest->multi->output;
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(context);
+	obs_encoder_t *aencoder = obs_output_get_audio_encoder(context, 0);
+	uint8_t       *meta_data;
+	size_t        meta_data_size;
+	uint8_t       *header;
+	size_t        size;
+	bool          success;
+
+	if (!flv_meta_data(context, &meta_data, &meta_data_size, false, 0))
+		return false;
+
+	success = RTMP_Write(&dest->rtmp, (char*)meta_data,
+			(int)meta_data_size, 0) >= 0;
+	bfree(meta_data);
+
+	if (success && aencoder) {
+		struct encoder_packet packet = {
+			.type         = OBS_ENCODER_AUDIO,
+			.timebase_den = 1
+		};
+
+		obs_encoder_get_extra_data(aencoder, &header, &packet.size);
+		packet.data = header;
+		success = send_tag(dest, &packet, true);
+	}
+
+	if (success && vencoder) {
+		struct encoder_packet packet = {
+			.type         = OBS_ENCODER_VIDEO,
+			.timebase_den = 1,
+			.keyframe     = true
+		};
+
+		obs_encoder_get_extra_data(vencoder, &header, &size);
+		packet.size = obs_parse_avc_header(&packet.data, header, size);
+		success = send_tag(dest, &packet, true);
+		bfree(packet.data);
+	}
+
+	return success;
+}
+
+static inline bool set_blocking(struct rtmp_dest *dest, bool blocking)
+{
+#ifdef _WIN32
+	u_long val = blocking ? 0 : 1;
+	return ioctlsocket(dest->rtmp.m_sb.sb_socket, FIONBIO, &val) == 0;
+#else
+	int val = blocking ? 0 : 1;
+	return ioctl(dest->rtmp.m_sb.sb_socket, FIONBIO, &val) == 0;
+#endif
+}
+
+static int dest_try_connect(struct rtmp_dest *dest)
+{
+	struct rtmp_multi *multi = dest->multi;
+	RTMP *rtmp = &dest->rtmp;
+
+	dest_log(LOG_INFO, "Connecting to RTMP URL %s...", dest->url.array);
+
+	RTMP_Init(rtmp);
+	if (!RTMP_SetupURL(rtmp, dest->url.array))
+		return OBS_OUTPUT_BAD_PATH;
+
+	RTMP_EnableWrite(rtmp);
+
+	dstr_copy(&dest->encoder_name, "FMLE/3.0 (compatible; FMSc/1.0)");
+
+	set_rtmp_dstr(&rtmp->Link.pubUser,   &dest->username);
+	set_rtmp_dstr(&rtmp->Link.pubPasswd, &dest->password);
+	set_rtmp_dstr(&rtmp->Link.flashVer,  &dest->encoder_name);
+	rtmp->Link.swfUrl = rtmp->Link.tcUrl;
+
+	if (dstr_is_empty(&multi->bind_ip) ||
+	    dstr_cmp(&multi->bind_ip, "default") == 0) {
+		memset(&rtmp->m_bindIP, 0, sizeof(rtmp->m_bindIP));
+	} else {
+		netif_str_to_addr(&rtmp->m_bindIP.addr,
+				&rtmp->m_bindIP.addrLen,
+				multi->bind_ip.array);
+	}
+
+	RTMP_AddStream(rtmp, dest->key.array);
+
+	rtmp->m_outChunkSize       = 4096;
+	rtmp->m_bSendChunkSizeInfo = true;
+	rtmp->m_bUseNagle          = true;
+
+	if (!RTMP_Connect(rtmp, NULL))
+		return OBS_OUTPUT_CONNECT_FAILED;
+
+	if (!RTMP_ConnectStream(rtmp, 0))
+		return OBS_OUTPUT_INVALID_STREAM;
+
+	if (!send_headers(dest))
+		return OBS_OUTPUT_DISCONNECTED;
+
+	if (!set_blocking(dest, false))
+		return OBS_OUTPUT_ERROR;
+
+	dest_log(LOG_INFO, "Connection to %s successful", dest->url.array);
+	return OBS_OUTPUT_SUCCESS;
+}
+
+static void *connect_thread(void *data)
+{
+	struct rtmp_dest *dest = data;
+	int ret;
+
+	os_set_thread_name("rtmp-multi: connect_thread");
+
+	ret = dest_try_connect(dest);
+	if (ret != OBS_OUTPUT_SUCCESS)
+		RTMP_Close(&dest->rtmp);
+
+	os_atomic_set_long(&dest->connect_result, ret);
+	os_atomic_set_bool(&dest->connecting, false);
+	os_event_signal(dest->multi->data_event);
+	return NULL;
+}
+
+static void dest_start_connect(struct rtmp_dest *dest)
+{
+	struct rtmp_multi *multi = dest->multi;
+
+	dest->state = DEST_CONNECTING;
+	os_atomic_set_bool(&dest->connecting, true);
+
+	if (pthread_create(&dest->connect_thread, NULL, connect_thread,
+				dest) != 0) {
+		dest_log(LOG_WARNING, "Failed to create connect thread");
+		os_atomic_set_bool(&dest->connecting, false);
+		os_atomic_set_long(&dest->connect_result, OBS_OUTPUT_ERROR);
+		dest->state = DEST_FAILED;
+	}
+}
+
+/* ------------------------------------------------------------------------ */
+/* per destination queue and frame dropping */
+
+static inline void dest_clear_queue(struct rtmp_dest *dest)
+{
+	while (dest->queue.size) {
+		struct mux_msg *msg;
+		circlebuf_pop_front(&dest->queue, &msg, sizeof(msg));
+		msg_release(msg);
+	}
+
+	msg_release(dest->cur);
+	dest->cur = NULL;
+}
+
+static void dest_disconnect(struct rtmp_dest *dest, bool retry)
+{
+	struct rtmp_multi *multi = dest->multi;
+
+	if (dest->state == DEST_ACTIVE) {
+		set_blocking(dest, true);
+		dest_signal(dest, "destination_disconnected");
+	}
+
+	RTMP_Close(&dest->rtmp);
+	dest_clear_queue(dest);
+
+	if (retry && dest->retries < multi->max_retries) {
+		dest->retries++;
+		dest->reconnects++;
+		dest->retry_ts = os_gettime_ns() +
+			(uint64_t)multi->retry_delay_sec * 1000000000ULL;
+		dest->state = DEST_IDLE;
+
+		dest_log(LOG_INFO, "Reconnecting in %d second(s), attempt %d "
+				"of %d", multi->retry_delay_sec,
+				dest->retries, multi->max_retries);
+	} else {
+		dest->state = DEST_FAILED;
+	}
+}
+
+static void dest_drop_frames(struct rtmp_dest *dest, int highest_priority)
+{
+	struct circlebuf new_queue = {0};
+	int num_frames_dropped = 0;
+
+	while (dest->queue.size) {
+		struct mux_msg *msg;
+		circlebuf_pop_front(&dest->queue, &msg, sizeof(msg));
+
+		/* do not drop audio data or video keyframes */
+		if (msg->packet.type == OBS_ENCODER_AUDIO ||
+		    msg->packet.drop_priority >= highest_priority) {
+			circlebuf_push_back(&new_queue, &msg, sizeof(msg));
+		} else {
+			num_frames_dropped++;
+			msg_release(msg);
+		}
+	}
+
+	circlebuf_free(&dest->queue);
+	dest->queue = new_queue;
+
+	if (dest->min_priority < highest_priority)
+		dest->min_priority = highest_priority;
+
+	dest->dropped_frames += num_frames_dropped;
+}
+
+static void dest_check_to_drop_frames(struct rtmp_dest *dest, bool pframes)
+{
+	struct rtmp_multi *multi = dest->multi;
+	size_t count = dest->queue.size / sizeof(struct mux_msg*);
+	int64_t drop_threshold = pframes ?
+		multi->pframe_drop_threshold_usec :
+		multi->drop_threshold_usec;
+	int64_t buffer_duration_usec;
+	struct mux_msg *first = NULL;
+
+	if (count < 5) {
+		if (!pframes)
+			dest->congestion = 0.0f;
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		struct mux_msg **msg = circlebuf_data(&dest->queue,
+				i * sizeof(struct mux_msg*));
+		if ((*msg)->packet.type == OBS_ENCODER_VIDEO &&
+		    !(*msg)->packet.keyframe) {
+			first = *msg;
+			break;
+		}
+	}
+
+	if (!first)
+		return;
+
+	buffer_duration_usec = dest->last_dts_usec - first->packet.dts_usec;
+
+	if (!pframes)
+		dest->congestion = (float)buffer_duration_usec /
+			(float)drop_threshold;
+
+	if (buffer_duration_usec > drop_threshold)
+		dest_drop_frames(dest, pframes ?
+				OBS_NAL_PRIORITY_HIGHEST :
+				OBS_NAL_PRIORITY_HIGH);
+}
+
+static void dest_add_msg(struct rtmp_dest *dest, struct mux_msg *msg)
+{
+	struct encoder_packet *packet = &msg->packet;
+
+	if (packet->type == OBS_ENCODER_VIDEO) {
+		/* a (re)connected destination starts at the next keyframe */
+		if (dest->wait_keyframe) {
+			if (!packet->keyframe)
+				return;
+			dest->wait_keyframe = false;
+		}
+
+		dest_check_to_drop_frames(dest, false);
+		dest_check_to_drop_frames(dest, true);
+
+		if (packet->drop_priority < dest->min_priority) {
+			dest->dropped_frames++;
+			return;
+		}
+
+		dest->min_priority = 0;
+		dest->last_dts_usec = packet->dts_usec;
+
+	} else if (dest->wait_keyframe) {
+		return;
+	}
+
+	msg_addref(msg);
+	circlebuf_push_back(&dest->queue, &msg, sizeof(msg));
+}
+
+static inline bool dest_pending(struct rtmp_dest *dest)
+{
+	return dest->state == DEST_ACTIVE && (dest->cur || dest->queue.size);
+}
+
+/* ------------------------------------------------------------------------ */
+/* sending */
+
+static const uint8_t chunk_continuation = 0xC0 | MEDIA_CHANNEL;
+
+static inline void push_seg(struct rtmp_dest *dest, const uint8_t *data,
+		size_t size)
+{
+	struct send_seg *seg = da_push_back_new(dest->segs);
+	seg->data = data;
+	seg->size = size;
+}
+
+/* lays out the RTMP chunks of a message: a type 0 chunk header for this
+ * destination's stream, then the shared FLV tag body split at the chunk
+ * size with one-byte continuation headers */
+static void dest_begin_msg(struct rtmp_dest *dest, struct mux_msg *msg)
+{
+	uint8_t *h = dest->chunk_header;
+	uint32_t ts = msg->timestamp;
+	uint32_t ts24 = ts >= 0xFFFFFF ? 0xFFFFFF : ts;
+	uint32_t body_size = (uint32_t)msg->body.size;
+	int32_t stream_id = dest->rtmp.Link.streams[0].id;
+	size_t chunk_size = (size_t)dest->rtmp.m_outChunkSize;
+	size_t chunk_left = chunk_size;
+	size_t left = body_size;
+	size_t hsize = 12;
+
+
+	h[0]  = MEDIA_CHANNEL;
+	h[1]  = (uint8_t)(ts24 >> 16);
+	h[2]  = (uint8_t)(ts24 >> 8);
+	h[3]  = (uint8_t)ts24;
+	h[4]  = (uint8_t)(body_size >> 16);
+	h[5]  = (uint8_t)(body_size >> 8);
+	h[6]  = (uint8_t)body_size;
+	h[7]  = msg->rtmp_type;
+	h[8]  = (uint8_t)stream_id;
+	h[9]  = (uint8_t)(stream_id >> 8);
+	h[10] = (uint8_t)(stream_id >> 16);
+	h[11] = (uint8_t)(stream_id >> 24);
+
+	if (ts >= 0xFFFFFF) {
+		h[12] = (uint8_t)(ts >> 24);
+		h[13] = (uint8_t)(ts >> 16);
+		h[14] = (uint8_t)(ts >> 8);
+		h[15] = (uint8_t)ts;
+		hsize = 16;
+	}
+
+	da_resize(dest->segs, 0);
+	dest->seg_idx = 0;
+	push_seg(dest, h, hsize);
+
+	for (size_t i = 0; i < msg->body.pieces.num; i++) {
+		const AVal *piece = msg->body.pieces.array + i;
+		const uint8_t *data = (const uint8_t*)piece->av_val;
+		size_t offset = 0;
+
+		while (offset < (size_t)piece->av_len) {
+			size_t size = (size_t)piece->av_len - offset;
+			if (size > chunk_left)
+				size = chunk_left;
+
+			push_seg(dest, data + offset, size);
+			offset     += size;
+			left       -= size;
+			chunk_left -= size;
+
+			if (!chunk_left && left) {
+				push_seg(dest, &chunk_continuation, 1);
+				chunk_left = chunk_size;
+			}
+		}
+	}
+}
+
+/* returns the number of bytes sent, 0 if the socket is full, -1 on error */
+static int send_segs(struct rtmp_dest *dest)
+{
+	struct send_seg *segs = dest->segs.array + dest->seg_idx;
+	size_t count = dest->segs.num - dest->seg_idx;
+
+	if (count > MAX_SEND_SEGS)
+		count = MAX_SEND_SEGS;
+
+#ifdef _WIN32
+	WSABUF bufs[MAX_SEND_SEGS];
+	DWORD sent = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		bufs[i].buf = (char*)segs[i].data;
+		bufs[i].len = (ULONG)segs[i].size;
+	}
+
+	if (WSASend(dest->rtmp.m_sb.sb_socket, bufs, (DWORD)count, &sent, 0,
+				NULL, NULL) != 0) {
+		int err = WSAGetLastError();
+		if (err == WSAEWOULDBLOCK)
+			return 0;
+
+		dest->rtmp.last_error_code = err;
+		return -1;
+	}
+
+	return (int)sent;
+#else
+	struct iovec iov[MAX_SEND_SEGS];
+	struct msghdr msg = {0};
+	ssize_t sent;
+	int flags = 0;
+
+#ifdef MSG_NOSIGNAL
+	flags = MSG_NOSIGNAL;
+#endif
+
+	for (size_t i = 0; i < count; i++) {
+		iov[i].iov_base = (void*)segs[i].data;
+		iov[i].iov_len  = segs[i].size;
+	}
+
+	msg.msg_iov = iov;
+	msg.msg_iovlen = count;
+
+	sent = sendmsg(dest->rtmp.m_sb.sb_socket, &msg, flags);
+	if (sent < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return 0;
+
+		dest->rtmp.last_error_code = errno;
+		return -1;
+	}
+
+	return (int)sent;
+#endif
+}
+
+static void consume_segs(struct rtmp_dest *dest, size_t size)
+{
+	while (size) {
+		struct send_seg *seg = dest->segs.array + dest->seg_idx;
+
+		if (size < seg->size) {
+			seg->data += size;
+			seg->size -= size;
+			break;
+		}
+
+		size -= seg->size;
+		dest->seg_idx++;
+	}
+}
+
+static bool dest_send(struct rtmp_dest *dest)
+{
+	for (;;) {
+		int ret;
+
+		if (!dest->cur) {
+			if (!dest->queue.size)
+				return true;
+
+			circlebuf_pop_front(&dest->queue, &dest->cur,
+					sizeof(dest->cur));
+			dest_begin_msg(dest, dest->cur);
+		}
+
+		ret = send_segs(dest);
+		if (ret < 0)
+			return false;
+		if (ret == 0)
+			return true;
+
+		dest->total_bytes += (uint64_t)ret;
+		consume_segs(dest, (size_t)ret);
+
+		if (dest->seg_idx == dest->segs.num) {
+			msg_release(dest->cur);
+			dest->cur = NULL;
+		}
+	}
+}
+
+/* the server has nothing useful to say to a publisher, but its socket
+ * buffer must not fill up */
+static bool dest_discard_recv(struct rtmp_dest *dest)
+{
+	char discard[4096];
+
+	for (;;) {
+		int ret = recv(dest->rtmp.m_sb.sb_socket, discard,
+				sizeof(discard), 0);
+		if (ret > 0)
+			continue;
+		if (ret == 0)
+			return false;
+
+#ifdef _WIN32
+		int err = WSAGetLastError();
+		if (err == WSAEWOULDBLOCK)
+			return true;
+#else
+		int err = errno;
+		if (err == EAGAIN || err == EWOULDBLOCK || err == EINTR)
+			return true;
+#endif
+		dest->rtmp.last_error_code = err;
+		return false;
+	}
+}
+
+static void poll_dests(struct rtmp_multi *multi, bool pending)
+{
+	struct pollfd fds[MAX_DESTINATIONS];
+	struct rtmp_dest *polled[MAX_DESTINATIONS];
+	size_t num = 0;
+	int ret;
+
+	if (!pending) {
+		os_event_timedwait(multi->data_event, IDLE_INTERVAL_MS);
+		return;
+	}
+
+	for (size_t i = 0; i < multi->num_dests; i++) {
+		struct rtmp_dest *dest = multi->dests[i];
+		if (dest->state != DEST_ACTIVE)
+			continue;
+
+		fds[num].fd = dest->rtmp.m_sb.sb_socket;
+		fds[num].events = POLLIN;
+		fds[num].revents = 0;
+		if (dest_pending(dest))
+			fds[num].events |= POLLOUT;
+		polled[num++] = dest;
+	}
+
+	ret = poll(fds, (unsigned long)num, POLL_INTERVAL_MS);
+	if (ret <= 0)
+		return;
+
+	for (size_t i = 0; i < num; i++) {
+		struct rtmp_dest *dest = polled[i];
+		short revents = fds[i].revents;
+		bool success = true;
+
+		if (revents & (POLLERR | POLLHUP | POLLNVAL))
+			success = false;
+		if (success && (revents & POLLIN))
+			success = dest_discard_recv(dest);
+		if (success && (revents & POLLOUT))
+			success = dest_send(dest);
+
+		if (!success) {
+			dest_log(LOG_WARNING, "Disconnected, error %d",
+					dest->rtmp.last_error_code);
+			dest_disconnect(dest, true);
+		}
+	}
+}
+
+/* ------------------------------------------------------------------------ */
+/* loop thread */
+
+/* returns false once no destination can deliver data anymore */
+static bool update_connections(struct rtmp_multi *multi)
+{
+	uint64_t ts = os_gettime_ns();
+	size_t alive = 0;
+
+	for (size_t i = 0; i < multi->num_dests; i++) {
+		struct rtmp_dest *dest = multi->dests[i];
+
+		if (dest->state == DEST_CONNECTING &&
+		    !os_atomic_load_bool(&dest->connecting)) {
+			long ret = os_atomic_load_long(&dest->connect_result);
+
+			pthread_join(dest->connect_thread, NULL);
+
+			if (ret == OBS_OUTPUT_SUCCESS) {
+				dest->state = DEST_ACTIVE;
+				dest->retries = 0;
+				dest->wait_keyframe = true;
+				dest->min_priority = 0;
+				dest_signal(dest, "destination_connected");
+			} else {
+				dest_log(LOG_WARNING, "Connection failed (%ld)",
+						ret);
+				dest_disconnect(dest, ret !=
+						OBS_OUTPUT_BAD_PATH);
+			}
+		}
+
+		if (dest->state == DEST_IDLE && ts >= dest->retry_ts)
+			dest_start_connect(dest);
+
+		if (dest->state != DEST_FAILED)
+			alive++;
+	}
+
+	return alive > 0;
+}
+
+static inline bool queues_empty(struct rtmp_multi *multi)
+{
+	for (size_t i = 0; i < multi->num_dests; i++)
+		if (dest_pending(multi->dests[i]))
+			return false;
+	return true;
+}
+
+/* hands every new message to the destinations, returns true once the
+ * stop timestamp has been reached */
+static bool distribute(struct rtmp_multi *multi, bool draining)
+{
+	bool stop_reached = draining;
+
+	pthread_mutex_lock(&multi->intake_mutex);
+
+	while (multi->intake.size) {
+		struct mux_msg *msg;
+		circlebuf_pop_front(&multi->intake, &msg, sizeof(msg));
+
+		if (!stop_reached && multi->stop_ts &&
+		    msg->packet.sys_dts_usec >= (int64_t)multi->stop_ts)
+			stop_reached = true;
+
+		if (!stop_reached) {
+			for (size_t i = 0; i < multi->num_dests; i++) {
+				struct rtmp_dest *dest = multi->dests[i];
+				if (dest->state == DEST_ACTIVE)
+					dest_add_msg(dest, msg);
+			}
+		}
+
+		msg_release(msg);
+	}
+
+	pthread_mutex_unlock(&multi->intake_mutex);
+	return stop_reached;
+}
+
+static void free_intake(struct rtmp_multi *multi)
+{
+	pthread_mutex_lock(&multi->intake_mutex);
+	while (multi->intake.size) {
+		struct mux_msg *msg;
+		circlebuf_pop_front(&multi->intake, &msg, sizeof(msg));
+		msg_release(msg);
+	}
+	pthread_mutex_unlock(&multi->intake_mutex);
+}
+
+static void *loop_thread(void *data)
+{
+	struct rtmp_multi *multi = data;
+	bool draining = false;
+	bool disconnected = false;
+
+	os_set_thread_name("rtmp-multi: loop_thread");
+
+	for (size_t i = 0; i < multi->num_dests; i++)
+		dest_start_connect(multi->dests[i]);
+
+	for (;;) {
+		if (stopping(multi)) {
+			if (!multi->stop_ts)
+				break;
+			if (os_gettime_ns() >= multi->shutdown_timeout_ts) {
+				info("Stream shutdown timeout reached "
+				     "(%d second(s))",
+				     multi->max_shutdown_time_sec);
+				break;
+			}
+		}
+
+		if (!update_connections(multi)) {
+			disconnected = true;
+			break;
+		}
+
+		draining = distribute(multi, draining);
+		if (draining && queues_empty(multi))
+			break;
+
+		poll_dests(multi, !queues_empty(multi));
+	}
+
+	for (size_t i = 0; i < multi->num_dests; i++) {
+		struct rtmp_dest *dest = multi->dests[i];
+
+		if (dest->state == DEST_CONNECTING)
+			pthread_join(dest->connect_thread, NULL);
+		if (dest->state != DEST_FAILED)
+			dest_disconnect(dest, false);
+	}
+
+	free_intake(multi);
+	os_atomic_set_bool(&multi->active, false);
+
+	if (disconnected) {
+		warn("All destinations failed");
+		pthread_detach(multi->loop_thread);
+		multi->loop_thread_joinable = false;
+		obs_output_signal_stop(multi->output, OBS_OUTPUT_DISCONNECTED);
+	} else {
+		info("User stopped the stream");
+		obs_output_end_data_capture(multi->output);
+	}
+
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------ */
+
+static const char *rtmp_multi_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return obs_module_text("RTMPMultiStream");
+}
+
+static void free_dests(struct rtmp_multi *multi)
+{
+	for (size_t i = 0; i < multi->num_dests; i++) {
+		struct rtmp_dest *dest = multi->dests[i];
+
+		dest_clear_queue(dest);
+		circlebuf_free(&dest->queue);
+		da_free(dest->segs);
+		dstr_free(&dest->url);
+		dstr_free(&dest->key);
+		dstr_free(&dest->username);
+		dstr_free(&dest->password);
+		dstr_free(&dest->encoder_name);
+		bfree(dest);
+	}
+
+	multi->num_dests = 0;
+}
+
+static inline void join_loop_thread(struct rtmp_multi *multi)
+{
+	if (multi->loop_thread_joinable) {
+		pthread_join(multi->loop_thread, NULL);
+		multi->loop_thread_joinable = false;
+	}
+}
+
+static void rtmp_multi_destroy(void *data)
+{
+	struct rtmp_multi *multi = data;
+
+	if (os_atomic_load_bool(&multi->active)) {
+		multi->stop_ts = 0;
+		os_event_signal(multi->stop_event);
+		os_event_signal(multi->data_event);
+	}
+
+	join_loop_thread(multi);
+	free_intake(multi);
+	free_dests(multi);
+
+	circlebuf_free(&multi->intake);
+	dstr_free(&multi->bind_ip);
+	os_event_destroy(multi->data_event);
+	os_event_destroy(multi->stop_event);
+	pthread_mutex_destroy(&multi->intake_mutex);
+	bfree(multi);
+}
+
+static void *rtmp_multi_create(obs_data_t *settings, obs_output_t *output)
+{
+	struct rtmp_multi *multi = bzalloc(sizeof(struct rtmp_multi));
+	multi->output = output;
+	pthread_mutex_init_value(&multi->intake_mutex);
+
+	if (pthread_mutex_init(&multi->intake_mutex, NULL) != 0)
+		goto fail;
+	if (os_event_init(&multi->data_event, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail;
+	if (os_event_init(&multi->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail;
+
+	signal_handler_add_array(obs_output_get_signal_handler(output),
+			multi_signals);
+
+	UNUSED_PARAMETER(settings);
+	return multi;
+
+fail:
+	rtmp_multi_destroy(multi);
+	return NULL;
+}
+
+static bool init_dests(struct rtmp_multi *multi, obs_data_t *settings)
+{
+	obs_data_array_t *array = obs_data_get_array(settings,
+			OPT_DESTINATIONS);
+	size_t count = obs_data_array_count(array);
+
+	if (count > MAX_DESTINATIONS) {
+		warn("Only the first %d of %d destinations are used",
+				MAX_DESTINATIONS, (int)count);
+		count = MAX_DESTINATIONS;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_array_item(array, i);
+		struct rtmp_dest *dest = bzalloc(sizeof(struct rtmp_dest));
+
+		dest->multi = multi;
+		dest->index = i;
+		dest->rtmp.m_sb.sb_socket = -1;
+		dstr_copy(&dest->url,      obs_data_get_string(item, "server"));
+		dstr_copy(&dest->key,      obs_data_get_string(item, "key"));
+		dstr_copy(&dest->username, obs_data_get_string(item,
+					"username"));
+		dstr_copy(&dest->password, obs_data_get_string(item,
+					"password"));
+		dstr_depad(&dest->url);
+		dstr_depad(&dest->key);
+
+		multi->dests[multi->num_dests++] = dest;
+		obs_data_release(item);
+
+		if (dstr_is_empty(&dest->url)) {
+			warn("Destination %d has no URL", (int)i);
+			obs_data_array_release(array);
+			return false;
+		}
+	}
+
+	obs_data_array_release(array);
+	return multi->num_dests > 0;
+}
+
+static bool rtmp_multi_start(void *data)
+{
+	struct rtmp_multi *multi = data;
+	obs_data_t *settings;
+	int64_t drop_b, drop_p;
+	bool success;
+
+	if (!obs_output_can_begin_data_capture(multi->output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(multi->output, 0))
+		return false;
+
+	join_loop_thread(multi);
+	free_intake(multi);
+	free_dests(multi);
+
+	settings = obs_output_get_settings(multi->output);
+
+	drop_b = obs_data_get_int(settings, OPT_DROP_THRESHOLD);
+	drop_p = obs_data_get_int(settings, OPT_PFRAME_DROP_THRESHOLD);
+	if (drop_p < (drop_b + 200))
+		drop_p = drop_b + 200;
+
+	multi->drop_threshold_usec = 1000 * drop_b;
+	multi->pframe_drop_threshold_usec = 1000 * drop_p;
+	multi->max_shutdown_time_sec =
+		(int)obs_data_get_int(settings, OPT_MAX_SHUTDOWN_TIME_SEC);
+	multi->max_retries =
+		(int)obs_data_get_int(settings, OPT_MAX_RETRIES);
+	multi->retry_delay_sec =
+		(int)obs_data_get_int(settings, OPT_RETRY_DELAY_SEC);
+	dstr_copy(&multi->bind_ip,
+			obs_data_get_string(settings, OPT_BIND_IP));
+
+	success = init_dests(multi, settings);
+	obs_data_release(settings);
+
+	if (!success) {
+		warn("No usable destinations");
+		obs_output_set_last_error(multi->output, NULL);
+		free_dests(multi);
+		return false;
+	}
+
+	info("Streaming to %d destination(s)", (int)multi->num_dests);
+
+	multi->stop_ts = 0;
+	os_event_reset(multi->stop_event);
+	os_atomic_set_bool(&multi->active, true);
+
+	if (pthread_create(&multi->loop_thread, NULL, loop_thread,
+				multi) != 0) {
+		warn("Failed to create loop thread");
+		os_atomic_set_bool(&multi->active, false);
+		free_dests(multi);
+		return false;
+	}
+
+	multi->loop_thread_joinable = true;
+	obs_output_begin_data_capture(multi->output, 0);
+	return true;
+}
+
+static void rtmp_multi_stop(void *data, uint64_t ts)
+{
+	struct rtmp_multi *multi = data;
+
+	if (stopping(multi) && ts != 0)
+		return;
+
+	multi->stop_ts = ts / 1000ULL;
+	if (ts)
+		multi->shutdown_timeout_ts = ts +
+			(uint64_t)multi->max_shutdown_time_sec * 1000000000ULL;
+
+	os_event_signal(multi->stop_event);
+	os_event_signal(multi->data_event);
+}
+
+static void rtmp_multi_data(void *data, struct encoder_packet *packet)
+{
+	struct rtmp_multi *multi = data;
+	struct mux_msg *msg;
+
+	if (!os_atomic_load_bool(&multi->active))
+		return;
+	if (packet->track_idx != 0 || !packet->size)
+		return;
+
+	msg = bzalloc(sizeof(struct mux_msg));
+	msg->refs = 1;
+
+	obs_encoder_packet_ref(&msg->packet, packet);
+	if (packet->type == OBS_ENCODER_VIDEO)
+		obs_parse_avc_packet_priority(&msg->packet);
+
+	flv_body_build(&msg->body, &msg->packet, false);
+	msg->rtmp_type = packet->type == OBS_ENCODER_VIDEO ?
+		RTMP_PACKET_TYPE_VIDEO : RTMP_PACKET_TYPE_AUDIO;
+	msg->timestamp = get_ms_time(&msg->packet, msg->packet.dts) &
+		0x7FFFFFFF;
+
+	pthread_mutex_lock(&multi->intake_mutex);
+	circlebuf_push_back(&multi->intake, &msg, sizeof(msg));
+	pthread_mutex_unlock(&multi->intake_mutex);
+
+	os_event_signal(multi->data_event);
+}
+
+static void rtmp_multi_defaults(obs_data_t *defaults)
+{
+	obs_data_set_default_int(defaults, OPT_DROP_THRESHOLD, 700);
+	obs_data_set_default_int(defaults, OPT_PFRAME_DROP_THRESHOLD, 900);
+	obs_data_set_default_int(defaults, OPT_MAX_SHUTDOWN_TIME_SEC, 30);
+	obs_data_set_default_int(defaults, OPT_MAX_RETRIES, 20);
+	obs_data_set_default_int(defaults, OPT_RETRY_DELAY_SEC, 10);
+	obs_data_set_default_string(defaults, OPT_BIND_IP, "default");
+}
+
+static obs_properties_t *rtmp_multi_properties(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	obs_properties_t *props = obs_properties_create();
+
+	obs_properties_add_int(props, OPT_DROP_THRESHOLD,
+			obs_module_text("RTMPStream.DropThreshold"),
+			200, 10000, 100);
+	return props;
+}
+
+static uint64_t rtmp_multi_total_bytes_sent(void *data)
+{
+	struct rtmp_multi *multi = data;
+	uint64_t total = 0;
+
+	for (size_t i = 0; i < multi->num_dests; i++)
+		total += multi->dests[i]->total_bytes;
+	return total;
+}
+
+static int rtmp_multi_dropped_frames(void *data)
+{
+	struct rtmp_multi *multi = data;
+	int dropped = 0;
+
+	for (size_t i = 0; i < multi->num_dests; i++)
+		dropped += multi->dests[i]->dropped_frames;
+	return dropped;
+}
+
+/* reports the most congested destination */
+static float rtmp_multi_congestion(void *data)
+{
+	struct rtmp_multi *multi = data;
+	float congestion = 0.0f;
+
+	for (size_t i = 0; i < multi->num_dests; i++) {
+		struct rtmp_dest *dest = multi->dests[i];
+		float cur = dest->min_priority > 0 ? 1.0f : dest->congestion;
+
+		if (cur > congestion)
+			congestion = cur;
+	}
+
+	return congestion;
+}
+
+struct obs_output_info rtmp_multi_output_info = {
+	.id                 = "rtmp_multi_output",
+	.flags              = OBS_OUTPUT_AV |
+	                      OBS_OUTPUT_ENCODED,
+	.get_name           = rtmp_multi_getname,
+	.create             = rtmp_multi_create,
+	.destroy            = rtmp_multi_destroy,
+	.start              = rtmp_multi_start,
+	.stop               = rtmp_multi_stop,
+	.encoded_packet     = rtmp_multi_data,
+	.get_defaults       = rtmp_multi_defaults,
+	.get_properties     = rtmp_multi_properties,
+	.get_total_bytes    = rtmp_multi_total_bytes_sent,
+	.get_congestion     = rtmp_multi_congestion,
+	.get_dropped_frames = rtmp_multi_dropped_frames
+};
@@ -17,6 +17,10 @@
 
 #include "rtmp-stream.h"
 
+static const char *dbr_signal_decl =
+	"void bitrate_changed(ptr output, int bitrate, int prev_bitrate, "
+	"int throughput)";
+
 static const char *rtmp_stream_getname(void *unused)
 {
 	UNUSED_PARAMETER(unused);
@@ -99,6 +103,7 @@ static void rtmp_stream_destroy(void *data)
 	dstr_free(&stream->password);
 	dstr_free(&stream->encoder_name);
 	dstr_free(&stream->bind_ip);
+	flv_body_free(&stream->send_body);
 	os_event_destroy(stream->stop_event);
 	os_sem_destroy(stream->send_sem);
 	pthread_mutex_destroy(&stream->packets_mutex);
@@ -112,6 +117,9 @@ static void rtmp_stream_destroy(void *data)
 	os_event_destroy(stream->socket_available_event);
 	os_event_destroy(stream->send_thread_signaled_exit);
 	pthread_mutex_destroy(&stream->write_buf_mutex);
+#ifdef __linux__
+	socket_thread_linux_free(stream);
+#endif
 
 	if (stream->write_buf)
 		bfree(stream->write_buf);
@@ -123,6 +131,9 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 	struct rtmp_stream *stream = bzalloc(sizeof(struct rtmp_stream));
 	stream->output = output;
 	pthread_mutex_init_value(&stream->packets_mutex);
+#ifdef __linux__
+	stream->socket_wake_fd = -1;
+#endif
 
 	RTMP_Init(&stream->rtmp);
 	RTMP_LogSetCallback(log_rtmp);
@@ -133,6 +144,9 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 	if (os_event_init(&stream->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
 		goto fail;
 
+	signal_handler_add(obs_output_get_signal_handler(output),
+			dbr_signal_decl);
+
 	if (pthread_mutex_init(&stream->write_buf_mutex, NULL) != 0) {
 		warn("Failed to initialize write buffer mutex");
 		goto fail;
@@ -291,6 +305,14 @@ static void droptest_cap_data_rate(struct rtmp_stream *stream, size_t size)
 }
 #endif
 
+static inline void signal_socket_thread(struct rtmp_stream *stream)
+{
+	os_event_signal(stream->buffer_has_data_event);
+#ifdef __linux__
+	socket_thread_linux_wake(stream);
+#endif
+}
+
 static int socket_queue_data(RTMPSockBuf *sb, const char *data, int len, void *arg)
 {
 	struct rtmp_stream *stream = arg;
@@ -318,16 +340,37 @@ retry_send:
 
 	pthread_mutex_unlock(&stream->write_buf_mutex);
 
-	os_event_signal (stream->buffer_has_data_event);
+	signal_socket_thread(stream);
 
 	return len;
 }
 
+/* sends the FLV tag body of a packet as a single RTMP message; the payload
+ * goes to the socket straight from the encoder packet instead of being
+ * serialized into an FLV tag first and re-chunked by RTMP_Write */
+static int send_flv_tag(struct rtmp_stream *stream,
+		struct encoder_packet *packet, size_t idx)
+{
+	RTMP *rtmp = &stream->rtmp;
+	uint32_t time_ms = get_ms_time(packet, packet->dts) & 0x7FFFFFFF;
+	RTMPPacket pkt = {0};
+
+	pkt.m_packetType = packet->type == OBS_ENCODER_VIDEO ?
+		RTMP_PACKET_TYPE_VIDEO : RTMP_PACKET_TYPE_AUDIO;
+	pkt.m_headerType = time_ms ?
+		RTMP_PACKET_SIZE_MEDIUM : RTMP_PACKET_SIZE_LARGE;
+	pkt.m_nChannel = 0x04;
+	pkt.m_nTimeStamp = time_ms;
+	pkt.m_nInfoField2 = rtmp->Link.streams[idx].id;
+
+	return RTMP_SendPacketV(rtmp, &pkt, stream->send_body.pieces.array,
+			(int)stream->send_body.pieces.num) ? 0 : -1;
+}
+
 static int send_packet(struct rtmp_stream *stream,
 		struct encoder_packet *packet, bool is_header, size_t idx)
 {
-	uint8_t *data;
-	size_t  size;
+	size_t  size = 0;
 	int     recv_size = 0;
 	int     ret = 0;
 
@@ -345,14 +388,16 @@ static int send_packet(struct rtmp_stream *stream,
 		}
 	}
 
-	flv_packet_mux(packet, &data, &size, is_header);
+	if (packet->data && packet->size) {
+		flv_body_build(&stream->send_body, packet, is_header);
+		size = FLV_TAG_HEADER_SIZE + stream->send_body.size + 4;
 
 #ifdef TEST_FRAMEDROPS
-	droptest_cap_data_rate(stream, size);
+		droptest_cap_data_rate(stream, size);
 #endif
 
-	ret = RTMP_Write(&stream->rtmp, (char*)data, (int)size, (int)idx);
-	bfree(data);
+		ret = send_flv_tag(stream, packet, idx);
+	}
 
 	if (is_header)
 		bfree(packet->data);
@@ -436,6 +481,144 @@ static void set_output_error(struct rtmp_stream *stream)
 	obs_output_set_last_error(stream->output, msg);
 }
 
+/* ------------------------------------------------------------------------ */
+/* dynamic bitrate: trades quality for frames when the connection can't keep
+ * up, and gradually restores the configured bitrate once it recovers */
+
+#define DBR_CHECK_INTERVAL_NS  1000000000ULL
+#define DBR_INC_DELAY_NS       5000000000ULL
+#define DBR_MIN_BITRATE        100
+/* the most the bitrate may fall in a single update, in percent */
+#define DBR_MAX_DROP_PERCENT   25
+
+static inline long encoder_bitrate(obs_encoder_t *encoder)
+{
+	obs_data_t *settings = obs_encoder_get_settings(encoder);
+	long bitrate = (long)obs_data_get_int(settings, "bitrate");
+
+	obs_data_release(settings);
+	return bitrate;
+}
+
+static void dbr_init(struct rtmp_stream *stream)
+{
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
+	obs_encoder_t *aencoder;
+
+	stream->dbr_audio_bitrate = 0;
+	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
+		aencoder = obs_output_get_audio_encoder(stream->output, i);
+		if (aencoder)
+			stream->dbr_audio_bitrate += encoder_bitrate(aencoder);
+	}
+
+	stream->dbr_orig_bitrate = vencoder ? encoder_bitrate(vencoder) : 0;
+	stream->dbr_cur_bitrate = stream->dbr_orig_bitrate;
+	stream->dbr_last_check_ns = os_gettime_ns();
+	stream->dbr_last_change_ns = stream->dbr_last_check_ns;
+	stream->dbr_last_bytes_sent = stream->total_bytes_sent;
+	stream->dbr_prev_buffer_usec = 0;
+
+	if (stream->dbr_orig_bitrate <= DBR_MIN_BITRATE) {
+		warn("Dynamic bitrate disabled, video encoder has no usable "
+		     "bitrate setting");
+		stream->dbr_enabled = false;
+		return;
+	}
+
+	info("Dynamic bitrate enabled, starting at %ld kbps",
+			stream->dbr_orig_bitrate);
+}
+
+static void dbr_set_bitrate(struct rtmp_stream *stream, long bitrate,
+		long throughput)
+{
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
+	obs_data_t *settings = obs_data_create();
+	long prev = stream->dbr_cur_bitrate;
+	struct calldata params;
+	uint8_t stack[128];
+
+	obs_data_set_int(settings, "bitrate", bitrate);
+	obs_encoder_update(vencoder, settings);
+	obs_data_release(settings);
+
+	stream->dbr_cur_bitrate = bitrate;
+	stream->dbr_last_change_ns = os_gettime_ns();
+
+	info("Dynamic bitrate: %ld -> %ld kbps (throughput %ld kbps, "
+	     "buffer %d ms)", prev, bitrate, throughput,
+	     (int)(stream->buffer_duration_usec / 1000));
+
+	calldata_init_fixed(&params, stack, sizeof(stack));
+	calldata_set_ptr(&params, "output", stream->output);
+	calldata_set_int(&params, "bitrate", bitrate);
+	calldata_set_int(&params, "prev_bitrate", prev);
+	calldata_set_int(&params, "throughput", throughput);
+	signal_handler_signal(obs_output_get_signal_handler(stream->output),
+			"bitrate_changed", &params);
+}
+
+static void dbr_update(struct rtmp_stream *stream)
+{
+	uint64_t ts = os_gettime_ns();
+	uint64_t elapsed = ts - stream->dbr_last_check_ns;
+	int64_t buffer_duration;
+	long throughput;
+	long bitrate = stream->dbr_cur_bitrate;
+	long min_step = bitrate * (100 - DBR_MAX_DROP_PERCENT) / 100;
+
+	if (elapsed < DBR_CHECK_INTERVAL_NS)
+		return;
+
+	pthread_mutex_lock(&stream->packets_mutex);
+	buffer_duration = stream->buffer_duration_usec;
+	pthread_mutex_unlock(&stream->packets_mutex);
+
+	throughput = (long)((stream->total_bytes_sent -
+			stream->dbr_last_bytes_sent) * 8 * 1000000ULL /
+			elapsed);
+	stream->dbr_last_bytes_sent = stream->total_bytes_sent;
+	stream->dbr_last_check_ns = ts;
+
+	if (buffer_duration > stream->drop_threshold_usec / 2) {
+		/* what actually made it out, minus audio, with some headroom
+		 * for the backlog to drain.  once lowered, wait for the backlog
+		 * to stop shrinking before cutting any further */
+		long target = (throughput - stream->dbr_audio_bitrate) * 9 / 10;
+
+		if (target < bitrate)
+			bitrate = target;
+		else if (buffer_duration >= stream->dbr_prev_buffer_usec)
+			bitrate = bitrate * 85 / 100;
+
+	} else if (buffer_duration < stream->drop_threshold_usec / 8 &&
+	           ts - stream->dbr_last_change_ns >= DBR_INC_DELAY_NS) {
+		bitrate += stream->dbr_orig_bitrate / 20;
+	}
+
+	stream->dbr_prev_buffer_usec = buffer_duration;
+
+	/* a single window with a stalled socket reads as almost no
+	 * throughput, so step down gradually rather than to the floor */
+	if (bitrate < min_step)
+		bitrate = min_step;
+
+	if (bitrate > stream->dbr_orig_bitrate)
+		bitrate = stream->dbr_orig_bitrate;
+	if (bitrate < DBR_MIN_BITRATE)
+		bitrate = DBR_MIN_BITRATE;
+
+	if (bitrate != stream->dbr_cur_bitrate)
+		dbr_set_bitrate(stream, bitrate, throughput);
+}
+
+static inline void dbr_restore(struct rtmp_stream *stream)
+{
+	if (stream->dbr_cur_bitrate != stream->dbr_orig_bitrate)
+		dbr_set_bitrate(stream, stream->dbr_orig_bitrate, 0);
+}
+
 static void *send_thread(void *data)
 {
 	struct rtmp_stream *stream = data;
@@ -470,8 +653,14 @@ static void *send_thread(void *data)
 			os_atomic_set_bool(&stream->disconnected, true);
 			break;
 		}
+
+		if (stream->dbr_enabled)
+			dbr_update(stream);
 	}
 
+	if (stream->dbr_enabled)
+		dbr_restore(stream);
+
 	if (disconnected(stream)) {
 		info("Disconnected from %s", stream->path.array);
 	} else {
@@ -480,7 +669,7 @@ static void *send_thread(void *data)
 
 	if (stream->new_socket_loop) {
 		os_event_signal(stream->send_thread_signaled_exit);
-		os_event_signal(stream->buffer_has_data_event);
+		signal_socket_thread(stream);
 		pthread_join(stream->socket_thread, NULL);
 		stream->socket_thread_active = false;
 		stream->rtmp.m_bCustomSend = false;
@@ -619,6 +808,9 @@ static int init_send(struct rtmp_stream *stream)
 
 	reset_semaphore(stream);
 
+	if (stream->dbr_enabled)
+		dbr_init(stream);
+
 	ret = pthread_create(&stream->send_thread, NULL, send_thread, stream);
 	if (ret != 0) {
 		RTMP_Close(&stream->rtmp);
@@ -683,6 +875,15 @@ static int init_send(struct rtmp_stream *stream)
 #ifdef _WIN32
 		ret = pthread_create(&stream->socket_thread, NULL,
 				socket_thread_windows, stream);
+#elif defined(__linux__)
+		if (!socket_thread_linux_init(stream)) {
+			RTMP_Close(&stream->rtmp);
+			warn("Failed to create socket wake event");
+			return OBS_OUTPUT_ERROR;
+		}
+
+		ret = pthread_create(&stream->socket_thread, NULL,
+				socket_thread_linux, stream);
 #else
 		warn("New socket loop not supported on this platform");
 		return OBS_OUTPUT_ERROR;
@@ -890,6 +1091,7 @@ static bool init_connect(struct rtmp_stream *stream)
 			OPT_NEWSOCKETLOOP_ENABLED);
 	stream->low_latency_mode = obs_data_get_bool(settings,
 			OPT_LOWLATENCY_ENABLED);
+	stream->dbr_enabled = obs_data_get_bool(settings, OPT_DYN_BITRATE);
 
 	obs_data_release(settings);
 	return true;
@@ -1027,8 +1229,10 @@ static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 		stream->drop_threshold_usec;
 
 	if (num_packets < 5) {
-		if (!pframes)
+		if (!pframes) {
 			stream->congestion = 0.0f;
+			stream->buffer_duration_usec = 0;
+		}
 		return;
 	}
 
@@ -1042,6 +1246,7 @@ static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 	if (!pframes) {
 		stream->congestion = (float)buffer_duration_usec /
 			(float)drop_threshold;
+		stream->buffer_duration_usec = buffer_duration_usec;
 	}
 
 	if (buffer_duration_usec > drop_threshold) {
@@ -1078,10 +1283,11 @@ static void rtmp_stream_data(void *data, struct encoder_packet *packet)
 	if (disconnected(stream) || !active(stream))
 		return;
 
+	/* the payload stays in Annex B form and is shared with the other
+	 * outputs, send_packet adds the AVCC length prefixes on the fly */
+	obs_encoder_packet_ref(&new_packet, packet);
 	if (packet->type == OBS_ENCODER_VIDEO)
-		obs_parse_avc_packet(&new_packet, packet);
-	else
-		obs_encoder_packet_ref(&new_packet, packet);
+		obs_parse_avc_packet_priority(&new_packet);
 
 	pthread_mutex_lock(&stream->packets_mutex);
 
@@ -1107,6 +1313,7 @@ static void rtmp_stream_defaults(obs_data_t *defaults)
 	obs_data_set_default_string(defaults, OPT_BIND_IP, "default");
 	obs_data_set_default_bool(defaults, OPT_NEWSOCKETLOOP_ENABLED, false);
 	obs_data_set_default_bool(defaults, OPT_LOWLATENCY_ENABLED, false);
+	obs_data_set_default_bool(defaults, OPT_DYN_BITRATE, false);
 }
 
 static obs_properties_t *rtmp_stream_properties(void *unused)
@@ -1120,6 +1327,8 @@ static obs_properties_t *rtmp_stream_properties(void *unused)
 	obs_properties_add_int(props, OPT_DROP_THRESHOLD,
 			obs_module_text("RTMPStream.DropThreshold"),
 			200, 10000, 100);
+	obs_properties_add_bool(props, OPT_DYN_BITRATE,
+			obs_module_text("RTMPStream.DynamicBitrate"));
 
 	p = obs_properties_add_list(props, OPT_BIND_IP,
 			obs_module_text("RTMPStream.BindIP"),
@@ -1158,10 +1367,16 @@ static float rtmp_stream_congestion(void *data)
 {
 	struct rtmp_stream *stream = data;
 
-	if (stream->new_socket_loop)
-		return (float)stream->write_buf_len /
-			(float)stream->write_buf_size;
-	else
+	if (stream->new_socket_loop) {
+		float buffered = (float)stream->write_buf_len;
+#ifdef __linux__
+		/* data the kernel has accepted but not put on the wire yet */
+		buffered += (float)os_atomic_load_long(
+				&stream->socket_unsent_bytes);
+#endif
+		float congestion = buffered / (float)stream->write_buf_size;
+		return congestion > 1.0f ? 1.0f : congestion;
+	} else
 		return stream->min_priority > 0 ? 1.0f : stream->congestion;
 }
 
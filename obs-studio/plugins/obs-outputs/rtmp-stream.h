@@ -30,6 +30,7 @@
 #define OPT_BIND_IP "bind_ip"
 #define OPT_NEWSOCKETLOOP_ENABLED "new_socket_loop_enabled"
 #define OPT_LOWLATENCY_ENABLED "low_latency_mode_enabled"
+#define OPT_DYN_BITRATE "dyn_bitrate"
 
 //#define TEST_FRAMEDROPS
 
@@ -70,6 +71,8 @@ struct rtmp_stream {
 	struct dstr      encoder_name;
 	struct dstr      bind_ip;
 
+	struct flv_body  send_body;
+
 	/* frame drop variables */
 	int64_t          drop_threshold_usec;
 	int64_t          pframe_drop_threshold_usec;
@@ -80,6 +83,17 @@ struct rtmp_stream {
 
 	uint64_t         total_bytes_sent;
 	int              dropped_frames;
+	int64_t          buffer_duration_usec;
+
+	/* dynamic bitrate, all in kbps */
+	bool             dbr_enabled;
+	long             dbr_orig_bitrate;
+	long             dbr_cur_bitrate;
+	long             dbr_audio_bitrate;
+	uint64_t         dbr_last_check_ns;
+	uint64_t         dbr_last_change_ns;
+	uint64_t         dbr_last_bytes_sent;
+	int64_t          dbr_prev_buffer_usec;
 
 #ifdef TEST_FRAMEDROPS
 	struct circlebuf droptest_info;
@@ -101,8 +115,17 @@ struct rtmp_stream {
 	os_event_t       *buffer_has_data_event;
 	os_event_t       *socket_available_event;
 	os_event_t       *send_thread_signaled_exit;
+#ifdef __linux__
+	int              socket_wake_fd;
+	volatile long    socket_unsent_bytes;
+#endif
 };
 
 #ifdef _WIN32
 void *socket_thread_windows(void *data);
+#elif defined(__linux__)
+void *socket_thread_linux(void *data);
+void socket_thread_linux_wake(struct rtmp_stream *stream);
+bool socket_thread_linux_init(struct rtmp_stream *stream);
+void socket_thread_linux_free(struct rtmp_stream *stream);
 #endif
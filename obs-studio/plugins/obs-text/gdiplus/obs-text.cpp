@@ -594,6 +594,8 @@ void TextSource::RenderText()
 		gs_texture_set_image(tex, bits.get(), size.cx * 4, false);
 		obs_leave_graphics();
 	}
+
+	obs_source_content_changed(source);
 }
 
 const char *TextSource::GetMainString(const char *str)
@@ -950,7 +952,7 @@ bool obs_module_load(void)
 	obs_source_info si = {};
 	si.id = "text_gdiplus";
 	si.type = OBS_SOURCE_TYPE_INPUT;
-	si.output_flags = OBS_SOURCE_VIDEO;
+	si.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_STATIC_CONTENT;
 	si.get_properties = get_properties;
 
 	si.get_name = [] (void*)
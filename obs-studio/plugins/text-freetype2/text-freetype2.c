@@ -38,7 +38,8 @@ static struct obs_source_info freetype2_source_info = {
 #ifdef _WIN32
 	                OBS_SOURCE_DEPRECATED |
 #endif
-	                OBS_SOURCE_CUSTOM_DRAW,
+	                OBS_SOURCE_CUSTOM_DRAW |
+	                OBS_SOURCE_STATIC_CONTENT,
 	.get_name = ft2_source_get_name,
 	.create = ft2_source_create,
 	.destroy = ft2_source_destroy,
@@ -246,6 +247,7 @@ static void ft2_video_tick(void *data, float seconds)
 					srcdata->text_file);
 			cache_glyphs(srcdata, srcdata->text);
 			set_up_vertex_buffer(srcdata);
+			obs_source_content_changed(srcdata->src);
 		}
 	}
 
@@ -434,6 +436,7 @@ skip_font_load:
 	if (srcdata->font_face) {
 		cache_glyphs(srcdata, srcdata->text);
 		set_up_vertex_buffer(srcdata);
+		obs_source_content_changed(srcdata->src);
 	}
 
 error:
@@ -0,0 +1,239 @@
+/*
+ * Measures the throughput of the CPU colour conversion kernels for every
+ * implementation the CPU supports, and checks each one against the scalar
+ * reference output.
+ *
+ *   bench-format-conversion [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <media-io/format-conversion.h>
+
+struct resolution {
+	const char *name;
+	uint32_t cx;
+	uint32_t cy;
+};
+
+static const struct resolution resolutions[] = {
+	{"720p",  1280,  720},
+	{"1080p", 1920, 1080},
+	{"1440p", 2560, 1440},
+	{"2160p", 3840, 2160}
+};
+
+#define NUM_RESOLUTIONS (sizeof(resolutions) / sizeof(resolutions[0]))
+
+static const enum format_conversion_impl impls[] = {
+	FORMAT_CONVERSION_IMPL_C,
+	FORMAT_CONVERSION_IMPL_SSE2,
+	FORMAT_CONVERSION_IMPL_AVX2
+};
+
+#define NUM_IMPLS (sizeof(impls) / sizeof(impls[0]))
+
+enum kernel {
+	KERNEL_UYVX_TO_I420,
+	KERNEL_UYVX_TO_NV12,
+	KERNEL_UYVX_TO_I444,
+	KERNEL_DECOMPRESS_420,
+	KERNEL_DECOMPRESS_NV12,
+	KERNEL_DECOMPRESS_422,
+	KERNEL_COUNT
+};
+
+static const char *kernel_names[KERNEL_COUNT] = {
+	"compress_uyvx_to_i420",
+	"compress_uyvx_to_nv12",
+	"convert_uyvx_to_i444",
+	"decompress_420",
+	"decompress_nv12",
+	"decompress_422"
+};
+
+struct buffers {
+	uint32_t cx, cy;
+
+	/* packed 32bpp: source of the compress kernels, destination of the
+	 * decompress kernels */
+	uint8_t  *packed;
+	uint32_t packed_linesize;
+
+	/* planar/semi-planar, up to 444 sized */
+	uint8_t  *planes[3];
+	uint32_t planes_linesize[3];
+
+	/* packed 422 source */
+	uint8_t  *yuy2;
+	uint32_t yuy2_linesize;
+};
+
+static void fill_random(uint8_t *data, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		data[i] = (uint8_t)rand();
+}
+
+static void buffers_init(struct buffers *buf, uint32_t cx, uint32_t cy)
+{
+	buf->cx = cx;
+	buf->cy = cy;
+
+	buf->packed_linesize = cx * 4;
+	buf->packed = bmalloc(buf->packed_linesize * cy);
+	fill_random(buf->packed, buf->packed_linesize * cy);
+
+	for (size_t i = 0; i < 3; i++) {
+		buf->planes_linesize[i] = cx;
+		buf->planes[i] = bmalloc(cx * cy);
+		fill_random(buf->planes[i], cx * cy);
+	}
+
+	buf->yuy2_linesize = cx * 2;
+	buf->yuy2 = bmalloc(buf->yuy2_linesize * cy);
+	fill_random(buf->yuy2, buf->yuy2_linesize * cy);
+}
+
+static void buffers_free(struct buffers *buf)
+{
+	bfree(buf->packed);
+	for (size_t i = 0; i < 3; i++)
+		bfree(buf->planes[i]);
+	bfree(buf->yuy2);
+}
+
+/* returns the number of bytes read by the kernel */
+static size_t run_kernel(enum kernel kernel, struct buffers *buf)
+{
+	const uint8_t *const *planes = (const uint8_t *const *)buf->planes;
+	uint32_t cx = buf->cx;
+	uint32_t cy = buf->cy;
+
+	switch (kernel) {
+	case KERNEL_UYVX_TO_I420:
+		compress_uyvx_to_i420(buf->packed, buf->packed_linesize,
+				0, cy, buf->planes, buf->planes_linesize);
+		return (size_t)buf->packed_linesize * cy;
+
+	case KERNEL_UYVX_TO_NV12:
+		compress_uyvx_to_nv12(buf->packed, buf->packed_linesize,
+				0, cy, buf->planes, buf->planes_linesize);
+		return (size_t)buf->packed_linesize * cy;
+
+	case KERNEL_UYVX_TO_I444:
+		convert_uyvx_to_i444(buf->packed, buf->packed_linesize,
+				0, cy, buf->planes, buf->planes_linesize);
+		return (size_t)buf->packed_linesize * cy;
+
+	case KERNEL_DECOMPRESS_420:
+		decompress_420(planes, buf->planes_linesize, 0, cy,
+				buf->packed, buf->packed_linesize);
+		return (size_t)cx * cy * 3 / 2;
+
+	case KERNEL_DECOMPRESS_NV12:
+		decompress_nv12(planes, buf->planes_linesize, 0, cy,
+				buf->packed, buf->packed_linesize);
+		return (size_t)cx * cy * 3 / 2;
+
+	case KERNEL_DECOMPRESS_422:
+		decompress_422(buf->yuy2, buf->yuy2_linesize, 0, cy,
+				buf->packed, buf->packed_linesize, true);
+		return (size_t)buf->yuy2_linesize * cy;
+
+	case KERNEL_COUNT:
+		break;
+	}
+
+	return 0;
+}
+
+/* runs the kernel once on fresh data and compares against the reference */
+static bool verify_kernel(enum kernel kernel, enum format_conversion_impl impl,
+		uint32_t cx, uint32_t cy)
+{
+	struct buffers ref, test;
+	bool match = true;
+
+	srand(cx * cy);
+	buffers_init(&ref, cx, cy);
+	srand(cx * cy);
+	buffers_init(&test, cx, cy);
+
+	format_conversion_set_impl(FORMAT_CONVERSION_IMPL_C);
+	run_kernel(kernel, &ref);
+	format_conversion_set_impl(impl);
+	run_kernel(kernel, &test);
+
+	if (memcmp(ref.packed, test.packed, ref.packed_linesize * cy) != 0)
+		match = false;
+	for (size_t i = 0; i < 3; i++)
+		if (memcmp(ref.planes[i], test.planes[i], cx * cy) != 0)
+			match = false;
+
+	buffers_free(&ref);
+	buffers_free(&test);
+	return match;
+}
+
+int main(int argc, char *argv[])
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : 100;
+	int mismatches = 0;
+
+	if (iterations <= 0)
+		iterations = 100;
+
+	printf("%-22s %-6s %-5s %10s %8s\n",
+			"kernel", "res", "impl", "MB/s", "result");
+
+	for (size_t r = 0; r < NUM_RESOLUTIONS; r++) {
+		const struct resolution *res = &resolutions[r];
+		struct buffers buf;
+
+		buffers_init(&buf, res->cx, res->cy);
+
+		for (int k = 0; k < KERNEL_COUNT; k++) {
+			for (size_t i = 0; i < NUM_IMPLS; i++) {
+				enum format_conversion_impl impl = impls[i];
+				uint64_t start, elapsed;
+				size_t bytes = 0;
+				bool match;
+
+				if (!format_conversion_impl_supported(impl))
+					continue;
+
+				/* a width that is not a multiple of the vector size
+				 * exercises the scalar tails */
+				match = verify_kernel(k, impl, res->cx - 4,
+						res->cy);
+				if (!match)
+					mismatches++;
+
+				format_conversion_set_impl(impl);
+				run_kernel(k, &buf);
+
+				start = os_gettime_ns();
+				for (int n = 0; n < iterations; n++)
+					bytes += run_kernel(k, &buf);
+				elapsed = os_gettime_ns() - start;
+
+				printf("%-22s %-6s %-5s %10.1f %8s\n",
+						kernel_names[k], res->name,
+						format_conversion_impl_name(
+							impl),
+						(double)bytes * 1000.0 /
+						(double)elapsed,
+						match ? "ok" : "MISMATCH");
+			}
+		}
+
+		buffers_free(&buf);
+	}
+
+	return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
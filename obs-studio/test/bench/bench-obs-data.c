@@ -0,0 +1,200 @@
+/*
+ * Measures obs_data_t creation, JSON load and get/set throughput for objects
+ * with different numbers of keys, and checks that the item order is
+ * unaffected by the lookup index.  Returns nonzero if any check fails.
+ *
+ *   bench-obs-data [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <obs-data.h>
+
+static const size_t key_counts[] = {10, 100, 1000, 10000};
+
+#define NUM_KEY_COUNTS (sizeof(key_counts) / sizeof(key_counts[0]))
+
+static char **create_keys(size_t count)
+{
+	char **keys = bmalloc(count * sizeof(char*));
+
+	for (size_t i = 0; i < count; i++) {
+		keys[i] = bmalloc(32);
+		snprintf(keys[i], 32, "setting_%08x_%zu", (unsigned)rand(),
+				i);
+	}
+
+	return keys;
+}
+
+static void free_keys(char **keys, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		bfree(keys[i]);
+	bfree(keys);
+}
+
+static bool check_order(obs_data_t *data, size_t count)
+{
+	obs_data_item_t *item = obs_data_first(data);
+	const char *prev = NULL;
+	size_t num = 0;
+
+	for (; item; obs_data_item_next(&item)) {
+		const char *name = obs_data_item_get_name(item);
+
+		if (prev && strcmp(prev, name) > 0) {
+			obs_data_item_release(&item);
+			return false;
+		}
+
+		prev = name;
+		num++;
+	}
+
+	return num == count;
+}
+
+static double mops(size_t ops, uint64_t time)
+{
+	return (double)ops * 1000.0 / (double)(time ? time : 1);
+}
+
+static bool bench_keys(size_t count, int iterations)
+{
+	char **keys = create_keys(count);
+	obs_data_t *data;
+	obs_data_t *loaded;
+	uint64_t start, create_time, load_time, set_time, get_time;
+	long long sum = 0;
+	size_t ops = count * (size_t)iterations;
+	bool success = true;
+
+	/* keys are inserted in random order, so every insert has to find
+	 * its sorted position */
+	start = os_gettime_ns();
+	data = obs_data_create();
+	for (size_t i = 0; i < count; i++)
+		obs_data_set_int(data, keys[i], (long long)i);
+	create_time = os_gettime_ns() - start;
+
+	if (!check_order(data, count))
+		success = false;
+
+	start = os_gettime_ns();
+	loaded = obs_data_create_from_json(obs_data_get_json(data));
+	load_time = os_gettime_ns() - start;
+
+	if (!check_order(loaded, count))
+		success = false;
+	for (size_t i = 0; i < count; i++)
+		if (obs_data_get_int(loaded, keys[i]) != (long long)i)
+			success = false;
+
+	obs_data_release(loaded);
+
+	start = os_gettime_ns();
+	for (int i = 0; i < iterations; i++)
+		for (size_t j = 0; j < count; j++)
+			obs_data_set_int(data, keys[j], (long long)(i + j));
+	set_time = os_gettime_ns() - start;
+
+	start = os_gettime_ns();
+	for (int i = 0; i < iterations; i++)
+		for (size_t j = 0; j < count; j++)
+			sum += obs_data_get_int(data, keys[j]);
+	get_time = os_gettime_ns() - start;
+
+	for (size_t i = 0; i < count; i++)
+		obs_data_erase(data, keys[i]);
+
+	if (!check_order(data, 0))
+		success = false;
+
+	printf("%5zu keys: create %8.2f Mops/s  load %8.2f Mops/s  "
+			"set %8.2f Mops/s  get %8.2f Mops/s  %s\n",
+			count,
+			mops(count, create_time),
+			mops(count, load_time),
+			mops(ops, set_time),
+			mops(ops, get_time),
+			success ? "ok" : "ORDER MISMATCH");
+
+	/* keep the compiler from dropping the get loop */
+	if (sum == -1)
+		printf("\n");
+
+	obs_data_release(data);
+	free_keys(keys, count);
+	return success;
+}
+
+static bool test_order(void)
+{
+	obs_data_t *data = obs_data_create();
+	char name[32];
+	bool success;
+
+	for (int i = 999; i >= 0; i--) {
+		snprintf(name, sizeof(name), "key%03d", (i * 7) % 1000);
+		obs_data_set_string(data, name, name);
+	}
+
+	/* grow some items so they get reallocated */
+	for (int i = 0; i < 1000; i += 3) {
+		snprintf(name, sizeof(name), "key%03d", i);
+		obs_data_set_string(data, name,
+				"a much longer string value than before");
+	}
+
+	for (int i = 0; i < 1000; i += 2) {
+		snprintf(name, sizeof(name), "key%03d", i);
+		obs_data_erase(data, name);
+	}
+
+	success = check_order(data, 500);
+
+	for (int i = 0; i < 1000; i++) {
+		const char *val;
+
+		snprintf(name, sizeof(name), "key%03d", i);
+		val = obs_data_get_string(data, name);
+
+		if ((i % 2 == 0) != (*val == 0))
+			success = false;
+		else if (i % 2 && i % 3 == 0 && *val != 'a')
+			success = false;
+		else if (i % 2 && i % 3 != 0 && strcmp(val, name) != 0)
+			success = false;
+	}
+
+	obs_data_release(data);
+	return success;
+}
+
+int main(int argc, char *argv[])
+{
+	int iterations = 1000;
+	bool success;
+
+	if (argc > 1)
+		iterations = atoi(argv[1]);
+	if (iterations <= 0)
+		iterations = 1;
+
+	srand(1);
+
+	success = test_order();
+	printf("order/lookup check: %s\n", success ? "ok" : "FAILED");
+
+	for (size_t i = 0; i < NUM_KEY_COUNTS; i++)
+		if (!bench_keys(key_counts[i], iterations))
+			success = false;
+
+	printf("Number of memory leaks: %ld\n", bnum_allocs());
+	return success ? 0 : 1;
+}
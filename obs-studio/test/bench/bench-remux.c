@@ -0,0 +1,181 @@
+/*
+ * Writes a generated recording and measures how fast media_remux_job_process
+ * remuxes it.
+ *
+ *   bench-remux [size_mb]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <media-io/media-remux.h>
+
+#include <libavformat/avformat.h>
+
+#define IN_FILE             "bench-remux-in.mkv"
+#define OUT_FILE            "bench-remux-out.mp4"
+
+#define VIDEO_FPS           60
+#define VIDEO_FRAME_SIZE    (100 * 1024)
+#define VIDEO_KEYINT        (VIDEO_FPS * 2)
+#define AUDIO_SAMPLE_RATE   48000
+#define AUDIO_FRAME_SAMPLES 1152
+#define AUDIO_FRAME_SIZE    480
+#define RANDOM_SIZE         (4 * 1024 * 1024)
+
+struct bench {
+	media_remux_job_t job;
+	float throughput;
+	int callbacks;
+};
+
+static AVStream *add_stream(AVFormatContext *ctx, enum AVMediaType type,
+		enum AVCodecID id, AVRational time_base)
+{
+	AVStream *stream = avformat_new_stream(ctx, NULL);
+	if (!stream)
+		return NULL;
+
+	stream->codec->codec_type = type;
+	stream->codec->codec_id = id;
+	stream->codec->time_base = time_base;
+	stream->time_base = time_base;
+
+	if (ctx->oformat->flags & AVFMT_GLOBALHEADER)
+		stream->codec->flags |= CODEC_FLAG_GLOBAL_HEADER;
+
+	return stream;
+}
+
+static bool write_packets(AVFormatContext *ctx, AVStream *video,
+		AVStream *audio, int64_t size)
+{
+	uint8_t *random = bmalloc(RANDOM_SIZE);
+	int64_t video_frames = 0;
+	int64_t audio_frames = 0;
+	int64_t written = 0;
+	bool success = true;
+
+	for (size_t i = 0; i < RANDOM_SIZE; i++)
+		random[i] = (uint8_t)rand();
+
+	while (success && written < size) {
+		bool is_audio = audio_frames * AUDIO_FRAME_SAMPLES * VIDEO_FPS <
+			video_frames * AUDIO_SAMPLE_RATE;
+		AVStream *stream = is_audio ? audio : video;
+		int64_t ts = is_audio ? audio_frames++ : video_frames++;
+		AVPacket pkt;
+
+		av_init_packet(&pkt);
+		pkt.stream_index = stream->index;
+		pkt.size = is_audio ? AUDIO_FRAME_SIZE : VIDEO_FRAME_SIZE;
+		pkt.data = random + rand() % (RANDOM_SIZE - pkt.size);
+		pkt.pts = pkt.dts = av_rescale_q(ts, stream->codec->time_base,
+				stream->time_base);
+
+		if (is_audio || ts % VIDEO_KEYINT == 0)
+			pkt.flags = AV_PKT_FLAG_KEY;
+
+		written += pkt.size;
+		success = av_interleaved_write_frame(ctx, &pkt) >= 0;
+	}
+
+	bfree(random);
+	return success;
+}
+
+static bool generate_file(int64_t size)
+{
+	AVFormatContext *ctx = NULL;
+	AVStream *video, *audio;
+	bool success = false;
+
+	avformat_alloc_output_context2(&ctx, NULL, NULL, IN_FILE);
+	if (!ctx)
+		return false;
+
+	video = add_stream(ctx, AVMEDIA_TYPE_VIDEO, AV_CODEC_ID_MPEG4,
+			(AVRational){1, VIDEO_FPS});
+	audio = add_stream(ctx, AVMEDIA_TYPE_AUDIO, AV_CODEC_ID_MP3,
+			(AVRational){1, AUDIO_SAMPLE_RATE});
+	if (!video || !audio)
+		goto fail;
+
+	video->codec->width = 1920;
+	video->codec->height = 1080;
+	audio->codec->sample_rate = AUDIO_SAMPLE_RATE;
+	audio->codec->channels = 2;
+
+	if (avio_open(&ctx->pb, IN_FILE, AVIO_FLAG_WRITE) < 0)
+		goto fail;
+
+	if (avformat_write_header(ctx, NULL) >= 0) {
+		success = write_packets(ctx, video, audio, size);
+		success = av_write_trailer(ctx) >= 0 && success;
+	}
+
+	avio_close(ctx->pb);
+
+fail:
+	avformat_free_context(ctx);
+	return success;
+}
+
+static bool progress_callback(void *data, float percent)
+{
+	struct bench *bench = data;
+	UNUSED_PARAMETER(percent);
+
+	bench->throughput = media_remux_job_get_throughput(bench->job);
+	bench->callbacks++;
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	int size_mb = argc > 1 ? atoi(argv[1]) : 1024;
+	struct bench bench = {0};
+	uint64_t start, elapsed;
+	double in_mb;
+	bool success;
+
+	if (size_mb <= 0)
+		size_mb = 1024;
+
+	av_register_all();
+
+	printf("generating %d MB test file '%s'\n", size_mb, IN_FILE);
+	if (!generate_file((int64_t)size_mb * 1024 * 1024)) {
+		printf("failed to write the test file\n");
+		os_unlink(IN_FILE);
+		return 1;
+	}
+
+	in_mb = os_get_file_size(IN_FILE) / (1024.0 * 1024.0);
+
+	start = os_gettime_ns();
+
+	success = media_remux_job_create(&bench.job, IN_FILE, OUT_FILE);
+	if (success)
+		success = media_remux_job_process(bench.job,
+				progress_callback, &bench);
+	media_remux_job_destroy(bench.job);
+
+	elapsed = os_gettime_ns() - start;
+
+	if (success) {
+		double seconds = elapsed / 1000000000.0;
+		printf("remuxed %.1f MB in %.2f seconds: %.1f MB/s "
+		       "(%.1f MB/s last reported in %d callbacks)\n",
+		       in_mb, seconds, in_mb / seconds,
+		       bench.throughput, bench.callbacks);
+	} else {
+		printf("remux failed\n");
+	}
+
+	os_unlink(IN_FILE);
+	os_unlink(OUT_FILE);
+	return success ? 0 : 1;
+}